@@ -0,0 +1,100 @@
+#ifndef BINARYMANIFEST_H
+#define BINARYMANIFEST_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <windows.h>
+#include <json/json.h>
+
+// 哈希模式清单的二进制形式：定长头 + 按列存放的表 + 字符串表，小端序
+// 文件与目录内容共用条目表，前 fileCount 条为顶层文件，各表均按路径排序
+class BinaryManifest {
+public:
+    static const uint32_t FORMAT_VERSION=1;
+    static const uint32_t NO_ENTRY=0xFFFFFFFF;
+
+    struct FileEntry {
+        std::string_view path;
+        std::string_view url;
+        long long size;
+        const unsigned char* digest;
+    };
+
+    struct DirectoryEntry {
+        std::string_view path;
+        std::string_view url;
+        uint32_t firstContent;
+        uint32_t contentCount;
+        bool isEmpty;
+    };
+
+    BinaryManifest();
+    ~BinaryManifest();
+
+    BinaryManifest(const BinaryManifest&)=delete;
+    BinaryManifest& operator=(const BinaryManifest&)=delete;
+
+    bool LoadFromFile(const std::string& path);
+    bool LoadFromBuffer(std::vector<unsigned char>&& buffer);
+    void Close();
+    bool IsLoaded() const { return base!=nullptr; }
+
+    const std::string& GetAlgorithm() const { return algorithm; }
+    uint32_t GetDigestSize() const { return digestSize; }
+    uint32_t GetFileCount() const { return fileCount; }
+    uint32_t GetDirectoryCount() const { return directoryCount; }
+    uint32_t GetEntryCount() const { return entryCount; }
+
+    // 条目下标: [0,fileCount) 为顶层文件，目录内容在 DirectoryEntry 给出的区间内
+    FileEntry GetEntry(uint32_t index) const;
+    DirectoryEntry GetDirectory(uint32_t index) const;
+    uint32_t FindFile(std::string_view path) const;
+    std::string_view GetStringTable() const { return std::string_view(strings,static_cast<size_t>(stringsSize)); }
+
+    bool DigestMatches(const unsigned char* digest,const std::string& hex) const;
+    void DigestToHex(const unsigned char* digest,std::string& hex) const;
+
+    static bool Build(const Json::Value& fileManifest,const Json::Value& directoryManifest,
+        const std::string& algorithm,std::vector<unsigned char>& output,std::string& error);
+
+private:
+    struct StringRef {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct ContentRange {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    bool Parse(const unsigned char* data,size_t size);
+    std::string_view GetString(const StringRef& ref) const;
+
+    const unsigned char* base;
+    size_t size;
+    std::vector<unsigned char> ownedBuffer;
+    HANDLE fileHandle;
+    HANDLE mappingHandle;
+
+    std::string algorithm;
+    uint32_t digestSize;
+    uint32_t fileCount;
+    uint32_t directoryCount;
+    uint32_t entryCount;
+    const StringRef* entryPaths;
+    const StringRef* entryUrls;
+    const int64_t* entrySizes;
+    const unsigned char* entryDigests;
+    const unsigned char* entryFlags;
+    const StringRef* directoryPaths;
+    const StringRef* directoryUrls;
+    const ContentRange* directoryContents;
+    const unsigned char* directoryFlags;
+    const char* strings;
+    uint64_t stringsSize;
+};
+
+#endif
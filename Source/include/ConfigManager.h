@@ -2,14 +2,56 @@
 #define CONFIGMANAGER_H
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
 #include <json/json.h>
 #include "Logger.h"
 
+// 配置的类型化只读视图，字段缺失时取默认值
+struct ConfigSnapshot {
+    std::string version="1.0.0";
+    std::string launcherVersion="0.0.1";
+    std::string updateUrl;
+    std::string gameDirectory="./.minecraft";
+    bool autoUpdate=true;
+    std::string logFile="./logs/updater.log";
+    std::string updateMode="hash";
+    std::string hashAlgorithm="sha256";
+    bool enableFileDeletion=true;
+    bool skipMajorVersionCheck=false;
+    bool enableApiCache=true;
+    int apiTimeout=60;
+    int verifyThreads=0;
+    bool enableHashIndex=true;
+    int maxConcurrentDownloads=8;
+    int downloadRetries=3;
+    int downloadSegments=4;
+    int segmentMinSizeMB=16;
+    bool enableManifestCache=true;
+    int logFlushIntervalMs=1000;
+    std::string logLevel="info";
+    int extractThreads=0;
+    int memoryExtractMaxMB=256;
+    bool streamingExtract=true;
+    bool skipUnchangedFiles=true;
+    bool coalescePackages=true;
+    int incrementalHopCostKB=0;
+    int prefetchPackages=1;
+    int tempDiskBudgetMB=4096;
+};
+
 class ConfigManager {
 private:
     std::string configPath;
     Json::Value cachedConfig;
     bool configLoaded;
+    // 当前快照通过原子指针发布，读取无需加锁；旧快照保留到析构，已取得的引用始终有效
+    std::atomic<const ConfigSnapshot*> currentSnapshot;
+    std::vector<std::unique_ptr<const ConfigSnapshot>> snapshots;
+    std::mutex writeMutex;
 
 public:
     ConfigManager(const std::string& configPath);
@@ -35,6 +77,9 @@ public:
 
     Json::Value ReadConfig();
     bool WriteConfig(const Json::Value& config);
+    const ConfigSnapshot& GetSnapshot() const { return *currentSnapshot.load(std::memory_order_acquire); }
+    // 在一次加锁内修改多个字段，只落盘一次
+    bool UpdateConfig(const std::function<void(Json::Value&)>& edit);
 
     std::string ReadUpdateMode();
     bool WriteUpdateMode(const std::string& mode);
@@ -48,11 +93,47 @@ public:
     bool WriteEnableApiCache(bool enable);
     int ReadApiTimeout();
     bool WriteApiTimeout(int timeout);
+    int ReadVerifyThreads();
+    bool WriteVerifyThreads(int threads);
+    bool ReadEnableHashIndex();
+    bool WriteEnableHashIndex(bool enable);
+    int ReadMaxConcurrentDownloads();
+    bool WriteMaxConcurrentDownloads(int count);
+    int ReadDownloadRetries();
+    bool WriteDownloadRetries(int retries);
+    int ReadDownloadSegments();
+    bool WriteDownloadSegments(int segments);
+    int ReadSegmentMinSizeMB();
+    bool WriteSegmentMinSizeMB(int sizeMB);
+    bool ReadEnableManifestCache();
+    bool WriteEnableManifestCache(bool enable);
+    int ReadLogFlushIntervalMs();
+    bool WriteLogFlushIntervalMs(int milliseconds);
+    std::string ReadLogLevel();
+    bool WriteLogLevel(const std::string& level);
+    int ReadExtractThreads();
+    bool WriteExtractThreads(int threads);
+    int ReadMemoryExtractMaxMB();
+    bool WriteMemoryExtractMaxMB(int sizeMB);
+    bool ReadStreamingExtract();
+    bool WriteStreamingExtract(bool enable);
+    bool ReadSkipUnchangedFiles();
+    bool WriteSkipUnchangedFiles(bool enable);
+    bool ReadCoalescePackages();
+    bool WriteCoalescePackages(bool enable);
+    int ReadIncrementalHopCostKB();
+    bool WriteIncrementalHopCostKB(int costKB);
+    int ReadPrefetchPackages();
+    bool WritePrefetchPackages(int count);
+    int ReadTempDiskBudgetMB();
+    bool WriteTempDiskBudgetMB(int sizeMB);
 
 private:
     bool EnsureConfigDirectory();
     Json::Value CreateDefaultConfig();
     bool LoadConfig();
+    bool SaveConfigLocked();
+    void PublishSnapshotLocked();
 };
 
 #endif
\ No newline at end of file
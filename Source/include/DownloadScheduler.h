@@ -0,0 +1,95 @@
+#ifndef DOWNLOADSCHEDULER_H
+#define DOWNLOADSCHEDULER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <curl/curl.h>
+#include "PartialDownload.h"
+
+class HttpClient;
+
+class DownloadScheduler {
+public:
+    struct DownloadResult {
+        bool success=false;
+        long httpStatus=0;
+        long long bytes=0;
+        std::string digest;
+        std::string error;
+    };
+
+    using CompletionCallback=std::function<void(const DownloadResult& result)>;
+    using ProgressCallback=std::function<void(long long downloadedBytes,long long totalBytes,int completed,int total)>;
+
+    struct DownloadTask {
+        std::string url;
+        std::string outputPath;
+        std::string hashAlgorithm;
+        std::string expectedHash;
+        long long expectedSize=0;
+        int timeoutSeconds=0;
+        CompletionCallback onComplete;
+    };
+
+    DownloadScheduler(int maxConcurrent=0,HttpClient* client=nullptr);
+    ~DownloadScheduler();
+
+    DownloadScheduler(const DownloadScheduler&)=delete;
+    DownloadScheduler& operator=(const DownloadScheduler&)=delete;
+
+    void SetMaxAttempts(int attempts) { maxAttempts=attempts>0?attempts:1; }
+    // 同一输出路径只下载一次：URL 与哈希一致的重复任务共享结果，不一致的直接判为失败
+    void Enqueue(DownloadTask task);
+    bool Run(ProgressCallback progressCallback=nullptr);
+
+    int GetMaxConcurrent() const { return maxConcurrent; }
+    int GetSucceededCount() const { return succeededCount; }
+    int GetFailedCount() const { return failedCount; }
+
+private:
+    struct QueuedTask {
+        DownloadTask task;
+        int attempt;
+    };
+
+    // 与首个任务写同一文件的重复任务，只等它的结果
+    struct OutputClaim {
+        std::string url;
+        std::string expectedHash;
+        std::vector<CompletionCallback> followers;
+    };
+
+    struct Transfer {
+        QueuedTask queued;
+        CURL* easy=nullptr;
+        std::unique_ptr<PartialDownload> partial;
+    };
+
+    bool StartTransfer(QueuedTask queued);
+    void FinishTransfer(Transfer* transfer,CURLcode code);
+    CURL* AcquireHandle();
+    void ReleaseHandle(CURL* easy);
+    void NotifyCompletion(const DownloadTask& task,const DownloadResult& result);
+    static std::wstring OutputKey(const std::string& outputPath);
+
+    CURLM* multi;
+    HttpClient* httpClient;
+    int maxConcurrent;
+    int maxAttempts;
+    std::deque<QueuedTask> pendingTasks;
+    std::vector<DownloadTask> rejectedTasks;
+    std::unordered_map<std::wstring,OutputClaim> outputClaims;
+    std::vector<std::unique_ptr<Transfer>> activeTransfers;
+    std::vector<CURL*> idleHandles;
+    long long expectedTotalBytes;
+    long long finishedBytes;
+    int totalTasks;
+    int succeededCount;
+    int failedCount;
+};
+
+#endif
@@ -3,18 +3,57 @@
 
 #include <string>
 #include <vector>
-#include <openssl/md5.h>
-#include <openssl/sha.h>
+#include <openssl/evp.h>
+#include <blake3.h>
+#include <xxhash.h>
+#include <zlib.h>
+#include "HashIndex.h"
 
 class FileHasher {
 public:
+	// 支持 IsSupportedAlgorithm 中的算法；另有 "crc32" 仅用于与 ZIP 条目比对
+	class StreamHasher {
+	public:
+		explicit StreamHasher(const std::string& algorithm);
+		~StreamHasher();
+		StreamHasher(const StreamHasher&)=delete;
+		StreamHasher& operator=(const StreamHasher&)=delete;
+
+		bool IsValid() const { return backend!=Backend::None; }
+		void Update(const void* data,size_t length);
+		void UpdateLarge(const void* data,size_t length);
+		std::string Final();
+	private:
+		enum class Backend {
+			None,
+			Evp,
+			Blake3,
+			Xxh3,
+			Crc32
+		};
+
+		Backend backend;
+		EVP_MD_CTX* evpContext;
+		blake3_hasher* blake3State;
+		XXH3_state_t* xxh3State;
+		uLong crc32State;
+		std::string digest;
+		bool finalized;
+	};
+
 	static std::string CalculateMemoryHash(const std::vector<unsigned char>& data,const std::string& algorithm);
 	static std::string CalculateDirectoryHash(const std::string& directoryPath,const std::string& algorithm);
 	static std::string CalculateFileHashStream(const std::string& filePath,const std::string& algorithm);
+	static std::string CalculateFileHashCached(const std::string& filePath,const std::string& algorithm,HashIndex* index);
+	static bool IsSupportedAlgorithm(const std::string& algorithm);
+	static std::string DescribeSimdSupport();
+	static bool HashFileContents(const std::string& filePath,StreamHasher& hasher);
+	static bool HashFileContents(const std::wstring& widePath,StreamHasher& hasher);
+	static bool CalculateFileCrc32(const std::wstring& widePath,uint32_t& crc);
+	// 大小不同时不读文件内容
+	static bool FileMatchesCrc32(const std::wstring& widePath,unsigned long long size,uint32_t crc);
 private:
-	static std::string MD5Hash(const std::vector<unsigned char>& data);
-	static std::string SHA1Hash(const std::vector<unsigned char>& data);
-	static std::string SHA256Hash(const std::vector<unsigned char>& data);
+	static std::string ToHex(const unsigned char* data,size_t length);
 };
 
-#endif
\ No newline at end of file
+#endif
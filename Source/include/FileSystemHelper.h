@@ -7,7 +7,7 @@ public:
     bool BackupFile(const std::string& filePath);           
     void CleanupOrphanedFiles(const std::string& baseDir,
         const std::string& relativeDir,
-        const Json::Value& expectedContents);
+        const std::vector<std::string>& expectedPaths);
     bool CopyFileWithUnicode(const std::wstring& sourcePath,
         const std::wstring& targetPath);
 
@@ -20,6 +20,13 @@ public:
     bool ValidateExtraction(const std::string& extractPath);
     static std::string SecureCombine(const std::string& baseDir,const std::string& userPath);
     static std::wstring SecureCombineW(const std::wstring& baseDir,const std::wstring& userPath);
+    // 批量拼接同一基准目录下的路径：基准目录先用 CanonicalBaseW 解析一次，之后只做词法检查
+    static std::filesystem::path CanonicalBaseW(const std::wstring& baseDir);
+    static std::wstring SecureCombineLexicalW(const std::filesystem::path& canonicalBase,const std::wstring& userPath);
+    // 词法检查挡不住已存在的符号链接或联接点：写入前对目标所在目录再做一次解析，每个目录检查一次即可
+    static void VerifyWithinBaseW(const std::filesystem::path& canonicalBase,const std::wstring& directory);
+    // 目标文件本身若已是链接，打开时会跟随它写到别处，需按解析后的完整路径检查
+    static void VerifyFileWithinBaseW(const std::filesystem::path& canonicalBase,const std::wstring& filePath);
 
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef FILEVERIFICATIONENGINE_H
+#define FILEVERIFICATIONENGINE_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include "HashIndex.h"
+
+class FileVerificationEngine {
+public:
+    enum class VerifyStatus {
+        Match,
+        Missing,
+        Mismatch,
+        HashFailed,
+        PathBlocked
+    };
+
+    struct VerifyTask {
+        std::string relativePath;
+        std::string fullPath;
+        std::string expectedHash;
+    };
+
+    struct VerifyResult {
+        std::string relativePath;
+        VerifyStatus status;
+        std::string actualHash;
+    };
+
+    using ProgressCallback=std::function<void(int checked,int missing,int mismatched)>;
+
+    FileVerificationEngine(int threadCount=0,size_t queueCapacity=0);
+    ~FileVerificationEngine();
+
+    void Start(const std::string& algorithm,HashIndex* index=nullptr);
+    void Submit(VerifyTask task);
+    void AddResult(const std::string& relativePath,VerifyStatus status);
+    bool Finish(std::vector<VerifyResult>& results,ProgressCallback progressCallback=nullptr);
+
+    int GetThreadCount() const { return threadCount; }
+    int GetCheckedCount() const { return checkedCount; }
+    int GetMissingCount() const { return missingCount; }
+    int GetMismatchedCount() const { return mismatchedCount; }
+
+private:
+    struct QueuedTask {
+        size_t sequence;
+        VerifyTask task;
+    };
+    struct SequencedResult {
+        size_t sequence;
+        VerifyResult result;
+    };
+
+    void WorkerLoop();
+    void RecordResult(size_t sequence,VerifyResult result);
+    void StopWorkers();
+
+    int threadCount;
+    size_t queueCapacity;
+    std::string hashAlgorithm;
+    HashIndex* hashIndex;
+
+    std::vector<std::thread> workers;
+    std::deque<QueuedTask> taskQueue;
+    std::mutex queueMutex;
+    std::condition_variable queueNotEmpty;
+    std::condition_variable queueNotFull;
+    bool stopping;
+    size_t nextSequence;
+
+    std::vector<SequencedResult> collectedResults;
+    std::mutex resultMutex;
+    std::condition_variable resultAdded;
+
+    std::atomic<int> checkedCount;
+    std::atomic<int> missingCount;
+    std::atomic<int> mismatchedCount;
+};
+
+#endif
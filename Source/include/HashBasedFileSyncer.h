@@ -2,10 +2,14 @@
 #define HASHBASEDFILESYNCER_H
 
 #include <string>
+#include <functional>
 #include <json/json.h>
 #include "HttpClient.h"
 #include "ConfigManager.h"
 #include "ProgressReporter.h"
+#include "FileVerificationEngine.h"
+#include "HashIndex.h"
+#include "Manifest.h"
 
 #include "FileSystemHelper.h"
 class UpdateOrchestrator;
@@ -17,14 +21,18 @@ public:
         ProgressReporter& reporter,
         FileSystemHelper& fs,
         ZipExtractor& zip,
-        ConfigManager& config);
-    bool CheckFileConsistency(const Json::Value& fileManifest,const Json::Value& directoryManifest);
-    bool SyncFilesByHash(const Json::Value& updateInfo);
-    bool ProcessDeleteList(const Json::Value& deleteList);
+        ConfigManager& config,
+        HashIndex& index);
+    bool CheckFileConsistency(const Manifest& manifest,
+        std::vector<FileVerificationEngine::VerifyResult>* verifyResults=nullptr);
+    bool SyncFilesByHash(const Manifest& manifest);
+    bool ProcessDeleteList(const std::vector<std::string>& deleteList);
     bool ShouldForceHashUpdate(const std::string& localVersion,const std::string& remoteVersion);
 private:
-    bool UpdateFilesByHash(const Json::Value& fileManifest,const Json::Value& directoryManifest);
-    bool SyncDirectoryByHash(const Json::Value& dirInfo);
+    bool RunConsistencyCheck(const std::function<void(FileVerificationEngine&)>& submitEntries,
+        std::vector<FileVerificationEngine::VerifyResult>* verifyResults);
+    bool UpdateFilesByHash(const Manifest& manifest);
+    bool SyncDirectoryByHash(const Manifest& manifest,uint32_t directory);
     int GetDownloadTimeoutForSize(long long fileSize);
     HttpClient& httpClient;
     UpdateOrchestrator& updateOrchestrator;
@@ -32,5 +40,6 @@ private:
     FileSystemHelper& fsHelper;
     ZipExtractor& zipExtractor;
     ConfigManager& configManager;
+    HashIndex& hashIndex;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+
+class HashIndex {
+public:
+    struct FileStamp {
+        unsigned long long size=0;
+        unsigned long long mtime=0;
+        unsigned long long fileId=0;
+
+        bool operator==(const FileStamp& other) const {
+            return size==other.size&&mtime==other.mtime&&fileId==other.fileId;
+        }
+        bool operator!=(const FileStamp& other) const { return !(*this==other); }
+    };
+
+    HashIndex(const std::string& indexPath,const std::string& baseDirectory);
+
+    void Load();
+    bool Save();
+    void Invalidate();
+    void SetEnabled(bool enable) { enabled=enable; }
+    bool IsEnabled() const { return enabled; }
+
+    bool Lookup(const std::string& filePath,const FileStamp& stamp,const std::string& algorithm,std::string& hash);
+    void Store(const std::string& filePath,const FileStamp& stamp,const std::string& algorithm,const std::string& hash);
+    void Remove(const std::string& filePath);
+
+    size_t GetHitCount() const { return hitCount; }
+    size_t GetMissCount() const { return missCount; }
+    const std::string& GetIndexPath() const { return indexPath; }
+
+    static bool GetFileStamp(const std::string& filePath,FileStamp& stamp);
+
+private:
+    struct Entry {
+        FileStamp stamp;
+        std::string algorithm;
+        std::string hash;
+    };
+
+    std::string MakeKey(const std::string& filePath) const;
+    void EnsureLoaded();
+
+    std::string indexPath;
+    std::string basePrefix;
+    std::unordered_map<std::string,Entry> entries;
+    std::mutex indexMutex;
+    bool enabled;
+    bool loaded;
+    bool dirty;
+    std::atomic<size_t> hitCount;
+    std::atomic<size_t> missCount;
+};
+
+#endif
@@ -4,30 +4,90 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <mutex>
+#include <atomic>
 #include <curl/curl.h>
+#include "FileHasher.h"
+#include "SegmentedDownload.h"
 
 class HttpClient {
 public:
     using DownloadProgressCallback=std::function<void(long long downloaded,long long total,void* userdata)>;
+    // 返回 false 时中止下载
+    using DataSink=std::function<bool(const unsigned char* data,size_t size)>;
+
+    struct HttpResponse {
+        long status=0;
+        std::string etag;
+        std::string lastModified;
+    };
 
     HttpClient(int timeout=60);
     ~HttpClient();
 
     std::string Get(const std::string& url);
+    // 只有 2xx 响应的正文交给 sink，304 等状态不回调
+    bool GetConditional(const std::string& url,const std::string& etag,const std::string& lastModified,
+        const DataSink& sink,HttpResponse& response);
     bool DownloadFile(const std::string& url,const std::string& outputPath);
     bool DownloadFileWithProgress(const std::string& url,const std::string& outputPath,
+        DownloadProgressCallback progressCallback=nullptr,void* userdata=nullptr,
+        FileHasher::StreamHasher* hasher=nullptr,long long expectedSize=0);
+    bool DownloadFileWithHash(const std::string& url,const std::string& outputPath,
+        const std::string& algorithm,std::string& digest,
         DownloadProgressCallback progressCallback=nullptr,void* userdata=nullptr);
+    bool DownloadFileResumable(const std::string& url,const std::string& outputPath,
+        const std::string& algorithm,const std::string& expectedHash,std::string& digest,
+        DownloadProgressCallback progressCallback=nullptr,void* userdata=nullptr,long long expectedSize=0);
     bool DownloadToMemory(const std::string& url,std::vector<unsigned char>& buffer);
     bool DownloadToMemoryWithProgress(const std::string& url,std::vector<unsigned char>& buffer,
+        DownloadProgressCallback progressCallback=nullptr,void* userdata=nullptr,
+        FileHasher::StreamHasher* hasher=nullptr);
+    // 按到达顺序把数据交给 sink，不做分段下载
+    bool DownloadToSink(const std::string& url,const DataSink& sink,
         DownloadProgressCallback progressCallback=nullptr,void* userdata=nullptr);
     void SetTimeout(int timeout);
     void SetDownloadTimeout(int timeout);
+    void SetDownloadRetries(int retries);
+    void SetSegmentedDownload(int segmentCount,long long minSegmentSize);
+
+    CURLSH* GetShareHandle() const { return share; }
+    static void ApplySharedOptions(CURL* handle,CURLSH* share);
+    void RecordConnectionInfo(CURL* handle);
+    size_t GetRequestCount() const { return requestCount; }
+    size_t GetReusedConnectionCount() const { return reusedConnectionCount; }
+    size_t GetHttp2RequestCount() const { return http2RequestCount; }
+    void LogConnectionStats();
 
 private:
+    struct FileWriteTarget {
+        FILE* file;
+        FileHasher::StreamHasher* hasher;
+    };
+
+    struct MemoryWriteTarget {
+        std::vector<unsigned char>* buffer;
+        FileHasher::StreamHasher* hasher;
+    };
+
+    struct ConditionalWriteTarget {
+        CURL* handle;
+        const DataSink* sink;
+        long long received;
+        bool checked;
+        bool forward;
+    };
+
     static size_t WriteCallback(void* contents,size_t size,size_t nmemb,std::string* data);
-    static size_t WriteFileCallback(void* contents,size_t size,size_t nmemb,FILE* file);
-    static size_t WriteMemoryCallback(void* contents,size_t size,size_t nmemb,std::vector<unsigned char>* buffer);
+    static size_t WriteFileCallback(void* contents,size_t size,size_t nmemb,FileWriteTarget* target);
+    static size_t WriteMemoryCallback(void* contents,size_t size,size_t nmemb,MemoryWriteTarget* target);
+    static size_t WriteSinkCallback(void* contents,size_t size,size_t nmemb,const DataSink* sink);
+    static size_t WriteConditionalCallback(void* contents,size_t size,size_t nmemb,ConditionalWriteTarget* target);
     static int CurlProgressCallback(void* clientp,double dltotal,double dlnow,double ultotal,double ulnow);
+    SegmentedDownload::Outcome TrySegmentedDownload(const std::string& url,const std::string& outputPath,
+        long long expectedSize,DownloadProgressCallback progressCallback,void* userdata);
+    static void ShareLockCallback(CURL* handle,curl_lock_data data,curl_lock_access access,void* userptr);
+    static void ShareUnlockCallback(CURL* handle,curl_lock_data data,void* userptr);
 
     struct DownloadProgressData {
         DownloadProgressCallback callback;
@@ -35,11 +95,19 @@ private:
         long long lastUpdateTime;
         long long totalBytes;
         long long downloadedBytes;
+        long long resumeOffset;
     };
 
     CURL* curl;
+    CURLSH* share;
+    std::mutex shareLocks[CURL_LOCK_DATA_LAST];
+    std::atomic<size_t> requestCount;
+    std::atomic<size_t> reusedConnectionCount;
+    std::atomic<size_t> http2RequestCount;
     int timeoutSeconds;
     int downloadTimeoutSeconds;
+    int downloadRetries;
+    SegmentedDownload::Options segmentOptions;
 };
 
 #endif
\ No newline at end of file
@@ -9,6 +9,8 @@
 #include "ProgressReporter.h"
 #include "ZipExtractor.h"
 #include "FileSystemHelper.h"
+#include "Manifest.h"
+#include "ZipPackageReader.h"
 
 class UpdateOrchestrator;
 class IncrementalUpdatePlanner {
@@ -20,15 +22,34 @@ public:
         UpdateOrchestrator& orc,
         ZipExtractor& zip);
     bool ShouldUseIncrementalUpdate(const std::string& localVersion,const std::string& remoteVersion);
-    std::vector<std::string> GetUpdatePackagePath(const Json::Value& packages,
+    std::vector<std::string> GetUpdatePackagePath(const std::vector<Manifest::Package>& packages,
         const std::string& fromVersion,
         const std::string& toVersion);
-    bool ApplyIncrementalUpdate(const Json::Value& updateInfo,
+    bool ApplyIncrementalUpdate(const Manifest& manifest,
         const std::string& localVersion,
         const std::string& remoteVersion);
 
 private:
-    bool ApplyUpdateFromManifest(const std::string& manifestPath,const std::string& tempDir);
+    // update_manifest.txt 中的一行，package 为所在更新包的下标
+    struct ManifestOperation {
+        std::string type;
+        std::string path;
+        std::string oldPath;
+        size_t package=0;
+    };
+
+    // 出错返回 false；包信息缺失时返回 true 且 tempZip 为空
+    bool DownloadPackage(const Manifest& manifest,const std::string& packagePath,
+        size_t index,size_t count,std::string& tempZip);
+    bool ApplyPackage(const std::string& packagePath,const std::string& tempZip,size_t index);
+    // 后台线程提前下载后续的包，当前线程按顺序应用；受预取深度和临时空间上限约束
+    bool ApplyPackagesPrefetched(const Manifest& manifest,const std::vector<std::string>& packagePaths);
+    // 读取整条链的清单，每个路径只执行最终生效的操作
+    bool ApplyCoalescedUpdate(const std::vector<std::string>& packagePaths,const std::vector<std::string>& tempZips);
+    static void ParseUpdateManifest(const std::string& content,size_t package,std::vector<ManifestOperation>& operations);
+    static std::vector<ManifestOperation> CoalesceOperations(const std::vector<ManifestOperation>& operations);
+    bool ApplyManifestOperations(const std::vector<ZipPackageReader*>& packages,
+        const std::vector<ManifestOperation>& operations);
     bool ApplyUpdateFromDirectory(const std::string& sourceDir);
     bool ApplyAllFilesFromUpdate(const std::string& tempDir);
 
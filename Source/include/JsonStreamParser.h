@@ -0,0 +1,86 @@
+#ifndef JSONSTREAMPARSER_H
+#define JSONSTREAMPARSER_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// 推送式 JSON 词法/语法分析：数据可按任意边界分块喂入，每识别出一个记号就回调 Handler
+// 不建树，内存只与嵌套深度和单个记号的长度有关
+class JsonStreamParser {
+public:
+    // 任一回调返回 false 时中止解析
+    class Handler {
+    public:
+        virtual ~Handler()=default;
+        virtual bool StartObject()=0;
+        virtual bool EndObject()=0;
+        virtual bool StartArray()=0;
+        virtual bool EndArray()=0;
+        virtual bool Key(std::string& key)=0;
+        virtual bool String(std::string& value)=0;
+        // text 为原始数字文本，已通过语法校验
+        virtual bool Number(const std::string& text)=0;
+        virtual bool Bool(bool value)=0;
+        virtual bool Null()=0;
+    };
+
+    explicit JsonStreamParser(Handler& handler);
+
+    JsonStreamParser(const JsonStreamParser&)=delete;
+    JsonStreamParser& operator=(const JsonStreamParser&)=delete;
+
+    bool Feed(const char* data,size_t size);
+    // 数据全部喂完后调用，检查文档是否完整
+    bool Finish();
+    void Reset();
+
+    bool HasFailed() const { return failed; }
+    const std::string& GetError() const { return error; }
+
+private:
+    enum class Expect {
+        Value,
+        ValueOrEnd,
+        Key,
+        KeyOrEnd,
+        Colon,
+        CommaOrEnd,
+        Done
+    };
+
+    enum class Lexeme {
+        None,
+        String,
+        Number,
+        Literal
+    };
+
+    bool Fail(const std::string& message);
+    bool ProcessStructural(char c);
+    void AfterValue();
+    bool ProcessEscape(char c);
+    void AppendCodePoint(unsigned long codePoint);
+    bool FinishString();
+    bool FinishNumber();
+    bool FinishLiteral();
+
+    Handler& handler;
+    std::vector<char> containers;
+    Expect expect;
+    Lexeme lexeme;
+    std::string token;
+    bool stringIsKey;
+    // 0 普通字符，1 反斜杠之后，2 读取 \u 的四位十六进制
+    int escapeState;
+    int unicodeDigits;
+    unsigned long unicodeValue;
+    // 等待低位代理项的高位代理项，0 表示没有
+    unsigned long pendingHighSurrogate;
+    size_t bomMatched;
+    unsigned long long offset;
+    bool failed;
+    std::string error;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <json/json.h>
+#include "BinaryManifest.h"
+
+// 解析后的更新信息，由 ManifestParser 构建，之后不可修改，以 shared_ptr<const Manifest> 在各模块间共享
+// 文件条目按列存放：路径与 URL 驻留在同一块字符串区，摘要以二进制形式保存
+class Manifest {
+public:
+    struct LauncherInfo {
+        std::string version;
+        std::string url;
+        std::string hash;
+    };
+
+    struct Package {
+        std::string fromVersion;
+        std::string toVersion;
+        std::string archive;
+        std::string hash;
+        long long size=0;
+    };
+
+    struct Range {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    const std::string& GetVersion() const { return version; }
+    const std::string& GetUpdateMode() const { return updateMode; }
+    bool HasLauncher() const { return hasLauncher; }
+    const LauncherInfo& GetLauncher() const { return launcher; }
+    const Json::Value& GetChangelog() const { return changelog; }
+    const std::vector<std::string>& GetDeleteList() const { return deleteList; }
+    const std::vector<Package>& GetPackages() const { return packages; }
+    const Package* FindPackage(const std::string& archive) const;
+
+    // 条目下标: [0,GetFileCount()) 为顶层文件，目录内容在 GetDirectoryContents 给出的区间内
+    uint32_t GetFileCount() const { return fileCount; }
+    uint32_t GetDirectoryCount() const { return static_cast<uint32_t>(directoryPaths.size()); }
+    std::string_view GetPath(uint32_t entry) const { return GetString(entryPaths[entry]); }
+    std::string_view GetUrl(uint32_t entry) const { return GetString(entryUrls[entry]); }
+    long long GetSize(uint32_t entry) const { return entrySizes[entry]; }
+    bool IsDirectoryEntry(uint32_t entry) const { return (entryFlags[entry]&ENTRY_IS_DIRECTORY)!=0; }
+    bool HasDigest(uint32_t entry) const { return entryDigests[entry].length>0; }
+    void GetDigestHex(uint32_t entry,std::string& hex) const;
+    bool DigestMatches(uint32_t entry,const std::string& hex) const;
+
+    std::string_view GetDirectoryPath(uint32_t directory) const { return GetString(directoryPaths[directory]); }
+    std::string_view GetDirectoryUrl(uint32_t directory) const { return GetString(directoryUrls[directory]); }
+    Range GetDirectoryContents(uint32_t directory) const { return directoryContents[directory]; }
+    bool IsEmptyDirectory(uint32_t directory) const { return directoryEmpty[directory]!=0; }
+
+    bool IsFromBinary() const { return fromBinary; }
+
+private:
+    friend class ManifestParser;
+
+    static const unsigned char ENTRY_IS_DIRECTORY=1;
+    // 无法按十六进制解码的哈希保留原文，只做逐字比较
+    static const unsigned char ENTRY_RAW_DIGEST=2;
+
+    struct Span {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    Manifest();
+    // 除 files/directories 之外的顶层字段，changelog 从 updateInfo 中移走
+    void LoadHeaderFromJson(Json::Value& updateInfo);
+    Span AppendString(const std::string& value);
+    void AddEntry(Span path,Span url,long long size,bool isDirectory,const std::string& hash);
+    void AddDirectory(Span path,Span url,bool isEmpty,Range contents);
+    // 条目按到达顺序追加；files 出现在 directories 之后时把顶层文件整体移到最前
+    void PlaceFilesFirst(uint32_t filesBegin,uint32_t filesEnd);
+    void ClearEntries();
+    void LoadEntriesFromBinary(const BinaryManifest& binaryManifest);
+    std::string_view GetString(const Span& span) const { return std::string_view(strings.data()+span.offset,span.length); }
+
+    std::string version;
+    std::string updateMode;
+    bool hasLauncher;
+    LauncherInfo launcher;
+    Json::Value changelog;
+    std::vector<std::string> deleteList;
+    std::vector<Package> packages;
+
+    uint32_t fileCount;
+    std::string strings;
+    std::vector<unsigned char> digests;
+    std::vector<Span> entryPaths;
+    std::vector<Span> entryUrls;
+    std::vector<Span> entryDigests;
+    std::vector<long long> entrySizes;
+    std::vector<unsigned char> entryFlags;
+    std::vector<Span> directoryPaths;
+    std::vector<Span> directoryUrls;
+    std::vector<Range> directoryContents;
+    std::vector<unsigned char> directoryEmpty;
+    bool fromBinary;
+};
+
+#endif
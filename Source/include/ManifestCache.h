@@ -0,0 +1,38 @@
+#ifndef MANIFESTCACHE_H
+#define MANIFESTCACHE_H
+
+#include <string>
+#include <fstream>
+#include "ManifestParser.h"
+
+class ManifestCache {
+public:
+    ManifestCache(const std::string& cachePath);
+
+    void SetEnabled(bool enable) { enabled=enable; }
+    bool IsEnabled() const { return enabled; }
+
+    bool LoadValidators(const std::string& url,std::string& etag,std::string& lastModified);
+    bool LoadManifest(ManifestParser& parser);
+    // 正文边下载边写入临时文件，CommitStore 时才替换正式缓存
+    void BeginStore();
+    void AppendBody(const unsigned char* data,size_t size);
+    bool CommitStore(const std::string& url,const std::string& etag,const std::string& lastModified);
+    void AbortStore();
+    void Invalidate();
+
+private:
+    bool WriteFileAtomic(const std::string& path,const std::string& content);
+
+    std::string cachePath;
+    std::string metaPath;
+    std::string cachedUrl;
+    std::string cachedEtag;
+    std::string cachedLastModified;
+    std::string storePath;
+    std::ofstream storeFile;
+    bool metaLoaded;
+    bool enabled;
+};
+
+#endif
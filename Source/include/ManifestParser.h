@@ -0,0 +1,86 @@
+#ifndef MANIFESTPARSER_H
+#define MANIFESTPARSER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <json/json.h>
+#include "JsonStreamParser.h"
+#include "Manifest.h"
+#include "BinaryManifest.h"
+
+// 边接收边解析更新信息：files 与 directories 中的条目到达即写入 Manifest 的列式存储，不生成 JSON 树
+// 其余顶层字段（版本、更新日志、增量包列表等）体积很小，仍组装成 Json::Value
+class ManifestParser : private JsonStreamParser::Handler {
+public:
+    ManifestParser();
+
+    ManifestParser(const ManifestParser&)=delete;
+    ManifestParser& operator=(const ManifestParser&)=delete;
+
+    bool Feed(const char* data,size_t size);
+    bool Finish();
+    // 丢弃已解析的内容，重新开始一份文档
+    void Reset();
+    const std::string& GetError() const;
+
+    // Finish 成功后有效，不含 files 与 directories
+    const Json::Value& GetHeader() const { return header; }
+    // 提供二进制清单时文件表取自二进制清单，已解析的 JSON 条目丢弃；之后需 Reset 才能再次使用
+    std::shared_ptr<const Manifest> Build(const BinaryManifest* binaryManifest=nullptr);
+
+private:
+    enum class Scope {
+        Root,
+        Header,
+        Files,
+        Directories,
+        Directory,
+        Contents,
+        Entry
+    };
+
+    bool StartObject() override;
+    bool EndObject() override;
+    bool StartArray() override;
+    bool EndArray() override;
+    bool Key(std::string& key) override;
+    bool String(std::string& value) override;
+    bool Number(const std::string& text) override;
+    bool Bool(bool value) override;
+    bool Null() override;
+
+    bool Fail(const std::string& message);
+    bool Scalar(Json::Value&& value);
+    bool EndContainer();
+    void BeginHeaderValue(Json::Value&& value);
+    Json::Value& AddHeaderValue(Json::Value&& value);
+    void CommitEntry();
+    void CommitDirectory();
+    Manifest::Span Intern(const std::string& value);
+    uint32_t EntryCount() const { return static_cast<uint32_t>(manifest->entryPaths.size()); }
+
+    JsonStreamParser parser;
+    std::shared_ptr<Manifest> manifest;
+    // 路径与 URL 大量重复前缀相同的字符串，只在字符串区保存一份
+    std::unordered_map<std::string,Manifest::Span> interned;
+    Json::Value header;
+    std::vector<Scope> scopes;
+    std::vector<Json::Value*> headerValues;
+    std::string currentKey;
+    // 当前条目与目录的标量字段，目录字段可能出现在 contents 前后任意位置
+    Json::Value entryFields;
+    Json::Value directoryFields;
+    uint32_t directoryFirst;
+    // 用不到的嵌套容器只计深度，不保存内容
+    size_t skipDepth;
+    bool filesSeen;
+    bool directoriesSeen;
+    uint32_t filesBegin;
+    uint32_t filesEnd;
+    bool finished;
+    std::string error;
+};
+
+#endif
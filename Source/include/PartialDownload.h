@@ -0,0 +1,70 @@
+#ifndef PARTIALDOWNLOAD_H
+#define PARTIALDOWNLOAD_H
+
+#include <string>
+#include <memory>
+#include <cstdio>
+#include <curl/curl.h>
+#include "FileHasher.h"
+
+class PartialDownload {
+public:
+    PartialDownload(const std::string& url,const std::string& outputPath,const std::string& algorithm);
+    ~PartialDownload();
+
+    PartialDownload(const PartialDownload&)=delete;
+    PartialDownload& operator=(const PartialDownload&)=delete;
+
+    // 大小已知时，续传遇到 416 可据此判断 .part 是否已完整
+    void SetExpectedSize(long long size) { expectedSize=size; }
+    bool Open();
+    void Attach(CURL* handle);
+    void Detach();
+    bool Complete(CURLcode code,const std::string& expectedHash,std::string& digest,std::string& error);
+
+    bool CanResume() const { return resumable; }
+    // 续传响应的 Content-Range 与 .part 对不上，.part 已丢弃，应从头重新下载
+    bool NeedsRestart() const { return restartRequired; }
+    long long GetResumeOffset() const { return resumeOffset; }
+    long long GetReceivedBytes() const { return receivedBytes; }
+    long GetHttpStatus() const { return httpStatus; }
+    const std::string& GetPartPath() const { return partPath; }
+
+    static void Discard(const std::string& outputPath);
+
+private:
+    bool LoadState();
+    void SaveState();
+    bool ReopenForFullDownload();
+    const std::string& GetValidator() const;
+
+    static size_t WriteCallback(void* contents,size_t size,size_t nmemb,PartialDownload* download);
+    static size_t HeaderCallback(char* buffer,size_t size,size_t nitems,PartialDownload* download);
+
+    std::string url;
+    std::string outputPath;
+    std::string partPath;
+    std::string statePath;
+    std::string algorithm;
+    std::unique_ptr<FileHasher::StreamHasher> hasher;
+
+    CURL* handle;
+    FILE* file;
+    curl_slist* requestHeaders;
+    std::string etag;
+    std::string lastModified;
+    std::string responseEtag;
+    std::string responseLastModified;
+    long long expectedSize;
+    long long resumeOffset;
+    long long receivedBytes;
+    long long rangeStart;
+    long long rangeTotal;
+    long httpStatus;
+    bool bodyStarted;
+    bool writeFailed;
+    bool resumable;
+    bool restartRequired;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef SEGMENTEDDOWNLOAD_H
+#define SEGMENTEDDOWNLOAD_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <windows.h>
+#include <curl/curl.h>
+
+class SegmentedDownload {
+public:
+    struct Options {
+        int segmentCount=4;
+        long long minSegmentSize=16LL*1024*1024;
+        int maxAttempts=3;
+        long timeoutSeconds=0;
+    };
+
+    enum class Outcome {
+        Completed,
+        Unsupported,
+        Failed
+    };
+
+    using ProgressCallback=std::function<void(long long downloaded,long long total)>;
+
+    SegmentedDownload(const std::string& url,const std::string& outputPath,CURLSH* share,const Options& options);
+    ~SegmentedDownload();
+
+    SegmentedDownload(const SegmentedDownload&)=delete;
+    SegmentedDownload& operator=(const SegmentedDownload&)=delete;
+
+    Outcome Run(ProgressCallback progressCallback=nullptr);
+    long long GetTotalSize() const { return totalSize; }
+    int GetSegmentCount() const { return static_cast<int>(segments.size()); }
+
+private:
+    struct Segment {
+        SegmentedDownload* owner=nullptr;
+        CURL* easy=nullptr;
+        long long start=0;
+        long long end=0;
+        long long written=0;
+        int attempts=0;
+        bool statusChecked=false;
+    };
+
+    bool Probe();
+    bool Preallocate();
+    bool StartSegment(Segment& segment,CURLM* multi);
+    CURL* CreateHandle();
+    void CloseFile();
+
+    static size_t DiscardCallback(void* contents,size_t size,size_t nmemb,void* userdata);
+    static size_t WriteCallback(void* contents,size_t size,size_t nmemb,Segment* segment);
+
+    std::string url;
+    std::string outputPath;
+    std::string tempPath;
+    CURLSH* share;
+    Options options;
+    std::string validator;
+    curl_slist* requestHeaders;
+    long long totalSize;
+    std::vector<Segment> segments;
+    HANDLE fileHandle;
+    bool rangeIgnored;
+    bool writeFailed;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef STREAMINGZIPREADER_H
+#define STREAMINGZIPREADER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <zlib.h>
+
+// 下载线程与解压线程之间的有界字节管道，写满时生产者阻塞
+class StreamPipe {
+public:
+    explicit StreamPipe(size_t capacity);
+
+    // 消费者放弃后写入直接丢弃，不再阻塞
+    void Write(const unsigned char* data,size_t size);
+    // 生产者结束写入，success 为 false 表示下载失败
+    void Close(bool success);
+    // 阻塞直到有数据，返回 0 表示流已结束
+    size_t Read(unsigned char* buffer,size_t size);
+    void Abandon();
+
+private:
+    std::mutex mutex;
+    std::condition_variable readable;
+    std::condition_variable writable;
+    std::vector<unsigned char> ring;
+    size_t head;
+    size_t count;
+    bool closed;
+    bool abandoned;
+};
+
+// 按本地文件头顺序读取 ZIP 流，边读边解压；读到中央目录时与已读条目逐一核对
+// 只支持 stored/deflate，不支持加密条目以及带数据描述符的 stored 条目
+class StreamingZipReader {
+public:
+    using ReadFunction=std::function<size_t(unsigned char* buffer,size_t size)>;
+    using WriteFunction=std::function<void(const unsigned char* data,size_t size)>;
+
+    enum class Result {
+        Entry,
+        End,
+        Failed
+    };
+
+    struct Entry {
+        std::string name;
+        uint16_t flags=0;
+        uint16_t method=0;
+        uint32_t crc=0;
+        uint64_t compressedSize=0;
+        uint64_t uncompressedSize=0;
+        uint64_t headerOffset=0;
+        bool zip64=false;
+        // 为真时 crc 与大小要等数据读完、解析数据描述符后才有效
+        bool hasDataDescriptor=false;
+        bool isDirectory=false;
+        // 未声明 UTF-8 且含非 ASCII 字节的旧式文件名，编码无法确定
+        bool legacyName=false;
+    };
+
+    explicit StreamingZipReader(ReadFunction read);
+    ~StreamingZipReader();
+
+    StreamingZipReader(const StreamingZipReader&)=delete;
+    StreamingZipReader& operator=(const StreamingZipReader&)=delete;
+
+    // 读取下一个本地文件头；到达中央目录时完成核对并返回 End
+    Result Next(Entry& entry);
+    // 解压当前条目并校验 CRC 与大小，每次 Next 返回 Entry 后必须调用一次
+    bool ReadEntryData(const WriteFunction& write);
+
+    size_t GetEntryCount() const { return entries.size(); }
+    const std::string& GetError() const { return error; }
+
+private:
+    bool Fail(const std::string& message);
+    bool FillInput();
+    void Advance(size_t size);
+    bool ReadBytes(unsigned char* buffer,size_t size);
+    bool ReadString(std::string& value,size_t size);
+    bool SkipBytes(uint64_t size);
+    bool ReadDataDescriptor(Entry& entry);
+    bool ReadCentralDirectory(uint32_t signature);
+    static bool ApplyZip64Extra(const std::string& extra,uint64_t& uncompressedSize,
+        uint64_t& compressedSize,uint64_t* headerOffset);
+
+    ReadFunction read;
+    std::vector<unsigned char> input;
+    std::vector<unsigned char> output;
+    size_t inputPos;
+    size_t inputEnd;
+    uint64_t streamOffset;
+    z_stream inflater;
+    bool inflaterReady;
+    std::vector<Entry> entries;
+    std::unordered_map<uint64_t,size_t> entryByOffset;
+    std::string error;
+};
+
+#endif
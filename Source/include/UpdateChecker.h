@@ -5,6 +5,9 @@
 #include <json/json.h>
 #include "HttpClient.h"
 #include "ConfigManager.h"
+#include "ManifestCache.h"
+#include "ManifestParser.h"
+#include "BinaryManifest.h"
 #include "Logger.h"
 
 class UpdateChecker {
@@ -13,15 +16,17 @@ private:
 	HttpClient& httpClient;
 	ConfigManager& configManager;
 	bool enableApiCache;
+	ManifestCache manifestCache;
+	std::string binaryManifestPath;
 public:
-	UpdateChecker(const std::string& url,HttpClient& http,ConfigManager& config,bool apiCache=false);
+	UpdateChecker(const std::string& url,HttpClient& http,ConfigManager& config,bool apiCache=false,
+		const std::string& manifestCachePath="");
 
 	bool CheckForUpdates();
-	Json::Value FetchUpdateInfo();
+	// 下载的同时解析，成功后 parser 可 Build 出清单
+	bool FetchUpdateInfo(ManifestParser& parser);
+	bool FetchBinaryManifest(const Json::Value& updateInfo,BinaryManifest& manifest);
 	void DisplayChangelog(const Json::Value& changelog);
-
-private:
-	bool ParseUpdateInfo(const std::string& jsonData,Json::Value& updateInfo);
 };
 
 #endif
\ No newline at end of file
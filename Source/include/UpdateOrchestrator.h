@@ -2,6 +2,7 @@
 #define UPDATEORCHESTRATOR_H
 
 #include <string>
+#include <memory>
 #include <json/json.h>
 #include "ConfigManager.h"
 #include "HttpClient.h"
@@ -12,6 +13,8 @@
 #include "ZipExtractor.h"
 #include "IncrementalUpdatePlanner.h"
 #include "HashBasedFileSyncer.h"
+#include "HashIndex.h"
+#include "Manifest.h"
 
 class UpdateOrchestrator {
 public:
@@ -19,21 +22,22 @@ public:
     ~UpdateOrchestrator();
     bool CheckForUpdates();
     bool ForceUpdate(bool forceSync=false);
-    bool SyncFiles(const Json::Value& fileList,bool forceSync);
+    bool SyncFiles(const Manifest& manifest,bool forceSync);
     void OptimizeMemoryUsage();
+    void ResetHashIndex();
 
     const std::string& GetGameDirectory() const { return gameDirectory; }
-    Json::Value GetCachedUpdateInfo() const { return cachedUpdateInfo; }
-    bool HasCachedUpdateInfo() const { return hasCachedUpdateInfo; }
-    void SetCachedUpdateInfo(const Json::Value& info) { cachedUpdateInfo=info; hasCachedUpdateInfo=true; }
-    void ClearCachedUpdateInfo() { cachedUpdateInfo=Json::Value(); hasCachedUpdateInfo=false; }
+    std::shared_ptr<const Manifest> GetCachedManifest() const { return cachedManifest; }
+    bool HasCachedManifest() const { return cachedManifest!=nullptr; }
+    void SetCachedManifest(std::shared_ptr<const Manifest> manifest) { cachedManifest=std::move(manifest); }
+    void ClearCachedManifest() { cachedManifest.reset(); }
 private:
-    bool ProcessLauncherUpdate(const Json::Value& updateInfo);
+    std::shared_ptr<const Manifest> FetchManifest();
+    bool ProcessLauncherUpdate(const Manifest& manifest);
     bool CheckAndApplyLauncherUpdate();
     bool CheckForUpdatesByHash();
     void UpdateLocalVersion(const std::string& newVersion);
-    Json::Value cachedUpdateInfo;
-    bool hasCachedUpdateInfo;
+    std::shared_ptr<const Manifest> cachedManifest;
     std::string gameDirectory;
     ConfigManager configManager;
 
@@ -43,6 +47,7 @@ private:
     ProgressReporter progressReporter;
     FileSystemHelper fsHelper;
     ZipExtractor zipExtractor;
+    HashIndex hashIndex;
     HashBasedFileSyncer hashSyncer;
     IncrementalUpdatePlanner incrementalPlanner;
 
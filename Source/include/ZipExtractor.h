@@ -1,8 +1,15 @@
 #ifndef ZIPEXTRACTOR_H
 #define ZIPEXTRACTOR_H
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <filesystem>
+#include <functional>
+#include <zip.h>
 #include "HttpClient.h"
 #include "ProgressReporter.h"
 #include "FileSystemHelper.h"
+#include "StreamingZipReader.h"
 class ZipExtractor {
 public:
     bool IsValidZipFile(const std::string& filePath);
@@ -12,16 +19,74 @@ public:
         const std::string& extractPath);
     bool DownloadAndExtract(const std::string& url,const std::string& relativePath,const std::string& targetBaseDir);
     ZipExtractor(HttpClient& http,ProgressReporter& reporter);
+    // 0 表示按 CPU 核数
+    void SetExtractThreads(int threads) { extractThreads=threads; }
+    // ExtractZip 的数据不超过该大小时直接从内存解压，否则先落盘
+    void SetMemoryExtractLimit(long long bytes) { memoryExtractLimit=bytes; }
+    // 目录压缩包边下载边解压
+    void SetStreamingExtract(bool enable) { streamingExtract=enable; }
+    // 目标文件大小与 CRC-32 都和条目一致时不重写
+    void SetSkipUnchanged(bool enable) { skipUnchanged=enable; }
 private:
+    // 解压计划：一次遍历中央目录得到的已校验条目，解压阶段不再查名或解析路径
+    struct ZipEntryInfo {
+        zip_int64_t index;
+        std::string name;
+        std::wstring targetPath;
+        zip_uint64_t size;
+        zip_uint32_t crc;
+        bool hasCrc;
+        bool isDirectory;
+    };
+    struct ExtractState {
+        std::atomic<size_t> nextEntry{0};
+        std::atomic<int> processedFiles{0};
+        std::atomic<int> extractedFiles{0};
+        std::atomic<int> skippedFiles{0};
+        std::atomic<int> failedFiles{0};
+        std::atomic<int> unicodeFailedFiles{0};
+        std::atomic<bool> stop{false};
+        std::mutex progressMutex;
+        // 流式解压开始写入目标目录时记录，失败时据此恢复原状
+        bool targetTouched=false;
+        bool targetExisted=false;
+        bool backupSaved=false;
+    };
+    void BuildExtractPlan(zip_t* zip,zip_int64_t numEntries,const std::filesystem::path& canonicalBase,
+        std::vector<ZipEntryInfo>& plan,ExtractState& state);
+    void ExtractEntries(zip_t* zip,const std::vector<ZipEntryInfo>& plan,
+        const std::string& extractPath,ExtractState& state);
+    void ExtractEntry(zip_t* zip,const ZipEntryInfo& entry,const std::string& extractPath,
+        std::vector<char>& buffer,ExtractState& state);
     bool ExtractZipWithMiniz(const std::string& zipFilePath,
         const std::string& extractPath);
     bool ExtractZipSimple(const std::string& zipFilePath,
         const std::string& extractPath);
     bool ExtractZipOriginal(const std::string& zipFilePath,
         const std::string& extractPath);
+    bool ExtractZipFromMemory(const unsigned char* data,size_t size,
+        const std::string& extractPath);
+    // openArchive 每次调用返回一个新的只读句柄，供各解压线程独立使用
+    bool ExtractArchive(const std::function<zip_t*()>& openArchive,
+        const std::string& extractPath);
+    enum class StreamOutcome {
+        Extracted,
+        Fallback,
+        Failed
+    };
+    // 无法流式处理时返回 Fallback，此时完整的压缩包已保存在 spoolPath
+    StreamOutcome StreamDownloadAndExtract(const std::string& url,const std::string& relativePath,
+        const std::string& targetBaseDir,const std::string& spoolPath,bool& backedUp,ExtractState& state);
+    void RestoreStreamTarget(const std::string& extractPath,const ExtractState& state);
+    bool ExtractStream(StreamingZipReader& reader,const std::string& extractPath,bool& backedUp,
+        ExtractState& state);
     bool CheckServerResponse(const std::string& url);
     HttpClient& httpClient;
     FileSystemHelper fsHelper;
     ProgressReporter& pRepoter;
+    int extractThreads;
+    long long memoryExtractLimit;
+    bool streamingExtract;
+    bool skipUnchanged;
 };
 #endif
\ No newline at end of file
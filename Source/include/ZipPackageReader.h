@@ -0,0 +1,38 @@
+#ifndef ZIPPACKAGEREADER_H
+#define ZIPPACKAGEREADER_H
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <zip.h>
+
+// 只读打开的更新包，按条目名直接读取或安装单个文件，不展开到临时目录
+class ZipPackageReader {
+public:
+    ZipPackageReader();
+    ~ZipPackageReader();
+
+    ZipPackageReader(const ZipPackageReader&)=delete;
+    ZipPackageReader& operator=(const ZipPackageReader&)=delete;
+
+    bool Open(const std::string& zipFilePath);
+    void Close();
+    bool IsOpen() const { return zip!=nullptr; }
+
+    bool HasEntry(const std::string& name) const;
+    bool ReadEntry(const std::string& name,std::string& content);
+    // 目标文件大小与 CRC-32 都和条目一致
+    bool EntryMatchesFile(const std::string& name,const std::filesystem::path& targetPath) const;
+    // 先写到目标旁的临时文件再整体替换，失败时目标保持原样
+    bool ExtractEntryTo(const std::string& name,const std::filesystem::path& targetPath);
+
+private:
+    zip_int64_t Locate(const std::string& name) const;
+    template<typename Sink>
+    bool CopyEntry(zip_int64_t index,Sink&& sink);
+
+    zip_t* zip;
+    std::vector<char> buffer;
+};
+
+#endif
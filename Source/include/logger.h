@@ -4,16 +4,60 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <iomanip>
 #include <ctime>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <type_traits>
 
+// 编译期最低日志级别 (0=DEBUG 1=INFO 2=WARN 3=ERROR)，低于它的 LOG_xxx 语句整体被编译器消除
+#ifndef MCUPDATER_LOG_MIN_LEVEL
+#define MCUPDATER_LOG_MIN_LEVEL 0
+#endif
+
+enum class LogLevel {
+    Debug=0,
+    Info=1,
+    Warn=2,
+    Error=3
+};
+
+// 每个线程在本地拼好整行再入队，多线程日志不会交错；控制台同步输出，文件由后台线程批量写入
 class Logger {
 private:
+    // 有界无锁环形队列，多生产者入队，后台线程单独出队
+    struct Slot {
+        std::atomic<size_t> sequence;
+        std::string record;
+    };
+    static const size_t RING_CAPACITY=4096;
+
     std::ofstream logFile;
     std::string logFileName;
-    bool enabled;
-    bool isNewLine;
+    std::atomic<bool> enabled;
+
+    std::unique_ptr<Slot[]> ring;
+    std::atomic<size_t> enqueuePos;
+    std::atomic<size_t> dequeuePos;
+    std::atomic<size_t> flushedPos;
+    std::thread writerThread;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable flushedCondition;
+    std::atomic<bool> writerSleeping;
+    std::atomic<bool> flushRequested;
+    std::atomic<bool> stopping;
+    std::atomic<int> flushIntervalMs;
+    std::atomic<int> minLevel;
+
+    static thread_local std::string lineBuffer;
+    static thread_local size_t linePrefix;
+    static thread_local bool lineStarted;
 
 public:
     Logger();
@@ -21,47 +65,77 @@ public:
 
     bool Initialize(const std::string& filename);
     void Enable(bool enable);
+    // 0 表示每批记录写入后立即刷盘
+    void SetFlushInterval(int milliseconds);
+    // 阻塞直到此前的记录全部写入并刷盘
+    void Flush();
+    void Shutdown();
+
+    void SetLevel(LogLevel level) { minLevel.store(static_cast<int>(level),std::memory_order_relaxed); }
+    bool ShouldLog(LogLevel level) const {
+        return static_cast<int>(level)>=MCUPDATER_LOG_MIN_LEVEL&&
+            static_cast<int>(level)>=minLevel.load(std::memory_order_relaxed);
+    }
+    static bool ParseLevel(const std::string& name,LogLevel& level);
+    // 开始一条带级别前缀的记录，由 LOG_xxx 宏调用
+    Logger& BeginRecord(LogLevel level);
 
     template<typename T>
     Logger& operator<<(const T& message) {
-        std::ostringstream oss;
-        oss<<message;
-        std::string msgStr=oss.str();
-
-        if(enabled&&logFile.is_open()) {
-            if(isNewLine) {
-                logFile<<GetTimestamp()<<" "<<msgStr;
-                isNewLine=false;
-            }
-            else {
-                logFile<<msgStr;
-            }
-            logFile.flush();
+        if(!lineStarted) {
+            BeginLine();
         }
-
-        std::cout<<msgStr;
-
+        AppendValue(lineBuffer,message);
         return *this;
     }
 
     Logger& operator<<(std::ostream& (*manip)(std::ostream&)) {
-        if(enabled&&logFile.is_open()) {
-            manip(logFile);
-            logFile.flush();
-        }
-
         if(manip==static_cast<std::ostream&(*)(std::ostream&)>(std::endl)) {
-            isNewLine=true;
+            EndLine();
+        }
+        else {
+            manip(std::cout);
         }
-
-        manip(std::cout);
         return *this;
     }
 
 private:
-    std::string GetTimestamp();
+    template<typename T>
+    static void AppendValue(std::string& line,const T& value) {
+        if constexpr(std::is_convertible_v<const T&,std::string_view>) {
+            line.append(std::string_view(value));
+        }
+        else if constexpr(std::is_same_v<T,char>||std::is_same_v<T,signed char>||std::is_same_v<T,unsigned char>) {
+            line.push_back(static_cast<char>(value));
+        }
+        else if constexpr(std::is_integral_v<T>) {
+            line.append(std::to_string(value));
+        }
+        else {
+            std::ostringstream oss;
+            oss<<value;
+            line.append(oss.str());
+        }
+    }
+
+    void BeginLine();
+    void EndLine();
+    bool TryEnqueue(std::string& record);
+    void WakeWriter();
+    void WriterLoop();
+    void AppendTimestamp(std::string& line);
 };
 
 extern Logger g_logger;
 
+// 级别被过滤时整条语句（包括参数求值与格式化）都不会执行
+#define LOG_AT(level) \
+    if(!g_logger.ShouldLog(level)) {} \
+    else g_logger.BeginRecord(level)
+
+#define LOG_DEBUG LOG_AT(LogLevel::Debug)
+#define LOG_INFO LOG_AT(LogLevel::Info)
+#define LOG_WARN LOG_AT(LogLevel::Warn)
+#define LOG_ERROR LOG_AT(LogLevel::Error)
+
 #endif
\ No newline at end of file
@@ -0,0 +1,453 @@
+﻿#include "BinaryManifest.h"
+#include <filesystem>
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include "FileHasher.h"
+#include "Logger.h"
+
+namespace {
+    const char MAGIC[4]={'M','C','B','M'};
+    const uint32_t MAX_DIGEST_SIZE=64;
+    const unsigned char ENTRY_HAS_DIGEST=1;
+    const unsigned char DIRECTORY_IS_EMPTY=1;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        char algorithm[16];
+        uint32_t digestSize;
+        uint32_t fileCount;
+        uint32_t directoryCount;
+        uint32_t entryCount;
+        uint64_t stringsSize;
+        uint64_t totalSize;
+        uint64_t reserved;
+    };
+    static_assert(sizeof(Header)==64,"BinaryManifest header must stay 64 bytes");
+
+    // 各表的偏移只由计数决定，文件里不再单独存储
+    struct Layout {
+        uint64_t entryPaths;
+        uint64_t entryUrls;
+        uint64_t entrySizes;
+        uint64_t entryDigests;
+        uint64_t entryFlags;
+        uint64_t directoryPaths;
+        uint64_t directoryUrls;
+        uint64_t directoryContents;
+        uint64_t directoryFlags;
+        uint64_t strings;
+        uint64_t end;
+    };
+
+    uint64_t Align8(uint64_t value) {
+        return (value+7)&~7ULL;
+    }
+
+    Layout ComputeLayout(uint32_t digestSize,uint32_t entryCount,uint32_t directoryCount,uint64_t stringsSize) {
+        Layout layout;
+        uint64_t offset=sizeof(Header);
+        layout.entryPaths=offset;
+        offset+=8ULL*entryCount;
+        layout.entryUrls=offset;
+        offset+=8ULL*entryCount;
+        layout.entrySizes=offset;
+        offset+=8ULL*entryCount;
+        layout.entryDigests=offset;
+        offset=Align8(offset+static_cast<uint64_t>(digestSize)*entryCount);
+        layout.entryFlags=offset;
+        offset=Align8(offset+entryCount);
+        layout.directoryPaths=offset;
+        offset+=8ULL*directoryCount;
+        layout.directoryUrls=offset;
+        offset+=8ULL*directoryCount;
+        layout.directoryContents=offset;
+        offset+=8ULL*directoryCount;
+        layout.directoryFlags=offset;
+        offset=Align8(offset+directoryCount);
+        layout.strings=offset;
+        layout.end=offset+stringsSize;
+        return layout;
+    }
+
+    int HexValue(char c) {
+        if(c>='0'&&c<='9') return c-'0';
+        if(c>='a'&&c<='f') return c-'a'+10;
+        if(c>='A'&&c<='F') return c-'A'+10;
+        return -1;
+    }
+
+    bool ComparePaths(const Json::Value* left,const Json::Value* right) {
+        return (*left)["path"].asString()<(*right)["path"].asString();
+    }
+
+    std::vector<const Json::Value*> SortedByPath(const Json::Value& list) {
+        std::vector<const Json::Value*> sorted;
+        if(list.isArray()) {
+            sorted.reserve(list.size());
+            for(const auto& item:list) {
+                if(item.isObject()) {
+                    sorted.push_back(&item);
+                }
+            }
+        }
+        std::stable_sort(sorted.begin(),sorted.end(),ComparePaths);
+        return sorted;
+    }
+}
+
+BinaryManifest::BinaryManifest()
+    : base(nullptr),
+    size(0),
+    fileHandle(INVALID_HANDLE_VALUE),
+    mappingHandle(NULL),
+    digestSize(0),
+    fileCount(0),
+    directoryCount(0),
+    entryCount(0),
+    entryPaths(nullptr),
+    entryUrls(nullptr),
+    entrySizes(nullptr),
+    entryDigests(nullptr),
+    entryFlags(nullptr),
+    directoryPaths(nullptr),
+    directoryUrls(nullptr),
+    directoryContents(nullptr),
+    directoryFlags(nullptr),
+    strings(nullptr),
+    stringsSize(0) {
+}
+
+BinaryManifest::~BinaryManifest() {
+    Close();
+}
+
+bool BinaryManifest::LoadFromFile(const std::string& path) {
+    Close();
+
+    std::wstring widePath=std::filesystem::path(path).wstring();
+    fileHandle=CreateFileW(widePath.c_str(),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+    if(fileHandle==INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(fileHandle,&fileSize)||fileSize.QuadPart<static_cast<LONGLONG>(sizeof(Header))) {
+        Close();
+        return false;
+    }
+
+    mappingHandle=CreateFileMappingW(fileHandle,NULL,PAGE_READONLY,0,0,NULL);
+    if(!mappingHandle) {
+        Close();
+        return false;
+    }
+    const void* view=MapViewOfFile(mappingHandle,FILE_MAP_READ,0,0,0);
+    if(!view) {
+        Close();
+        return false;
+    }
+
+    // 先记下映射地址，解析失败时由 Close 统一解除映射
+    base=static_cast<const unsigned char*>(view);
+    size=static_cast<size_t>(fileSize.QuadPart);
+    if(!Parse(base,size)) {
+        LOG_WARN<<"二进制清单格式无效: "<<path<<std::endl;
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool BinaryManifest::LoadFromBuffer(std::vector<unsigned char>&& buffer) {
+    Close();
+    ownedBuffer=std::move(buffer);
+    if(!Parse(ownedBuffer.data(),ownedBuffer.size())) {
+        LOG_WARN<<"二进制清单格式无效"<<std::endl;
+        Close();
+        return false;
+    }
+    base=ownedBuffer.data();
+    size=ownedBuffer.size();
+    return true;
+}
+
+void BinaryManifest::Close() {
+    if(mappingHandle&&base) {
+        UnmapViewOfFile(base);
+    }
+    if(mappingHandle) {
+        CloseHandle(mappingHandle);
+        mappingHandle=NULL;
+    }
+    if(fileHandle!=INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+        fileHandle=INVALID_HANDLE_VALUE;
+    }
+    ownedBuffer.clear();
+    ownedBuffer.shrink_to_fit();
+    base=nullptr;
+    size=0;
+    algorithm.clear();
+    digestSize=0;
+    fileCount=0;
+    directoryCount=0;
+    entryCount=0;
+}
+
+bool BinaryManifest::Parse(const unsigned char* data,size_t dataSize) {
+    if(dataSize<sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    memcpy(&header,data,sizeof(Header));
+    if(memcmp(header.magic,MAGIC,sizeof(MAGIC))!=0||header.version!=FORMAT_VERSION) {
+        return false;
+    }
+    if(header.digestSize==0||header.digestSize>MAX_DIGEST_SIZE||
+        header.fileCount>header.entryCount||header.totalSize!=dataSize||header.stringsSize>dataSize) {
+        return false;
+    }
+    if(memchr(header.algorithm,'\0',sizeof(header.algorithm))==nullptr) {
+        return false;
+    }
+
+    // 各计数均为 32 位，只有 stringsSize 可能让 end 回绕，先限住它再比较
+    Layout layout=ComputeLayout(header.digestSize,header.entryCount,header.directoryCount,header.stringsSize);
+    if(layout.strings>dataSize||layout.end!=dataSize) {
+        return false;
+    }
+
+    algorithm=header.algorithm;
+    digestSize=header.digestSize;
+    fileCount=header.fileCount;
+    directoryCount=header.directoryCount;
+    entryCount=header.entryCount;
+    entryPaths=reinterpret_cast<const StringRef*>(data+layout.entryPaths);
+    entryUrls=reinterpret_cast<const StringRef*>(data+layout.entryUrls);
+    entrySizes=reinterpret_cast<const int64_t*>(data+layout.entrySizes);
+    entryDigests=data+layout.entryDigests;
+    entryFlags=data+layout.entryFlags;
+    directoryPaths=reinterpret_cast<const StringRef*>(data+layout.directoryPaths);
+    directoryUrls=reinterpret_cast<const StringRef*>(data+layout.directoryUrls);
+    directoryContents=reinterpret_cast<const ContentRange*>(data+layout.directoryContents);
+    directoryFlags=data+layout.directoryFlags;
+    strings=reinterpret_cast<const char*>(data+layout.strings);
+    stringsSize=header.stringsSize;
+
+    // 加载时一次性检查所有引用，之后的访问不再做边界判断
+    auto validString=[this](const StringRef& ref) {
+        return static_cast<uint64_t>(ref.offset)+ref.length<=stringsSize;
+        };
+    for(uint32_t i=0; i<entryCount; i++) {
+        if(!validString(entryPaths[i])||!validString(entryUrls[i])) {
+            return false;
+        }
+    }
+    for(uint32_t i=0; i<directoryCount; i++) {
+        const ContentRange& range=directoryContents[i];
+        if(!validString(directoryPaths[i])||!validString(directoryUrls[i])) {
+            return false;
+        }
+        if(range.first<fileCount||static_cast<uint64_t>(range.first)+range.count>entryCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view BinaryManifest::GetString(const StringRef& ref) const {
+    return std::string_view(strings+ref.offset,ref.length);
+}
+
+BinaryManifest::FileEntry BinaryManifest::GetEntry(uint32_t index) const {
+    FileEntry entry;
+    entry.path=GetString(entryPaths[index]);
+    entry.url=GetString(entryUrls[index]);
+    entry.size=entrySizes[index];
+    entry.digest=(entryFlags[index]&ENTRY_HAS_DIGEST)?entryDigests+static_cast<size_t>(index)*digestSize:nullptr;
+    return entry;
+}
+
+BinaryManifest::DirectoryEntry BinaryManifest::GetDirectory(uint32_t index) const {
+    DirectoryEntry entry;
+    entry.path=GetString(directoryPaths[index]);
+    entry.url=GetString(directoryUrls[index]);
+    entry.firstContent=directoryContents[index].first;
+    entry.contentCount=directoryContents[index].count;
+    entry.isEmpty=(directoryFlags[index]&DIRECTORY_IS_EMPTY)!=0;
+    return entry;
+}
+
+uint32_t BinaryManifest::FindFile(std::string_view path) const {
+    uint32_t low=0;
+    uint32_t high=fileCount;
+    while(low<high) {
+        uint32_t middle=low+(high-low)/2;
+        int order=GetString(entryPaths[middle]).compare(path);
+        if(order==0) {
+            return middle;
+        }
+        if(order<0) {
+            low=middle+1;
+        }
+        else {
+            high=middle;
+        }
+    }
+    return NO_ENTRY;
+}
+
+bool BinaryManifest::DigestMatches(const unsigned char* digest,const std::string& hex) const {
+    if(!digest||hex.size()!=static_cast<size_t>(digestSize)*2) {
+        return false;
+    }
+    for(uint32_t i=0; i<digestSize; i++) {
+        int high=HexValue(hex[i*2]);
+        int low=HexValue(hex[i*2+1]);
+        if(high<0||low<0||digest[i]!=((high<<4)|low)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BinaryManifest::DigestToHex(const unsigned char* digest,std::string& hex) const {
+    static const char digits[]="0123456789abcdef";
+    if(!digest) {
+        hex.clear();
+        return;
+    }
+    hex.resize(static_cast<size_t>(digestSize)*2);
+    for(uint32_t i=0; i<digestSize; i++) {
+        hex[i*2]=digits[digest[i]>>4];
+        hex[i*2+1]=digits[digest[i]&0x0F];
+    }
+}
+
+bool BinaryManifest::Build(const Json::Value& fileManifest,const Json::Value& directoryManifest,
+    const std::string& algorithm,std::vector<unsigned char>& output,std::string& error) {
+    output.clear();
+
+    FileHasher::StreamHasher probe(algorithm);
+    if(!probe.IsValid()||algorithm.size()>=sizeof(Header::algorithm)) {
+        error="不支持的哈希算法: "+algorithm;
+        return false;
+    }
+    uint32_t digestSize=static_cast<uint32_t>(probe.Final().size()/2);
+
+    std::vector<const Json::Value*> files=SortedByPath(fileManifest);
+    std::vector<const Json::Value*> directories=SortedByPath(directoryManifest);
+
+    std::vector<const Json::Value*> entries=files;
+    std::vector<ContentRange> ranges;
+    ranges.reserve(directories.size());
+    for(const Json::Value* dirInfo:directories) {
+        std::vector<const Json::Value*> contents=SortedByPath((*dirInfo)["contents"]);
+        ranges.push_back({static_cast<uint32_t>(entries.size()),static_cast<uint32_t>(contents.size())});
+        entries.insert(entries.end(),contents.begin(),contents.end());
+    }
+    if(entries.size()>=NO_ENTRY||directories.size()>=NO_ENTRY) {
+        error="清单条目过多";
+        return false;
+    }
+
+    // 相同字符串只存一份，目录内容里常见的同名文件共享同一段
+    std::string stringTable;
+    std::unordered_map<std::string,StringRef> interned;
+    auto intern=[&](const std::string& value) {
+        auto it=interned.find(value);
+        if(it!=interned.end()) {
+            return it->second;
+        }
+        StringRef ref={static_cast<uint32_t>(stringTable.size()),static_cast<uint32_t>(value.size())};
+        stringTable+=value;
+        interned.emplace(value,ref);
+        return ref;
+        };
+
+    uint32_t entryCount=static_cast<uint32_t>(entries.size());
+    uint32_t directoryCount=static_cast<uint32_t>(directories.size());
+    std::vector<StringRef> entryPaths(entryCount);
+    std::vector<StringRef> entryUrls(entryCount);
+    std::vector<int64_t> entrySizes(entryCount);
+    std::vector<unsigned char> entryDigests(static_cast<size_t>(entryCount)*digestSize);
+    std::vector<unsigned char> entryFlags(entryCount);
+
+    for(uint32_t i=0; i<entryCount; i++) {
+        const Json::Value& info=*entries[i];
+        entryPaths[i]=intern(info["path"].asString());
+        entryUrls[i]=intern(info["url"].asString());
+        entrySizes[i]=info.isMember("size")?info["size"].asInt64():-1;
+
+        std::string hash=info["hash"].asString();
+        if(hash.empty()) {
+            continue;
+        }
+        if(hash.size()!=static_cast<size_t>(digestSize)*2) {
+            error="哈希长度与算法不符: "+info["path"].asString();
+            return false;
+        }
+        unsigned char* digest=entryDigests.data()+static_cast<size_t>(i)*digestSize;
+        for(uint32_t j=0; j<digestSize; j++) {
+            int high=HexValue(hash[j*2]);
+            int low=HexValue(hash[j*2+1]);
+            if(high<0||low<0) {
+                error="哈希不是十六进制: "+info["path"].asString();
+                return false;
+            }
+            digest[j]=static_cast<unsigned char>((high<<4)|low);
+        }
+        entryFlags[i]=ENTRY_HAS_DIGEST;
+    }
+
+    std::vector<StringRef> directoryPaths(directoryCount);
+    std::vector<StringRef> directoryUrls(directoryCount);
+    std::vector<unsigned char> directoryFlags(directoryCount);
+    for(uint32_t i=0; i<directoryCount; i++) {
+        const Json::Value& info=*directories[i];
+        directoryPaths[i]=intern(info["path"].asString());
+        directoryUrls[i]=intern(info["url"].asString());
+        directoryFlags[i]=(info.isMember("is_empty")&&info["is_empty"].asBool())?DIRECTORY_IS_EMPTY:0;
+    }
+
+    if(stringTable.size()>=0xFFFFFFFFULL) {
+        error="字符串表超过 4GB";
+        return false;
+    }
+
+    Header header={};
+    memcpy(header.magic,MAGIC,sizeof(MAGIC));
+    header.version=FORMAT_VERSION;
+    memcpy(header.algorithm,algorithm.c_str(),algorithm.size());
+    header.digestSize=digestSize;
+    header.fileCount=static_cast<uint32_t>(files.size());
+    header.directoryCount=directoryCount;
+    header.entryCount=entryCount;
+    header.stringsSize=stringTable.size();
+
+    Layout layout=ComputeLayout(digestSize,entryCount,directoryCount,header.stringsSize);
+    header.totalSize=layout.end;
+
+    output.assign(static_cast<size_t>(layout.end),0);
+    unsigned char* data=output.data();
+    auto copyTable=[data](uint64_t offset,const void* source,size_t bytes) {
+        if(bytes>0) {
+            memcpy(data+offset,source,bytes);
+        }
+        };
+    copyTable(0,&header,sizeof(Header));
+    copyTable(layout.entryPaths,entryPaths.data(),entryPaths.size()*sizeof(StringRef));
+    copyTable(layout.entryUrls,entryUrls.data(),entryUrls.size()*sizeof(StringRef));
+    copyTable(layout.entrySizes,entrySizes.data(),entrySizes.size()*sizeof(int64_t));
+    copyTable(layout.entryDigests,entryDigests.data(),entryDigests.size());
+    copyTable(layout.entryFlags,entryFlags.data(),entryFlags.size());
+    copyTable(layout.directoryPaths,directoryPaths.data(),directoryPaths.size()*sizeof(StringRef));
+    copyTable(layout.directoryUrls,directoryUrls.data(),directoryUrls.size()*sizeof(StringRef));
+    copyTable(layout.directoryContents,ranges.data(),ranges.size()*sizeof(ContentRange));
+    copyTable(layout.directoryFlags,directoryFlags.data(),directoryFlags.size());
+    copyTable(layout.strings,stringTable.data(),stringTable.size());
+    return true;
+}
\ No newline at end of file
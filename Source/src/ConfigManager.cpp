@@ -3,18 +3,22 @@
 #include <fstream>
 #include <filesystem>
 
-ConfigManager::ConfigManager(const std::string& configPath):configPath(configPath),configLoaded(false) {
+ConfigManager::ConfigManager(const std::string& configPath):configPath(configPath),configLoaded(false),currentSnapshot(nullptr) {
+    // 加载失败时也发布一份默认快照，GetSnapshot 永远有值
+    PublishSnapshotLocked();
+
     if(configPath.empty()) {
-        g_logger<<"[ERROR]配置文件路径为空!"<<std::endl;
+        LOG_ERROR<<"配置文件路径为空!"<<std::endl;
         return;
     }
 
     if(!EnsureConfigDirectory()) {
-        g_logger<<"[ERROR]无法创建配置目录"<<std::endl;
+        LOG_ERROR<<"无法创建配置目录"<<std::endl;
         return;
     }
 
     LoadConfig();
+    PublishSnapshotLocked();
 }
 
 ConfigManager::~ConfigManager() {
@@ -24,13 +28,13 @@ ConfigManager::~ConfigManager() {
 
 bool ConfigManager::LoadConfig() {
     if(configPath.empty()) {
-        g_logger<<"[ERROR]配置文件路径为空"<<std::endl;
+        LOG_ERROR<<"配置文件路径为空"<<std::endl;
         return false;
     }
 
     std::ifstream file(configPath);
     if(!file.is_open()) {
-        g_logger<<"[WARN]无法打开配置文件: "<<configPath<<std::endl;
+        LOG_WARN<<"无法打开配置文件: "<<configPath<<std::endl;
         return false;
     }
 
@@ -38,7 +42,7 @@ bool ConfigManager::LoadConfig() {
     std::string errors;
 
     if(!Json::parseFromStream(reader,file,&cachedConfig,&errors)) {
-        g_logger<<"[ERROR]配置解析错误: "<<errors<<std::endl;
+        LOG_ERROR<<"配置解析错误: "<<errors<<std::endl;
         file.close();
         return false;
     }
@@ -49,141 +53,156 @@ bool ConfigManager::LoadConfig() {
 }
 
 Json::Value ConfigManager::ReadConfig(){
+    std::lock_guard<std::mutex> lock(writeMutex);
     if(configLoaded) {
         return cachedConfig;
     }
 
     if(LoadConfig()) {
+        PublishSnapshotLocked();
         return cachedConfig;
     }
 
     return Json::Value();
 }
 
-std::string ConfigManager::ReadVersion(){
-    Json::Value config=ReadConfig();
-    if(config.isMember("version")){
-        return config["version"].asString();
+void ConfigManager::PublishSnapshotLocked() {
+    const Json::Value& config=cachedConfig;
+    std::unique_ptr<ConfigSnapshot> snapshot(new ConfigSnapshot());
+    auto readString=[&config](const char* key,std::string& value) {
+        if(config.isMember(key)) value=config[key].asString();
+        };
+    auto readBool=[&config](const char* key,bool& value) {
+        if(config.isMember(key)) value=config[key].asBool();
+        };
+    auto readInt=[&config](const char* key,int& value) {
+        if(config.isMember(key)) value=config[key].asInt();
+        };
+
+    if(config.isObject()) {
+        readString("version",snapshot->version);
+        readString("launcher_version",snapshot->launcherVersion);
+        readString("update_url",snapshot->updateUrl);
+        readString("game_directory",snapshot->gameDirectory);
+        readBool("auto_update",snapshot->autoUpdate);
+        readString("log_file",snapshot->logFile);
+        readString("update_mode",snapshot->updateMode);
+        readString("hash_algorithm",snapshot->hashAlgorithm);
+        readBool("enable_file_deletion",snapshot->enableFileDeletion);
+        readBool("skip_major_version_check",snapshot->skipMajorVersionCheck);
+        readBool("enable_api_cache",snapshot->enableApiCache);
+        readInt("api_timeout",snapshot->apiTimeout);
+        readInt("verify_threads",snapshot->verifyThreads);
+        readBool("enable_hash_index",snapshot->enableHashIndex);
+        readInt("max_concurrent_downloads",snapshot->maxConcurrentDownloads);
+        readInt("download_retries",snapshot->downloadRetries);
+        readInt("download_segments",snapshot->downloadSegments);
+        readInt("segment_min_size_mb",snapshot->segmentMinSizeMB);
+        readBool("enable_manifest_cache",snapshot->enableManifestCache);
+        readInt("log_flush_interval_ms",snapshot->logFlushIntervalMs);
+        readString("log_level",snapshot->logLevel);
+        readInt("extract_threads",snapshot->extractThreads);
+        readInt("memory_extract_max_mb",snapshot->memoryExtractMaxMB);
+        readBool("streaming_extract",snapshot->streamingExtract);
+        readBool("skip_unchanged_files",snapshot->skipUnchangedFiles);
+        readBool("coalesce_incremental_packages",snapshot->coalescePackages);
+        readInt("incremental_hop_cost_kb",snapshot->incrementalHopCostKB);
+        readInt("prefetch_packages",snapshot->prefetchPackages);
+        readInt("temp_disk_budget_mb",snapshot->tempDiskBudgetMB);
     }
-    return "1.0.0";
+
+    currentSnapshot.store(snapshot.get(),std::memory_order_release);
+    snapshots.push_back(std::move(snapshot));
+}
+
+std::string ConfigManager::ReadVersion(){
+    return GetSnapshot().version;
 }
 
 std::string ConfigManager::ReadUpdateUrl(){
-    Json::Value config=ReadConfig();
-    if(config.isMember("update_url")){
-        return config["update_url"].asString();
-    }
-    return "";
+    return GetSnapshot().updateUrl;
 }
 
 std::string ConfigManager::ReadGameDirectory(){
-    Json::Value config=ReadConfig();
-    if(config.isMember("game_directory")){
-        return config["game_directory"].asString();
-    }
-    return "./.minecraft";
+    return GetSnapshot().gameDirectory;
 }
 
 bool ConfigManager::ReadAutoUpdate(){
-    Json::Value config=ReadConfig();
-    if(config.isMember("auto_update")){
-        return config["auto_update"].asBool();
-    }
-    return true;
+    return GetSnapshot().autoUpdate;
 }
 
 std::string ConfigManager::ReadLogFile(){
-    Json::Value config=ReadConfig();
-    if(config.isMember("log_file")){
-        return config["log_file"].asString();
-    }
-    return "./logs/updater.log";
+    return GetSnapshot().logFile;
 }
 
 std::string ConfigManager::ReadUpdateMode() {
-    Json::Value config=ReadConfig();
-    if(config.isMember("update_mode")) {
-        return config["update_mode"].asString();
-    }
-    return "hash";
+    return GetSnapshot().updateMode;
 }
 
 std::string ConfigManager::ReadHashAlgorithm() {
-    Json::Value config=ReadConfig();
-    if(config.isMember("hash_algorithm")) {
-        return config["hash_algorithm"].asString();
-    }
-    return "sha256";
+    return GetSnapshot().hashAlgorithm;
 }
 
 bool ConfigManager::ReadEnableFileDeletion() {
-    Json::Value config=ReadConfig();
-    if(config.isMember("enable_file_deletion")) {
-        return config["enable_file_deletion"].asBool();
-    }
-    return true;
+    return GetSnapshot().enableFileDeletion;
 }
 
 bool ConfigManager::ReadSkipMajorVersionCheck() {
-    Json::Value config=ReadConfig();
-    if(config.isMember("skip_major_version_check")) {
-        return config["skip_major_version_check"].asBool();
-    }
-    return false;
+    return GetSnapshot().skipMajorVersionCheck;
 }
 
 bool ConfigManager::WriteVersion(const std::string& version){
-    Json::Value config=ReadConfig();
-    config["version"]=version;
-    return WriteConfig(config);
+    return UpdateConfig([&](Json::Value& config) {
+        config["version"]=version;
+        });
 }
 
 bool ConfigManager::WriteUpdateUrl(const std::string& url){
-    Json::Value config=ReadConfig();
-    config["update_url"]=url;
-    return WriteConfig(config);
+    return UpdateConfig([&](Json::Value& config) {
+        config["update_url"]=url;
+        });
 }
 
 bool ConfigManager::WriteGameDirectory(const std::string& dir){
-    Json::Value config=ReadConfig();
-    config["game_directory"]=dir;
-    return WriteConfig(config);
+    return UpdateConfig([&](Json::Value& config) {
+        config["game_directory"]=dir;
+        });
 }
 
 bool ConfigManager::WriteAutoUpdate(bool autoUpdate){
-    Json::Value config=ReadConfig();
-    config["auto_update"]=autoUpdate;
-    return WriteConfig(config);
+    return UpdateConfig([&](Json::Value& config) {
+        config["auto_update"]=autoUpdate;
+        });
 }
 
 bool ConfigManager::WriteLogFile(const std::string& logPath){
-    Json::Value config=ReadConfig();
-    config["log_file"]=logPath;
-    return WriteConfig(config);
+    return UpdateConfig([&](Json::Value& config) {
+        config["log_file"]=logPath;
+        });
 }
 
 bool ConfigManager::WriteUpdateMode(const std::string& mode) {
-    Json::Value config=ReadConfig();
-    config["update_mode"]=mode;
-    return WriteConfig(config);
+    return UpdateConfig([&](Json::Value& config) {
+        config["update_mode"]=mode;
+        });
 }
 
 bool ConfigManager::WriteHashAlgorithm(const std::string& algorithm) {
-    Json::Value config=ReadConfig();
-    config["hash_algorithm"]=algorithm;
-    return WriteConfig(config);
+    return UpdateConfig([&](Json::Value& config) {
+        config["hash_algorithm"]=algorithm;
+        });
 }
 
 bool ConfigManager::WriteEnableFileDeletion(bool enable) {
-    Json::Value config=ReadConfig();
-    config["enable_file_deletion"]=enable;
-    return WriteConfig(config);
+    return UpdateConfig([&](Json::Value& config) {
+        config["enable_file_deletion"]=enable;
+        });
 }
 
 bool ConfigManager::WriteSkipMajorVersionCheck(bool skip) {
-    Json::Value config=ReadConfig();
-    config["skip_major_version_check"]=skip;
-    return WriteConfig(config);
+    return UpdateConfig([&](Json::Value& config) {
+        config["skip_major_version_check"]=skip;
+        });
 }
 
 bool ConfigManager::ConfigExists(){
@@ -192,17 +211,17 @@ bool ConfigManager::ConfigExists(){
 
 bool ConfigManager::InitializeDefaultConfig(){
     if(!EnsureConfigDirectory()){
-        g_logger<<"[ERROR]无法创建配置目录"<<std::endl;
+        LOG_ERROR<<"无法创建配置目录"<<std::endl;
         return false;
     }
 
     Json::Value defaultConfig=CreateDefaultConfig();
     bool result=WriteConfig(defaultConfig);
     if(result){
-        g_logger<<"[信息]已创建默认配置文件:"<<configPath<<std::endl;
+        LOG_INFO<<"已创建默认配置文件:"<<configPath<<std::endl;
     }
     else{
-        g_logger<<"[ERROR]创建默认配置文件失败"<<std::endl;
+        LOG_ERROR<<"创建默认配置文件失败"<<std::endl;
     }
     return result;
 }
@@ -221,46 +240,91 @@ Json::Value ConfigManager::CreateDefaultConfig(){
     config["skip_major_version_check"]=false;
     config["enable_api_cache"]=true;
     config["api_timeout"]=600;
+    config["verify_threads"]=0;
+    config["enable_hash_index"]=true;
+    config["max_concurrent_downloads"]=8;
+    config["download_retries"]=3;
+    config["download_segments"]=4;
+    config["segment_min_size_mb"]=16;
+    config["enable_manifest_cache"]=true;
+    config["log_flush_interval_ms"]=1000;
+    config["log_level"]="info";
+    config["extract_threads"]=0;
+    config["memory_extract_max_mb"]=256;
+    config["streaming_extract"]=true;
+    config["skip_unchanged_files"]=true;
+    config["coalesce_incremental_packages"]=true;
+    config["incremental_hop_cost_kb"]=0;
+    config["prefetch_packages"]=1;
+    config["temp_disk_budget_mb"]=4096;
     return config;
 }
 
 std::string ConfigManager::ReadLauncherVersion() {
-    Json::Value config=ReadConfig();
-    if(config.isMember("launcher_version")) {
-        return config["launcher_version"].asString();
-    }
-    return "0.0.1";
+    return GetSnapshot().launcherVersion;
 }
 
 bool ConfigManager::WriteLauncherVersion(const std::string& version) {
-    Json::Value config=ReadConfig();
-    config["launcher_version"]=version;
-    return WriteConfig(config);
+    return UpdateConfig([&](Json::Value& config) {
+        config["launcher_version"]=version;
+        });
 }
 
 bool ConfigManager::WriteConfig(const Json::Value& config){
-    if(!EnsureConfigDirectory()){
-        return false;
+    std::lock_guard<std::mutex> lock(writeMutex);
+    cachedConfig=config;
+    configLoaded=true;
+    PublishSnapshotLocked();
+    return SaveConfigLocked();
+}
+
+bool ConfigManager::UpdateConfig(const std::function<void(Json::Value&)>& edit) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if(!configLoaded) {
+        LoadConfig();
     }
+    edit(cachedConfig);
+    configLoaded=true;
+    PublishSnapshotLocked();
+    return SaveConfigLocked();
+}
 
+bool ConfigManager::SaveConfigLocked() {
     if(configPath.empty()) {
-        g_logger<<"[ERROR]配置文件路径为空"<<std::endl;
+        LOG_ERROR<<"配置文件路径为空"<<std::endl;
+        return false;
+    }
+
+    if(!EnsureConfigDirectory()){
         return false;
     }
 
-    std::ofstream file(configPath);
+    // 先写临时文件再替换，中途失败不会留下半个配置文件
+    std::string tempPath=configPath+".tmp";
+    std::ofstream file(tempPath,std::ios::binary|std::ios::trunc);
     if(!file.is_open()){
-        g_logger<<"[ERROR]无法打开配置文件进行写入: "<<configPath<<std::endl;
+        LOG_ERROR<<"无法打开配置文件进行写入: "<<tempPath<<std::endl;
         return false;
     }
 
     Json::StreamWriterBuilder writer;
-    std::string jsonString=Json::writeString(writer,config);
+    std::string jsonString=Json::writeString(writer,cachedConfig);
     file<<jsonString;
     file.close();
 
-    cachedConfig=config;
-    configLoaded=true;
+    std::error_code ec;
+    if(!file.good()) {
+        LOG_ERROR<<"写入配置文件失败: "<<tempPath<<std::endl;
+        std::filesystem::remove(tempPath,ec);
+        return false;
+    }
+
+    std::filesystem::rename(tempPath,configPath,ec);
+    if(ec) {
+        LOG_ERROR<<"替换配置文件失败: "<<configPath<<" - "<<ec.message()<<std::endl;
+        std::filesystem::remove(tempPath,ec);
+        return false;
+    }
 
     return true;
 }
@@ -277,29 +341,191 @@ bool ConfigManager::EnsureConfigDirectory(){
 }
 
 bool ConfigManager::ReadEnableApiCache() {
-    Json::Value config=ReadConfig();
-    if(config.isMember("enable_api_cache")) {
-        return config["enable_api_cache"].asBool();
-    }
-    return true;
+    return GetSnapshot().enableApiCache;
 }
 
 int ConfigManager::ReadApiTimeout() {
-    Json::Value config=ReadConfig();
-    if(config.isMember("api_timeout")) {
-        return config["api_timeout"].asInt();
-    }
-    return 60;
+    return GetSnapshot().apiTimeout;
 }
 
 bool ConfigManager::WriteEnableApiCache(bool enable) {
-    Json::Value config=ReadConfig();
-    config["enable_api_cache"]=enable;
-    return WriteConfig(config);
+    return UpdateConfig([&](Json::Value& config) {
+        config["enable_api_cache"]=enable;
+        });
 }
 
 bool ConfigManager::WriteApiTimeout(int timeout) {
-    Json::Value config=ReadConfig();
-    config["api_timeout"]=timeout;
-    return WriteConfig(config);
+    return UpdateConfig([&](Json::Value& config) {
+        config["api_timeout"]=timeout;
+        });
+}
+
+int ConfigManager::ReadVerifyThreads() {
+    return GetSnapshot().verifyThreads;
+}
+
+bool ConfigManager::WriteVerifyThreads(int threads) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["verify_threads"]=threads;
+        });
+}
+
+bool ConfigManager::ReadEnableHashIndex() {
+    return GetSnapshot().enableHashIndex;
+}
+
+bool ConfigManager::WriteEnableHashIndex(bool enable) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["enable_hash_index"]=enable;
+        });
+}
+
+int ConfigManager::ReadMaxConcurrentDownloads() {
+    return GetSnapshot().maxConcurrentDownloads;
+}
+
+bool ConfigManager::WriteMaxConcurrentDownloads(int count) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["max_concurrent_downloads"]=count;
+        });
+}
+
+int ConfigManager::ReadDownloadRetries() {
+    return GetSnapshot().downloadRetries;
+}
+
+bool ConfigManager::WriteDownloadRetries(int retries) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["download_retries"]=retries;
+        });
+}
+
+int ConfigManager::ReadDownloadSegments() {
+    return GetSnapshot().downloadSegments;
+}
+
+bool ConfigManager::WriteDownloadSegments(int segments) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["download_segments"]=segments;
+        });
+}
+
+int ConfigManager::ReadSegmentMinSizeMB() {
+    return GetSnapshot().segmentMinSizeMB;
+}
+
+bool ConfigManager::WriteSegmentMinSizeMB(int sizeMB) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["segment_min_size_mb"]=sizeMB;
+        });
+}
+
+bool ConfigManager::ReadEnableManifestCache() {
+    return GetSnapshot().enableManifestCache;
+}
+
+bool ConfigManager::WriteEnableManifestCache(bool enable) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["enable_manifest_cache"]=enable;
+        });
+}
+
+int ConfigManager::ReadLogFlushIntervalMs() {
+    return GetSnapshot().logFlushIntervalMs;
+}
+
+bool ConfigManager::WriteLogFlushIntervalMs(int milliseconds) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["log_flush_interval_ms"]=milliseconds;
+        });
+}
+
+std::string ConfigManager::ReadLogLevel() {
+    return GetSnapshot().logLevel;
+}
+
+bool ConfigManager::WriteLogLevel(const std::string& level) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["log_level"]=level;
+        });
+}
+
+int ConfigManager::ReadExtractThreads() {
+    return GetSnapshot().extractThreads;
+}
+
+bool ConfigManager::WriteExtractThreads(int threads) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["extract_threads"]=threads;
+        });
+}
+
+int ConfigManager::ReadMemoryExtractMaxMB() {
+    return GetSnapshot().memoryExtractMaxMB;
+}
+
+bool ConfigManager::WriteMemoryExtractMaxMB(int sizeMB) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["memory_extract_max_mb"]=sizeMB;
+        });
+}
+
+bool ConfigManager::ReadStreamingExtract() {
+    return GetSnapshot().streamingExtract;
+}
+
+bool ConfigManager::WriteStreamingExtract(bool enable) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["streaming_extract"]=enable;
+        });
+}
+
+bool ConfigManager::ReadSkipUnchangedFiles() {
+    return GetSnapshot().skipUnchangedFiles;
+}
+
+bool ConfigManager::WriteSkipUnchangedFiles(bool enable) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["skip_unchanged_files"]=enable;
+        });
+}
+
+bool ConfigManager::ReadCoalescePackages() {
+    return GetSnapshot().coalescePackages;
+}
+
+bool ConfigManager::WriteCoalescePackages(bool enable) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["coalesce_incremental_packages"]=enable;
+        });
+}
+
+int ConfigManager::ReadIncrementalHopCostKB() {
+    return GetSnapshot().incrementalHopCostKB;
+}
+
+bool ConfigManager::WriteIncrementalHopCostKB(int costKB) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["incremental_hop_cost_kb"]=costKB;
+        });
+}
+
+int ConfigManager::ReadPrefetchPackages() {
+    return GetSnapshot().prefetchPackages;
+}
+
+bool ConfigManager::WritePrefetchPackages(int count) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["prefetch_packages"]=count;
+        });
+}
+
+int ConfigManager::ReadTempDiskBudgetMB() {
+    return GetSnapshot().tempDiskBudgetMB;
+}
+
+bool ConfigManager::WriteTempDiskBudgetMB(int sizeMB) {
+    return UpdateConfig([&](Json::Value& config) {
+        config["temp_disk_budget_mb"]=sizeMB;
+        });
 }
\ No newline at end of file
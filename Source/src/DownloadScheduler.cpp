@@ -0,0 +1,301 @@
+﻿#include "DownloadScheduler.h"
+#include "HttpClient.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cwctype>
+#include <filesystem>
+#include "Logger.h"
+
+namespace {
+    const int DEFAULT_MAX_CONCURRENT=8;
+    const int MAX_CONCURRENT_LIMIT=64;
+    const int POLL_TIMEOUT_MS=100;
+    const long long PROGRESS_INTERVAL_MS=100;
+}
+
+DownloadScheduler::DownloadScheduler(int maxConcurrent,HttpClient* client)
+    : multi(nullptr),
+    httpClient(client),
+    maxConcurrent(maxConcurrent),
+    maxAttempts(1),
+    expectedTotalBytes(0),
+    finishedBytes(0),
+    totalTasks(0),
+    succeededCount(0),
+    failedCount(0) {
+    if(this->maxConcurrent<=0) {
+        this->maxConcurrent=DEFAULT_MAX_CONCURRENT;
+    }
+    this->maxConcurrent=std::min(this->maxConcurrent,MAX_CONCURRENT_LIMIT);
+
+    multi=curl_multi_init();
+    if(multi) {
+        // 所有传输共用 multi 句柄的连接池，同一主机的连接会被复用；HTTP/2 下多个传输走同一连接
+        curl_multi_setopt(multi,CURLMOPT_PIPELINING,CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(multi,CURLMOPT_MAX_HOST_CONNECTIONS,static_cast<long>(this->maxConcurrent));
+        curl_multi_setopt(multi,CURLMOPT_MAXCONNECTS,static_cast<long>(this->maxConcurrent));
+    }
+}
+
+DownloadScheduler::~DownloadScheduler() {
+    for(auto& transfer:activeTransfers) {
+        curl_multi_remove_handle(multi,transfer->easy);
+        transfer->partial.reset();
+        curl_easy_cleanup(transfer->easy);
+    }
+    for(CURL* easy:idleHandles) {
+        curl_easy_cleanup(easy);
+    }
+    if(multi) {
+        curl_multi_cleanup(multi);
+    }
+}
+
+void DownloadScheduler::Enqueue(DownloadTask task) {
+    totalTasks++;
+    // 两个传输同时写一个 .part 会互相破坏，同一输出路径只保留第一个任务
+    auto claim=outputClaims.find(OutputKey(task.outputPath));
+    if(claim!=outputClaims.end()) {
+        if(claim->second.url==task.url&&claim->second.expectedHash==task.expectedHash) {
+            LOG_DEBUG<<"合并重复的下载任务: "<<task.outputPath<<std::endl;
+            claim->second.followers.push_back(std::move(task.onComplete));
+        }
+        else {
+            LOG_ERROR<<"多个下载任务写入同一文件: "<<task.outputPath<<std::endl;
+            rejectedTasks.push_back(std::move(task));
+        }
+        return;
+    }
+    outputClaims.emplace(OutputKey(task.outputPath),OutputClaim{task.url,task.expectedHash,{}});
+
+    if(task.expectedSize>0) {
+        expectedTotalBytes+=task.expectedSize;
+    }
+    pendingTasks.push_back({std::move(task),1});
+}
+
+bool DownloadScheduler::Run(ProgressCallback progressCallback) {
+    for(const auto& task:rejectedTasks) {
+        DownloadResult result;
+        result.error="duplicate output path";
+        failedCount++;
+        if(task.onComplete) {
+            task.onComplete(result);
+        }
+    }
+    rejectedTasks.clear();
+
+    if(!multi) {
+        LOG_ERROR<<"CURL multi 初始化失败"<<std::endl;
+        while(!pendingTasks.empty()) {
+            DownloadResult result;
+            result.error="curl_multi_init failed";
+            failedCount++;
+            NotifyCompletion(pendingTasks.front().task,result);
+            pendingTasks.pop_front();
+        }
+        return false;
+    }
+
+    auto lastProgress=std::chrono::steady_clock::now();
+
+    while(!pendingTasks.empty()||!activeTransfers.empty()) {
+        while(!pendingTasks.empty()&&static_cast<int>(activeTransfers.size())<maxConcurrent) {
+            QueuedTask queued=std::move(pendingTasks.front());
+            pendingTasks.pop_front();
+            StartTransfer(std::move(queued));
+        }
+        if(activeTransfers.empty()) {
+            continue;
+        }
+
+        int running=0;
+        CURLMcode mc=curl_multi_perform(multi,&running);
+        if(mc!=CURLM_OK) {
+            LOG_ERROR<<"curl_multi_perform 失败: "<<curl_multi_strerror(mc)<<std::endl;
+            break;
+        }
+
+        int queued=0;
+        while(CURLMsg* message=curl_multi_info_read(multi,&queued)) {
+            if(message->msg!=CURLMSG_DONE) {
+                continue;
+            }
+            CURL* easy=message->easy_handle;
+            CURLcode code=message->data.result;
+            auto it=std::find_if(activeTransfers.begin(),activeTransfers.end(),
+                [easy](const std::unique_ptr<Transfer>& transfer) { return transfer->easy==easy; });
+            if(it==activeTransfers.end()) {
+                continue;
+            }
+            std::unique_ptr<Transfer> transfer=std::move(*it);
+            activeTransfers.erase(it);
+            FinishTransfer(transfer.get(),code);
+        }
+
+        if(progressCallback) {
+            auto now=std::chrono::steady_clock::now();
+            if(std::chrono::duration_cast<std::chrono::milliseconds>(now-lastProgress).count()>=PROGRESS_INTERVAL_MS) {
+                lastProgress=now;
+                long long inFlight=0;
+                for(const auto& transfer:activeTransfers) {
+                    inFlight+=transfer->partial->GetResumeOffset()+transfer->partial->GetReceivedBytes();
+                }
+                progressCallback(finishedBytes+inFlight,expectedTotalBytes,succeededCount+failedCount,totalTasks);
+            }
+        }
+
+        if(running>0) {
+            curl_multi_poll(multi,nullptr,0,POLL_TIMEOUT_MS,nullptr);
+        }
+    }
+
+    // multi 出错时把剩下的任务都按失败处理，保证每个回调只触发一次
+    for(auto& transfer:activeTransfers) {
+        FinishTransfer(transfer.get(),CURLE_ABORTED_BY_CALLBACK);
+    }
+    activeTransfers.clear();
+    while(!pendingTasks.empty()) {
+        DownloadResult result;
+        result.error="scheduler aborted";
+        failedCount++;
+        NotifyCompletion(pendingTasks.front().task,result);
+        pendingTasks.pop_front();
+    }
+
+    if(progressCallback) {
+        progressCallback(finishedBytes,expectedTotalBytes,succeededCount+failedCount,totalTasks);
+    }
+    return failedCount==0;
+}
+
+bool DownloadScheduler::StartTransfer(QueuedTask queued) {
+    auto transfer=std::make_unique<Transfer>();
+    transfer->queued=std::move(queued);
+    const DownloadTask& task=transfer->queued.task;
+
+    transfer->partial=std::make_unique<PartialDownload>(task.url,task.outputPath,task.hashAlgorithm);
+    transfer->partial->SetExpectedSize(task.expectedSize);
+    if(!transfer->partial->Open()) {
+        FinishTransfer(transfer.get(),CURLE_WRITE_ERROR);
+        return false;
+    }
+
+    transfer->easy=AcquireHandle();
+    if(!transfer->easy) {
+        FinishTransfer(transfer.get(),CURLE_FAILED_INIT);
+        return false;
+    }
+
+    CURL* easy=transfer->easy;
+    curl_easy_setopt(easy,CURLOPT_URL,task.url.c_str());
+    curl_easy_setopt(easy,CURLOPT_TIMEOUT,static_cast<long>(task.timeoutSeconds>0?task.timeoutSeconds:0));
+    transfer->partial->Attach(easy);
+
+    CURLMcode mc=curl_multi_add_handle(multi,easy);
+    if(mc!=CURLM_OK) {
+        LOG_ERROR<<"添加下载任务失败: "<<curl_multi_strerror(mc)<<std::endl;
+        FinishTransfer(transfer.get(),CURLE_FAILED_INIT);
+        return false;
+    }
+
+    activeTransfers.push_back(std::move(transfer));
+    return true;
+}
+
+void DownloadScheduler::FinishTransfer(Transfer* transfer,CURLcode code) {
+    DownloadResult result;
+    const DownloadTask& task=transfer->queued.task;
+    PartialDownload& partial=*transfer->partial;
+
+    if(transfer->easy&&httpClient&&code!=CURLE_FAILED_INIT) {
+        httpClient->RecordConnectionInfo(transfer->easy);
+    }
+    result.success=partial.Complete(code,task.expectedHash,result.digest,result.error);
+    result.httpStatus=partial.GetHttpStatus();
+    result.bytes=partial.GetResumeOffset()+partial.GetReceivedBytes();
+
+    if(transfer->easy) {
+        curl_multi_remove_handle(multi,transfer->easy);
+        ReleaseHandle(transfer->easy);
+        transfer->easy=nullptr;
+    }
+
+    if(result.success) {
+        succeededCount++;
+        finishedBytes+=result.bytes;
+    }
+    else {
+        // 传输中断或哈希不符时重新排队；有 .part 的会从断点继续
+        bool retryable=partial.NeedsRestart()||(code!=CURLE_FAILED_INIT&&code!=CURLE_WRITE_ERROR&&
+            (result.httpStatus<400||result.httpStatus>=500));
+        if(retryable&&transfer->queued.attempt<maxAttempts) {
+            LOG_WARN<<"下载失败，稍后重试 ("<<transfer->queued.attempt<<"/"<<maxAttempts<<"): "
+                <<task.url<<" ("<<result.error<<")"<<std::endl;
+            transfer->queued.attempt++;
+            pendingTasks.push_back(std::move(transfer->queued));
+            return;
+        }
+
+        failedCount++;
+        LOG_ERROR<<"下载失败: "<<task.url<<" ("<<result.error<<")"<<std::endl;
+    }
+
+    NotifyCompletion(task,result);
+}
+
+CURL* DownloadScheduler::AcquireHandle() {
+    if(!idleHandles.empty()) {
+        CURL* easy=idleHandles.back();
+        idleHandles.pop_back();
+        return easy;
+    }
+
+    CURL* easy=curl_easy_init();
+    if(easy) {
+        curl_easy_setopt(easy,CURLOPT_USERAGENT,"MinecraftUpdater/1.0");
+        curl_easy_setopt(easy,CURLOPT_FOLLOWLOCATION,1L);
+        curl_easy_setopt(easy,CURLOPT_CONNECTTIMEOUT,10L);
+        curl_easy_setopt(easy,CURLOPT_LOW_SPEED_LIMIT,1024L);
+        curl_easy_setopt(easy,CURLOPT_LOW_SPEED_TIME,30L);
+        curl_easy_setopt(easy,CURLOPT_TCP_KEEPALIVE,1L);
+        curl_easy_setopt(easy,CURLOPT_NOPROGRESS,1L);
+        HttpClient::ApplySharedOptions(easy,httpClient?httpClient->GetShareHandle():nullptr);
+    }
+    return easy;
+}
+
+void DownloadScheduler::ReleaseHandle(CURL* easy) {
+    // 句柄放回空闲列表，下一个任务直接复用
+    idleHandles.push_back(easy);
+}
+void DownloadScheduler::NotifyCompletion(const DownloadTask& task,const DownloadResult& result) {
+    if(task.onComplete) {
+        task.onComplete(result);
+    }
+    auto claim=outputClaims.find(OutputKey(task.outputPath));
+    if(claim==outputClaims.end()) {
+        return;
+    }
+    std::vector<CompletionCallback> followers=std::move(claim->second.followers);
+    outputClaims.erase(claim);
+    for(const auto& onComplete:followers) {
+        if(result.success) {
+            succeededCount++;
+        }
+        else {
+            failedCount++;
+        }
+        if(onComplete) {
+            onComplete(result);
+        }
+    }
+}
+
+std::wstring DownloadScheduler::OutputKey(const std::string& outputPath) {
+    // Windows 路径不区分大小写，分隔符也不统一；路径是本地代码页编码，不能按 UTF-8 解释
+    std::wstring key=std::filesystem::path(outputPath).lexically_normal().generic_wstring();
+    std::transform(key.begin(),key.end(),key.begin(),[](wchar_t c) { return static_cast<wchar_t>(std::towlower(c)); });
+    return key;
+}
\ No newline at end of file
@@ -3,18 +3,222 @@
 #include <filesystem>
 #include <sstream>
 #include <iomanip>
+#include <windows.h>
+#if defined(_M_X64)||defined(_M_IX86)
+#include <intrin.h>
+#endif
+#ifdef MCUPDATER_XXH3_DISPATCH
+#include <xxh_x86dispatch.h>
+#endif
 
-std::string FileHasher::CalculateMemoryHash(const std::vector<unsigned char>& data,const std::string& algorithm) {
-	if(algorithm=="md5") {
-		return MD5Hash(data);
+namespace {
+	// 小文件一次读完；中等文件用大块顺序读；大文件按视图映射
+	const unsigned long long SMALL_FILE_THRESHOLD=1ULL*1024*1024;
+	const unsigned long long MAPPED_FILE_THRESHOLD=64ULL*1024*1024;
+	const size_t READ_BLOCK_SIZE=1024*1024;
+	const unsigned long long MAP_VIEW_SIZE=64ULL*1024*1024;
+
+	const EVP_MD* SelectDigest(const std::string& algorithm) {
+		if(algorithm=="md5") {
+			return EVP_md5();
+		}
+		else if(algorithm=="sha1") {
+			return EVP_sha1();
+		}
+		else if(algorithm=="sha256") {
+			return EVP_sha256();
+		}
+		return nullptr;
+	}
+
+	// BLAKE3 多线程分块只在数据足够大时才划算
+	const size_t BLAKE3_PARALLEL_THRESHOLD=4*1024*1024;
+
+	struct HandleCloser {
+		HANDLE handle;
+		~HandleCloser() {
+			if(handle&&handle!=INVALID_HANDLE_VALUE) {
+				CloseHandle(handle);
+			}
+		}
+	};
+
+	bool ReadAll(HANDLE file,char* buffer,DWORD length,DWORD& bytesRead) {
+		bytesRead=0;
+		while(bytesRead<length) {
+			DWORD chunk=0;
+			if(!ReadFile(file,buffer+bytesRead,length-bytesRead,&chunk,NULL)) {
+				return false;
+			}
+			if(chunk==0) {
+				break;
+			}
+			bytesRead+=chunk;
+		}
+		return true;
+	}
+}
+
+FileHasher::StreamHasher::StreamHasher(const std::string& algorithm)
+	: backend(Backend::None),evpContext(nullptr),blake3State(nullptr),xxh3State(nullptr),crc32State(0),finalized(false) {
+	if(algorithm=="crc32") {
+		// 链接 zlib-ng 等实现时 crc32 由 PCLMULQDQ 加速
+		crc32State=crc32(0L,Z_NULL,0);
+		backend=Backend::Crc32;
+		return;
+	}
+	if(algorithm=="blake3") {
+		blake3State=new blake3_hasher;
+		blake3_hasher_init(blake3State);
+		backend=Backend::Blake3;
+		return;
+	}
+	if(algorithm=="xxh3-128") {
+		xxh3State=XXH3_createState();
+		if(xxh3State&&XXH3_128bits_reset(xxh3State)==XXH_OK) {
+			backend=Backend::Xxh3;
+		}
+		return;
+	}
+
+	const EVP_MD* md=SelectDigest(algorithm);
+	if(!md) {
+		return;
+	}
+	evpContext=EVP_MD_CTX_new();
+	if(evpContext&&EVP_DigestInit_ex(evpContext,md,nullptr)==1) {
+		backend=Backend::Evp;
 	}
-	else if(algorithm=="sha1") {
-		return SHA1Hash(data);
+}
+
+FileHasher::StreamHasher::~StreamHasher() {
+	if(evpContext) {
+		EVP_MD_CTX_free(evpContext);
+	}
+	delete blake3State;
+	if(xxh3State) {
+		XXH3_freeState(xxh3State);
+	}
+}
+
+void FileHasher::StreamHasher::Update(const void* data,size_t length) {
+	if(finalized||length==0) {
+		return;
+	}
+	switch(backend) {
+	case Backend::Evp:
+		EVP_DigestUpdate(evpContext,data,length);
+		break;
+	case Backend::Blake3:
+		blake3_hasher_update(blake3State,data,length);
+		break;
+	case Backend::Xxh3:
+#ifdef MCUPDATER_XXH3_DISPATCH
+		XXH3_128bits_update_dispatch(xxh3State,data,length);
+#else
+		XXH3_128bits_update(xxh3State,data,length);
+#endif
+		break;
+	case Backend::Crc32:
+		crc32State=crc32_z(crc32State,static_cast<const Bytef*>(data),length);
+		break;
+	case Backend::None:
+		break;
+	}
+}
+
+void FileHasher::StreamHasher::UpdateLarge(const void* data,size_t length) {
+#ifdef MCUPDATER_BLAKE3_TBB
+	if(backend==Backend::Blake3&&!finalized&&length>=BLAKE3_PARALLEL_THRESHOLD) {
+		blake3_hasher_update_tbb(blake3State,data,length);
+		return;
 	}
-	else if(algorithm=="sha256") {
-		return SHA256Hash(data);
+#endif
+	Update(data,length);
+}
+
+std::string FileHasher::StreamHasher::Final() {
+	if(finalized) {
+		return digest;
+	}
+	finalized=true;
+
+	switch(backend) {
+	case Backend::Evp: {
+		unsigned char buffer[EVP_MAX_MD_SIZE];
+		unsigned int length=0;
+		if(EVP_DigestFinal_ex(evpContext,buffer,&length)==1) {
+			digest=ToHex(buffer,length);
+		}
+		break;
 	}
-	return MD5Hash(data);
+	case Backend::Blake3: {
+		unsigned char buffer[BLAKE3_OUT_LEN];
+		blake3_hasher_finalize(blake3State,buffer,BLAKE3_OUT_LEN);
+		digest=ToHex(buffer,BLAKE3_OUT_LEN);
+		break;
+	}
+	case Backend::Xxh3: {
+		XXH128_canonical_t canonical;
+		XXH128_canonicalFromHash(&canonical,XXH3_128bits_digest(xxh3State));
+		digest=ToHex(canonical.digest,sizeof(canonical.digest));
+		break;
+	}
+	case Backend::Crc32: {
+		unsigned char buffer[4]={
+			static_cast<unsigned char>(crc32State>>24),static_cast<unsigned char>(crc32State>>16),
+			static_cast<unsigned char>(crc32State>>8),static_cast<unsigned char>(crc32State)
+		};
+		digest=ToHex(buffer,sizeof(buffer));
+		break;
+	}
+	case Backend::None:
+		break;
+	}
+	return digest;
+}
+
+bool FileHasher::IsSupportedAlgorithm(const std::string& algorithm) {
+	return algorithm=="blake3"||algorithm=="xxh3-128"||SelectDigest(algorithm)!=nullptr;
+}
+
+std::string FileHasher::DescribeSimdSupport() {
+#if defined(_M_ARM64)||defined(__aarch64__)
+	return "NEON";
+#elif defined(_M_X64)||defined(_M_IX86)
+	int info[4]={0};
+	__cpuid(info,0);
+	int maxLeaf=info[0];
+	__cpuid(info,1);
+	bool osxsave=(info[2]&(1<<27))!=0;
+	bool avx=(info[2]&(1<<28))!=0;
+	bool sse41=(info[2]&(1<<19))!=0;
+	unsigned long long xcr0=osxsave?_xgetbv(0):0;
+	bool ymmEnabled=(xcr0&0x6)==0x6;
+	bool zmmEnabled=(xcr0&0xE6)==0xE6;
+
+	if(maxLeaf>=7) {
+		__cpuidex(info,7,0);
+		bool avx2=(info[1]&(1<<5))!=0;
+		bool avx512f=(info[1]&(1<<16))!=0;
+		bool avx512vl=(info[1]&(1u<<31))!=0;
+		if(avx512f&&avx512vl&&zmmEnabled) {
+			return "AVX-512";
+		}
+		if(avx&&avx2&&ymmEnabled) {
+			return "AVX2";
+		}
+	}
+	return sse41?"SSE4.1":"SSE2";
+#else
+	return "portable";
+#endif
+}
+
+std::string FileHasher::CalculateMemoryHash(const std::vector<unsigned char>& data,const std::string& algorithm) {
+	StreamHasher hasher(IsSupportedAlgorithm(algorithm)?algorithm:"md5");
+	hasher.Update(data.data(),data.size());
+	return hasher.Final();
 }
 
 std::string FileHasher::CalculateDirectoryHash(const std::string& directoryPath,const std::string& algorithm) {
@@ -31,111 +235,138 @@ std::string FileHasher::CalculateDirectoryHash(const std::string& directoryPath,
 	return CalculateMemoryHash(data,algorithm);
 }
 
-std::string FileHasher::MD5Hash(const std::vector<unsigned char>& data) {
-	MD5_CTX context;
-	MD5_Init(&context);
-	MD5_Update(&context,data.data(),data.size());
-
-	unsigned char digest[MD5_DIGEST_LENGTH];
-	MD5_Final(digest,&context);
+std::string FileHasher::ToHex(const unsigned char* data,size_t length) {
+	static const char digits[]="0123456789abcdef";
+	std::string result(length*2,'0');
+	for(size_t i=0; i<length; ++i) {
+		result[i*2]=digits[data[i]>>4];
+		result[i*2+1]=digits[data[i]&0x0F];
+	}
+	return result;
+}
 
-	std::stringstream ss;
-	for(int i=0; i<MD5_DIGEST_LENGTH; ++i) {
-		ss<<std::hex<<std::setw(2)<<std::setfill('0')<<(int)digest[i];
+std::string FileHasher::CalculateFileHashStream(const std::string& filePath,const std::string& algorithm) {
+	StreamHasher hasher(algorithm);
+	if(!hasher.IsValid()) {
+		return "";
+	}
+	if(!HashFileContents(filePath,hasher)) {
+		return "";
 	}
-	return ss.str();
+	return hasher.Final();
 }
 
-std::string FileHasher::SHA1Hash(const std::vector<unsigned char>& data) {
-	SHA_CTX context;
-	SHA1_Init(&context);
-	SHA1_Update(&context,data.data(),data.size());
+bool FileHasher::HashFileContents(const std::string& filePath,StreamHasher& hasher) {
+	// 与 SecureCombine 返回的窄字符路径保持同一编码解释
+	std::wstring widePath=std::filesystem::path(filePath).wstring();
+	if(widePath.empty()) {
+		return false;
+	}
+	return HashFileContents(widePath,hasher);
+}
 
-	unsigned char digest[SHA_DIGEST_LENGTH];
-	SHA1_Final(digest,&context);
+bool FileHasher::CalculateFileCrc32(const std::wstring& widePath,uint32_t& crc) {
+	StreamHasher hasher("crc32");
+	if(!HashFileContents(widePath,hasher)) {
+		return false;
+	}
+	crc=static_cast<uint32_t>(std::stoul(hasher.Final(),nullptr,16));
+	return true;
+}
 
-	std::stringstream ss;
-	for(int i=0; i<SHA_DIGEST_LENGTH; ++i) {
-		ss<<std::hex<<std::setw(2)<<std::setfill('0')<<(int)digest[i];
+bool FileHasher::FileMatchesCrc32(const std::wstring& widePath,unsigned long long size,uint32_t crc) {
+	std::error_code ec;
+	auto fileSize=std::filesystem::file_size(std::filesystem::path(widePath),ec);
+	if(ec||fileSize!=size) {
+		return false;
 	}
-	return ss.str();
+	uint32_t fileCrc=0;
+	return CalculateFileCrc32(widePath,fileCrc)&&fileCrc==crc;
 }
 
-std::string FileHasher::SHA256Hash(const std::vector<unsigned char>& data) {
-	SHA256_CTX context;
-	SHA256_Init(&context);
-	SHA256_Update(&context,data.data(),data.size());
+bool FileHasher::HashFileContents(const std::wstring& widePath,StreamHasher& hasher) {
+	// 与 std::ifstream 一致，允许读取其他进程正在写入的文件
+	HANDLE file=CreateFileW(widePath.c_str(),GENERIC_READ,FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,NULL,
+		OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL|FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+	if(file==INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	HandleCloser fileCloser{file};
 
-	unsigned char digest[SHA256_DIGEST_LENGTH];
-	SHA256_Final(digest,&context);
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(file,&fileSize)) {
+		return false;
+	}
+	unsigned long long totalSize=static_cast<unsigned long long>(fileSize.QuadPart);
+
+	if(totalSize>=MAPPED_FILE_THRESHOLD) {
+		HANDLE mapping=CreateFileMappingW(file,NULL,PAGE_READONLY,0,0,NULL);
+		if(mapping) {
+			HandleCloser mappingCloser{mapping};
+			bool mappedOk=true;
+			for(unsigned long long offset=0; offset<totalSize; offset+=MAP_VIEW_SIZE) {
+				SIZE_T viewSize=static_cast<SIZE_T>((std::min)(MAP_VIEW_SIZE,totalSize-offset));
+				const void* view=MapViewOfFile(mapping,FILE_MAP_READ,
+					static_cast<DWORD>(offset>>32),static_cast<DWORD>(offset&0xFFFFFFFF),viewSize);
+				if(!view) {
+					mappedOk=false;
+					break;
+				}
+				hasher.UpdateLarge(view,viewSize);
+				UnmapViewOfFile(view);
+			}
+			if(mappedOk) {
+				return true;
+			}
+			// 映射中途失败时上下文已被部分更新，不能再回退
+			return false;
+		}
+	}
+
+	thread_local std::vector<char> buffer;
+	size_t blockSize=totalSize<=SMALL_FILE_THRESHOLD?
+		static_cast<size_t>((std::max)(totalSize,1ULL)):READ_BLOCK_SIZE;
+	if(buffer.size()<blockSize) {
+		buffer.resize(blockSize);
+	}
 
-	std::stringstream ss;
-	for(int i=0; i<SHA256_DIGEST_LENGTH; ++i) {
-		ss<<std::hex<<std::setw(2)<<std::setfill('0')<<(int)digest[i];
+	for(;;) {
+		DWORD bytesRead=0;
+		if(!ReadAll(file,buffer.data(),static_cast<DWORD>(blockSize),bytesRead)) {
+			return false;
+		}
+		if(bytesRead==0) {
+			break;
+		}
+		hasher.Update(buffer.data(),bytesRead);
+		if(bytesRead<blockSize) {
+			break;
+		}
 	}
-	return ss.str();
+	return true;
 }
-// 在FileHasher类中添加
-std::string FileHasher::CalculateFileHashStream(const std::string& filePath,const std::string& algorithm) {
-    std::ifstream file(filePath,std::ios::binary);
-    if(!file) {
-        return "";
-    }
-
-    const size_t bufferSize=8192;
-    char buffer[bufferSize];
-
-    if(algorithm=="md5") {
-        MD5_CTX context;
-        MD5_Init(&context);
-
-        while(file.read(buffer,bufferSize)||file.gcount()>0) {
-            MD5_Update(&context,buffer,file.gcount());
-        }
-
-        unsigned char digest[MD5_DIGEST_LENGTH];
-        MD5_Final(digest,&context);
-
-        std::stringstream ss;
-        for(int i=0; i<MD5_DIGEST_LENGTH; ++i) {
-            ss<<std::hex<<std::setw(2)<<std::setfill('0')<<(int)digest[i];
-        }
-        return ss.str();
-    }
-    else if(algorithm=="sha1") {
-        SHA_CTX context;
-        SHA1_Init(&context);
-
-        while(file.read(buffer,bufferSize)||file.gcount()>0) {
-            SHA1_Update(&context,buffer,file.gcount());
-        }
-
-        unsigned char digest[SHA_DIGEST_LENGTH];
-        SHA1_Final(digest,&context);
-
-        std::stringstream ss;
-        for(int i=0; i<SHA_DIGEST_LENGTH; ++i) {
-            ss<<std::hex<<std::setw(2)<<std::setfill('0')<<(int)digest[i];
-        }
-        return ss.str();
-    }
-    else if(algorithm=="sha256") {
-        SHA256_CTX context;
-        SHA256_Init(&context);
-
-        while(file.read(buffer,bufferSize)||file.gcount()>0) {
-            SHA256_Update(&context,buffer,file.gcount());
-        }
-
-        unsigned char digest[SHA256_DIGEST_LENGTH];
-        SHA256_Final(digest,&context);
-
-        std::stringstream ss;
-        for(int i=0; i<SHA256_DIGEST_LENGTH; ++i) {
-            ss<<std::hex<<std::setw(2)<<std::setfill('0')<<(int)digest[i];
-        }
-        return ss.str();
-    }
-
-    return "";
+
+std::string FileHasher::CalculateFileHashCached(const std::string& filePath,const std::string& algorithm,HashIndex* index) {
+	if(!index||!index->IsEnabled()) {
+		return CalculateFileHashStream(filePath,algorithm);
+	}
+
+	HashIndex::FileStamp before;
+	if(!HashIndex::GetFileStamp(filePath,before)) {
+		return CalculateFileHashStream(filePath,algorithm);
+	}
+
+	std::string hash;
+	if(index->Lookup(filePath,before,algorithm,hash)) {
+		return hash;
+	}
+
+	hash=CalculateFileHashStream(filePath,algorithm);
+
+	// 计算期间文件被改动则不写入索引
+	HashIndex::FileStamp after;
+	if(!hash.empty()&&HashIndex::GetFileStamp(filePath,after)&&after==before) {
+		index->Store(filePath,before,algorithm,hash);
+	}
+	return hash;
 }
\ No newline at end of file
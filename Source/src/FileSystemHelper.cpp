@@ -4,7 +4,7 @@
 void FileSystemHelper::EnsureDirectoryExists(const std::string& path) {
     try {
         if(path.empty()) {
-            g_logger<<"[WARN] 警告: 路径为空"<<std::endl;
+            LOG_WARN<<"警告: 路径为空"<<std::endl;
             return;
         }
 
@@ -12,35 +12,35 @@ void FileSystemHelper::EnsureDirectoryExists(const std::string& path) {
         dirPath=std::filesystem::absolute(dirPath);
 
         if(!std::filesystem::exists(dirPath)) {
-            g_logger<<"[INFO] 创建目录: "<<dirPath.string()<<std::endl;
+            LOG_INFO<<"创建目录: "<<dirPath.string()<<std::endl;
             bool created=std::filesystem::create_directories(dirPath);
 
             if(created) {
-                g_logger<<"[INFO] 目录创建成功: "<<dirPath.string()<<std::endl;
+                LOG_INFO<<"目录创建成功: "<<dirPath.string()<<std::endl;
             }
             else {
-                g_logger<<"[WARN] 目录可能已存在: "<<dirPath.string()<<std::endl;
+                LOG_WARN<<"目录可能已存在: "<<dirPath.string()<<std::endl;
             }
             if(!std::filesystem::exists(dirPath)) {
-                g_logger<<"[ERROR] 错误: 目录创建后仍然不存在: "<<dirPath.string()<<std::endl;
+                LOG_ERROR<<"错误: 目录创建后仍然不存在: "<<dirPath.string()<<std::endl;
             }
             else if(!std::filesystem::is_directory(dirPath)) {
-                g_logger<<"[ERROR] 错误: 路径存在但不是目录: "<<dirPath.string()<<std::endl;
+                LOG_ERROR<<"错误: 路径存在但不是目录: "<<dirPath.string()<<std::endl;
             }
         }
         else {
             if(!std::filesystem::is_directory(dirPath)) {
-                g_logger<<"[ERROR] 错误: 路径存在但不是目录: "<<dirPath.string()<<std::endl;
+                LOG_ERROR<<"错误: 路径存在但不是目录: "<<dirPath.string()<<std::endl;
             }
         }
     }
     catch(const std::filesystem::filesystem_error& e) {
-        g_logger<<"[ERROR] 创建目录失败: "<<path
+        LOG_ERROR<<"创建目录失败: "<<path
             <<" - 错误码: "<<e.code().message()
             <<" (路径1: "<<e.path1()<<", 路径2: "<<e.path2()<<")"<<std::endl;
     }
     catch(const std::exception& e) {
-        g_logger<<"[ERROR] 创建目录失败: "<<path<<" - "<<e.what()<<std::endl;
+        LOG_ERROR<<"创建目录失败: "<<path<<" - "<<e.what()<<std::endl;
     }
 }
 
@@ -68,11 +68,11 @@ bool FileSystemHelper::BackupFile(const std::string& filePath) {
         }
         std::filesystem::rename(tempBackupPath,backupPath);
 
-        g_logger<<"[INFO] 备份完成: "<<filePath<<" -> "<<backupPath<<std::endl;
+        LOG_INFO<<"备份完成: "<<filePath<<" -> "<<backupPath<<std::endl;
         return true;
     }
     catch(const std::exception& e) {
-        g_logger<<"[WARN] 备份失败: "<<filePath<<" - "<<e.what()<<std::endl;
+        LOG_WARN<<"备份失败: "<<filePath<<" - "<<e.what()<<std::endl;
         try {
             if(std::filesystem::exists(tempBackupPath)) {
                 std::filesystem::remove_all(tempBackupPath);
@@ -86,30 +86,25 @@ bool FileSystemHelper::BackupFile(const std::string& filePath) {
 }
 void FileSystemHelper::CleanupOrphanedFiles(const std::string& baseDir,
     const std::string& relativeDir,
-    const Json::Value& expectedContents) {
-    if(!expectedContents.isArray()) {
-        g_logger<<"[WARN] 警告: 预期内容不是数组，跳过清理孤儿文件"<<std::endl;
-        return;
-    }
+    const std::vector<std::string>& expectedPaths) {
     std::string fullDirPath;
     try {
         fullDirPath=SecureCombine(baseDir,relativeDir);
     }
     catch(const std::exception& e) {
-        g_logger<<"[ERROR] 清理孤儿文件时路径遍历被阻止: "<<relativeDir<<" - "<<e.what()<<std::endl;
+        LOG_ERROR<<"清理孤儿文件时路径遍历被阻止: "<<relativeDir<<" - "<<e.what()<<std::endl;
         return;
     }
 
     std::set<std::string> expectedFiles;
-    for(const auto& contentInfo:expectedContents) {
-        std::string path=contentInfo["path"].asString();
+    for(std::string path:expectedPaths) {
         std::replace(path.begin(),path.end(),'\\','/');
         expectedFiles.insert(path);
     }
 
-    g_logger<<"[DEBUG] 期望文件列表:"<<std::endl;
+    LOG_DEBUG<<"期望文件列表:"<<std::endl;
     for(const auto& file:expectedFiles) {
-        g_logger<<"[DEBUG]   - "<<file<<std::endl;
+        LOG_DEBUG<<"  - "<<file<<std::endl;
     }
 
     std::error_code ec;
@@ -118,14 +113,14 @@ void FileSystemHelper::CleanupOrphanedFiles(const std::string& baseDir,
         std::filesystem::directory_options::skip_permission_denied,
         ec);
     if(ec) {
-        g_logger<<"[ERROR] 无法打开目录迭代器: "<<fullDirPath<<" - "<<ec.message()<<std::endl;
+        LOG_ERROR<<"无法打开目录迭代器: "<<fullDirPath<<" - "<<ec.message()<<std::endl;
         return;
     }
 
     const auto end=std::filesystem::recursive_directory_iterator();
     while(it!=end) {
         if(ec) {
-            g_logger<<"[ERROR] 迭代器状态无效: "<<ec.message()<<std::endl;
+            LOG_ERROR<<"迭代器状态无效: "<<ec.message()<<std::endl;
             break;
         }
 
@@ -138,31 +133,31 @@ void FileSystemHelper::CleanupOrphanedFiles(const std::string& baseDir,
         if(entry.is_regular_file()) {
             std::string relativePath=std::filesystem::relative(entry.path(),fullDirPath,ec).string();
             if(ec) {
-                g_logger<<"[ERROR] 计算相对路径失败: "<<entry.path().string()<<" - "<<ec.message()<<std::endl;
+                LOG_ERROR<<"计算相对路径失败: "<<entry.path().string()<<" - "<<ec.message()<<std::endl;
                 it.increment(ec);
                 continue;
             }
             std::replace(relativePath.begin(),relativePath.end(),'\\','/');
 
-            g_logger<<"[DEBUG] 检查文件: "<<relativePath<<std::endl;
+            LOG_DEBUG<<"检查文件: "<<relativePath<<std::endl;
 
             if(expectedFiles.find(relativePath)==expectedFiles.end()) {
                 std::error_code remove_ec;
                 std::filesystem::remove(entry.path(),remove_ec);
                 if(!remove_ec) {
-                    g_logger<<"[INFO] 删除孤儿文件: "<<relativePath<<std::endl;
+                    LOG_INFO<<"删除孤儿文件: "<<relativePath<<std::endl;
                 }
                 else {
-                    g_logger<<"[ERROR] 删除孤儿文件失败: "<<relativePath<<" - "<<remove_ec.message()<<std::endl;
+                    LOG_ERROR<<"删除孤儿文件失败: "<<relativePath<<" - "<<remove_ec.message()<<std::endl;
                 }
             }
             else {
-                g_logger<<"[DEBUG] 文件在期望列表中，保留: "<<relativePath<<std::endl;
+                LOG_DEBUG<<"文件在期望列表中，保留: "<<relativePath<<std::endl;
             }
         }
         it.increment(ec);
         if(ec) {
-            g_logger<<"[ERROR] 迭代目录时出错: "<<ec.message()<<std::endl;
+            LOG_ERROR<<"迭代目录时出错: "<<ec.message()<<std::endl;
             break;
         }
     }
@@ -173,14 +168,14 @@ std::wstring FileSystemHelper::Utf8ToWide(const std::string& utf8Str) {
     int requiredSize=MultiByteToWideChar(CP_UTF8,0,utf8Str.c_str(),-1,NULL,0);
     if(requiredSize==0) {
         DWORD error=GetLastError();
-        g_logger<<"[ERROR] MultiByteToWideChar failed, error: "<<error<<std::endl;
+        LOG_ERROR<<"MultiByteToWideChar failed, error: "<<error<<std::endl;
         return L"";
     }
 
     std::wstring wideStr(requiredSize,0);
     if(MultiByteToWideChar(CP_UTF8,0,utf8Str.c_str(),-1,&wideStr[0],requiredSize)==0) {
         DWORD error=GetLastError();
-        g_logger<<"[ERROR] MultiByteToWideChar failed, error: "<<error<<std::endl;
+        LOG_ERROR<<"MultiByteToWideChar failed, error: "<<error<<std::endl;
         return L"";
     }
     wideStr.pop_back();
@@ -193,14 +188,14 @@ std::string FileSystemHelper::WideToUtf8(const std::wstring& wideStr) {
     int requiredSize=WideCharToMultiByte(CP_UTF8,0,wideStr.c_str(),-1,NULL,0,NULL,NULL);
     if(requiredSize==0) {
         DWORD error=GetLastError();
-        g_logger<<"[ERROR] WideCharToMultiByte failed, error: "<<error<<std::endl;
+        LOG_ERROR<<"WideCharToMultiByte failed, error: "<<error<<std::endl;
         return "";
     }
 
     std::string utf8Str(requiredSize,0);
     if(WideCharToMultiByte(CP_UTF8,0,wideStr.c_str(),-1,&utf8Str[0],requiredSize,NULL,NULL)==0) {
         DWORD error=GetLastError();
-        g_logger<<"[ERROR] WideCharToMultiByte failed, error: "<<error<<std::endl;
+        LOG_ERROR<<"WideCharToMultiByte failed, error: "<<error<<std::endl;
         return "";
     }
     utf8Str.pop_back();
@@ -218,12 +213,12 @@ bool FileSystemHelper::CopyFileWithUnicode(const std::wstring& sourcePath,const
 
             if(!result) {
                 error=GetLastError();
-                g_logger<<"[ERROR] 复制文件失败 (删除后重试): "<<WideToUtf8(sourcePath)<<" -> "<<WideToUtf8(targetPath)<<"，错误码: "<<error<<std::endl;
+                LOG_ERROR<<"复制文件失败 (删除后重试): "<<WideToUtf8(sourcePath)<<" -> "<<WideToUtf8(targetPath)<<"，错误码: "<<error<<std::endl;
                 return false;
             }
         }
         else {
-            g_logger<<"[ERROR] 复制文件失败: "<<WideToUtf8(sourcePath)<<" -> "<<WideToUtf8(targetPath)<<"，错误码: "<<error<<std::endl;
+            LOG_ERROR<<"复制文件失败: "<<WideToUtf8(sourcePath)<<" -> "<<WideToUtf8(targetPath)<<"，错误码: "<<error<<std::endl;
             return false;
         }
     }
@@ -231,46 +226,46 @@ bool FileSystemHelper::CopyFileWithUnicode(const std::wstring& sourcePath,const
     return true;
 }
 void FileSystemHelper::CleanupTempExtractDir(const std::string& extractPath) {
-    g_logger<<"[INFO] 清理临时解压目录..."<<std::endl;
+    LOG_INFO<<"清理临时解压目录..."<<std::endl;
     if(!extractPath.empty()&&std::filesystem::exists(extractPath)) {
         try {
             std::string tempDir=std::filesystem::temp_directory_path().string();
             if(extractPath.find(tempDir)==0) {
                 std::filesystem::remove_all(extractPath);
-                g_logger<<"[INFO] 已清理临时解压目录: "<<extractPath<<std::endl;
+                LOG_INFO<<"已清理临时解压目录: "<<extractPath<<std::endl;
             }
             else {
-                g_logger<<"[INFO] 保留非临时目录: "<<extractPath<<std::endl;
+                LOG_INFO<<"保留非临时目录: "<<extractPath<<std::endl;
             }
         }
         catch(const std::exception& e) {
-            g_logger<<"[WARN] 无法清理解压目录: "<<e.what()<<std::endl;
+            LOG_WARN<<"无法清理解压目录: "<<e.what()<<std::endl;
         }
     }
     else {
-        g_logger<<"[INFO] 解压目录不存在或为空，无需清理"<<std::endl;
+        LOG_INFO<<"解压目录不存在或为空，无需清理"<<std::endl;
     }
 }
 
 void FileSystemHelper::CleanupTempFiles(const std::string& zipFilePath,const std::string& extractPath) {
-    g_logger<<"[INFO] 清理所有临时文件..."<<std::endl;
+    LOG_INFO<<"清理所有临时文件..."<<std::endl;
     if(!zipFilePath.empty()&&std::filesystem::exists(zipFilePath)) {
         try {
             std::filesystem::remove(zipFilePath);
-            g_logger<<"[INFO] 已清理临时 ZIP 文件: "<<zipFilePath<<std::endl;
+            LOG_INFO<<"已清理临时 ZIP 文件: "<<zipFilePath<<std::endl;
         }
         catch(const std::exception& e) {
-            g_logger<<"[WARN] 无法删除临时 ZIP 文件: "<<e.what()<<std::endl;
+            LOG_WARN<<"无法删除临时 ZIP 文件: "<<e.what()<<std::endl;
         }
     }
     CleanupTempExtractDir(extractPath);
 }
 
 bool FileSystemHelper::ValidateExtraction(const std::string& extractPath) {
-    g_logger<<"[INFO] 验证解压结果..."<<std::endl;
+    LOG_INFO<<"验证解压结果..."<<std::endl;
 
     if(!std::filesystem::exists(extractPath)) {
-        g_logger<<"[ERROR] 解压目录不存在: "<<extractPath<<std::endl;
+        LOG_ERROR<<"解压目录不存在: "<<extractPath<<std::endl;
         return false;
     }
 
@@ -286,7 +281,7 @@ bool FileSystemHelper::ValidateExtraction(const std::string& extractPath) {
                 try {
                     auto fileSize=std::filesystem::file_size(entry.path());
                     if(fileSize==0) {
-                        g_logger<<"[WARN] 发现空文件: "<<entry.path().string()<<std::endl;
+                        LOG_WARN<<"发现空文件: "<<entry.path().string()<<std::endl;
                     }
                 }
                 catch(...) {
@@ -294,22 +289,22 @@ bool FileSystemHelper::ValidateExtraction(const std::string& extractPath) {
             }
         }
 
-        g_logger<<"[INFO] 解压验证: 总共 "<<(fileCount+dirCount)<<" 个条目 ("
+        LOG_INFO<<"解压验证: 总共 "<<(fileCount+dirCount)<<" 个条目 ("
             <<fileCount<<" 个文件, "<<dirCount<<" 个目录)"<<std::endl;
 
         if(fileCount==0&&dirCount==0) {
-            g_logger<<"[WARN] 解压目录为空，可能解压失败"<<std::endl;
+            LOG_WARN<<"解压目录为空，可能解压失败"<<std::endl;
             return false;
         }
 
         if(fileCount+dirCount<3) {
-            g_logger<<"[WARN] 解压条目数量较少，可能未完全解压"<<std::endl;
+            LOG_WARN<<"解压条目数量较少，可能未完全解压"<<std::endl;
         }
 
         return true;
     }
     catch(const std::exception& e) {
-        g_logger<<"[ERROR] 验证解压结果失败: "<<e.what()<<std::endl;
+        LOG_ERROR<<"验证解压结果失败: "<<e.what()<<std::endl;
         return false;
     }
 }
@@ -420,4 +415,66 @@ std::wstring FileSystemHelper::SecureCombineW(const std::wstring& baseDir,const
     std::wstring result=full.wstring();
     if(!result.empty()&&result.back()==L'/') result.pop_back();
     return result;
+}
+std::filesystem::path FileSystemHelper::CanonicalBaseW(const std::wstring& baseDir) {
+    if(baseDir.empty()) {
+        throw std::runtime_error("CanonicalBaseW: base directory is empty");
+    }
+
+    std::error_code ec;
+    std::filesystem::path base=std::filesystem::absolute(std::filesystem::path(baseDir),ec);
+    if(ec) {
+        throw std::runtime_error("CanonicalBaseW: cannot resolve base path");
+    }
+    std::filesystem::path canonical=std::filesystem::weakly_canonical(base,ec);
+    return ec?base:canonical;
+}
+std::wstring FileSystemHelper::SecureCombineLexicalW(const std::filesystem::path& canonicalBase,const std::wstring& userPath) {
+    std::wstring cleanUserPath=userPath;
+    std::replace(cleanUserPath.begin(),cleanUserPath.end(),L'\\',L'/');
+
+    std::filesystem::path relative(cleanUserPath);
+    if(relative.has_root_name()||relative.has_root_directory()) {
+        throw std::runtime_error("Path traversal detected (absolute path in entry)");
+    }
+    relative=relative.lexically_normal();
+    for(const auto& part:relative) {
+        if(part==L"..") {
+            throw std::runtime_error("Path traversal attempt (..) in entry path");
+        }
+    }
+
+    std::wstring result=(canonicalBase/relative).wstring();
+    while(!result.empty()&&(result.back()==L'/'||result.back()==L'\\')) {
+        result.pop_back();
+    }
+    return result;
+}
+void FileSystemHelper::VerifyWithinBaseW(const std::filesystem::path& canonicalBase,const std::wstring& directory) {
+    std::error_code ec;
+    std::filesystem::path resolved=std::filesystem::weakly_canonical(std::filesystem::path(directory),ec);
+    if(ec) {
+        throw std::runtime_error("VerifyWithinBaseW: cannot resolve path");
+    }
+
+    std::filesystem::path base=canonicalBase;
+    if(!base.has_filename()) {
+        base=base.parent_path();
+    }
+    auto mismatch=std::mismatch(base.begin(),base.end(),resolved.begin(),resolved.end());
+    if(mismatch.first!=base.end()) {
+        throw std::runtime_error("Path traversal detected (link resolves outside base)");
+    }
+}
+void FileSystemHelper::VerifyFileWithinBaseW(const std::filesystem::path& canonicalBase,const std::wstring& filePath) {
+    std::error_code ec;
+    std::filesystem::file_status status=std::filesystem::symlink_status(std::filesystem::path(filePath),ec);
+    // 不存在或是普通文件时不用解析，绝大多数条目只多一次查询
+    if(status.type()==std::filesystem::file_type::not_found||status.type()==std::filesystem::file_type::regular) {
+        return;
+    }
+    if(ec) {
+        throw std::runtime_error("VerifyFileWithinBaseW: cannot query path");
+    }
+    VerifyWithinBaseW(canonicalBase,filePath);
 }
\ No newline at end of file
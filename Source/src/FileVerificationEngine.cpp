@@ -0,0 +1,180 @@
+﻿#include "FileVerificationEngine.h"
+#include "FileHasher.h"
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+
+FileVerificationEngine::FileVerificationEngine(int threadCount,size_t queueCapacity)
+    : threadCount(threadCount),
+    queueCapacity(queueCapacity),
+    hashIndex(nullptr),
+    stopping(false),
+    nextSequence(0),
+    checkedCount(0),
+    missingCount(0),
+    mismatchedCount(0) {
+    if(this->threadCount<=0) {
+        unsigned int hardwareThreads=std::thread::hardware_concurrency();
+        this->threadCount=hardwareThreads>0?static_cast<int>(hardwareThreads):4;
+    }
+    if(this->queueCapacity==0) {
+        this->queueCapacity=static_cast<size_t>(this->threadCount)*64;
+    }
+}
+
+FileVerificationEngine::~FileVerificationEngine() {
+    StopWorkers();
+}
+
+void FileVerificationEngine::Start(const std::string& algorithm,HashIndex* index) {
+    StopWorkers();
+
+    hashAlgorithm=algorithm;
+    hashIndex=index;
+    stopping=false;
+    nextSequence=0;
+    taskQueue.clear();
+    collectedResults.clear();
+    checkedCount=0;
+    missingCount=0;
+    mismatchedCount=0;
+
+    workers.reserve(threadCount);
+    for(int i=0; i<threadCount; i++) {
+        workers.emplace_back(&FileVerificationEngine::WorkerLoop,this);
+    }
+}
+
+void FileVerificationEngine::Submit(VerifyTask task) {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    queueNotFull.wait(lock,[this]() { return taskQueue.size()<queueCapacity||stopping; });
+    if(stopping) {
+        return;
+    }
+    taskQueue.push_back({nextSequence++,std::move(task)});
+    lock.unlock();
+    queueNotEmpty.notify_one();
+}
+
+void FileVerificationEngine::AddResult(const std::string& relativePath,VerifyStatus status) {
+    size_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        sequence=nextSequence++;
+    }
+    RecordResult(sequence,{relativePath,status,""});
+}
+
+bool FileVerificationEngine::Finish(std::vector<VerifyResult>& results,ProgressCallback progressCallback) {
+    size_t expected;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        expected=nextSequence;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(resultMutex);
+        while(collectedResults.size()<expected) {
+            resultAdded.wait_for(lock,std::chrono::milliseconds(200));
+            if(progressCallback) {
+                lock.unlock();
+                progressCallback(checkedCount,missingCount,mismatchedCount);
+                lock.lock();
+            }
+        }
+    }
+
+    StopWorkers();
+
+    std::sort(collectedResults.begin(),collectedResults.end(),
+        [](const SequencedResult& a,const SequencedResult& b) { return a.sequence<b.sequence; });
+
+    results.clear();
+    results.reserve(collectedResults.size());
+    for(auto& item:collectedResults) {
+        results.push_back(std::move(item.result));
+    }
+    collectedResults.clear();
+
+    return missingCount==0&&mismatchedCount==0;
+}
+
+void FileVerificationEngine::WorkerLoop() {
+    for(;;) {
+        QueuedTask item;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueNotEmpty.wait(lock,[this]() { return !taskQueue.empty()||stopping; });
+            if(taskQueue.empty()) {
+                return;
+            }
+            item=std::move(taskQueue.front());
+            taskQueue.pop_front();
+        }
+        queueNotFull.notify_one();
+
+        VerifyResult result;
+        result.relativePath=std::move(item.task.relativePath);
+
+        std::error_code ec;
+        if(!std::filesystem::exists(item.task.fullPath,ec)) {
+            result.status=VerifyStatus::Missing;
+        }
+        else {
+            result.actualHash=FileHasher::CalculateFileHashCached(item.task.fullPath,hashAlgorithm,hashIndex);
+            if(result.actualHash.empty()) {
+                result.status=VerifyStatus::HashFailed;
+            }
+            else if(result.actualHash!=item.task.expectedHash) {
+                result.status=VerifyStatus::Mismatch;
+            }
+            else {
+                result.status=VerifyStatus::Match;
+            }
+        }
+
+        RecordResult(item.sequence,std::move(result));
+    }
+}
+
+void FileVerificationEngine::RecordResult(size_t sequence,VerifyResult result) {
+    switch(result.status) {
+    case VerifyStatus::Match:
+        checkedCount++;
+        break;
+    case VerifyStatus::Missing:
+        checkedCount++;
+        missingCount++;
+        break;
+    case VerifyStatus::Mismatch:
+    case VerifyStatus::HashFailed:
+        checkedCount++;
+        mismatchedCount++;
+        break;
+    case VerifyStatus::PathBlocked:
+        mismatchedCount++;
+        break;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        collectedResults.push_back({sequence,std::move(result)});
+    }
+    resultAdded.notify_one();
+}
+
+void FileVerificationEngine::StopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping=true;
+    }
+    queueNotEmpty.notify_all();
+    queueNotFull.notify_all();
+
+    for(auto& worker:workers) {
+        if(worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
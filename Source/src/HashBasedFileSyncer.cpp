@@ -11,10 +11,12 @@
 #include <sstream>
 #include <queue>
 #include <map>
+#include <unordered_map>
 #include <algorithm>
 #include <mutex>
 #include <memory>
 #include "FileHasher.h"
+#include "DownloadScheduler.h"
 #include <fcntl.h>
 #include <io.h>
 #include <windows.h>
@@ -28,352 +30,340 @@ HashBasedFileSyncer::HashBasedFileSyncer(HttpClient& http,
     ProgressReporter& reporter,
     FileSystemHelper& fs,
     ZipExtractor& zip,
-    ConfigManager& config)
+    ConfigManager& config,
+    HashIndex& index)
     : httpClient(http),
     updateOrchestrator(orc),
     progressReporter(reporter),
     fsHelper(fs),
     zipExtractor(zip),
-    configManager(config)
+    configManager(config),
+    hashIndex(index)
 {
 }
-bool HashBasedFileSyncer::CheckFileConsistency(const Json::Value& fileManifest,const Json::Value& directoryManifest) {
-    std::string hashAlgorithm=configManager.ReadHashAlgorithm();
-    bool allFilesConsistent=true;
-    int missingFiles=0;
-    int mismatchedFiles=0;
-    int totalChecked=0;
-
-    g_logger<<"[DEBUG] 开始文件一致性检查..."<<std::endl;
-    const int BATCH_SIZE=50;
-    int processedInBatch=0;
-
-    auto processBatch=[&]() {
-        if(processedInBatch>=BATCH_SIZE) {
-            HANDLE heap=GetProcessHeap();
-            if(heap!=NULL) {
-                HeapCompact(heap,0);
+bool HashBasedFileSyncer::CheckFileConsistency(const Manifest& manifest,
+    std::vector<FileVerificationEngine::VerifyResult>* verifyResults) {
+    return RunConsistencyCheck([&](FileVerificationEngine& engine) {
+        // 路径和摘要复用同一组缓冲区
+        std::string relativePath;
+        std::string expectedHash;
+        for(uint32_t i=0; i<manifest.GetFileCount(); i++) {
+            relativePath.assign(manifest.GetPath(i));
+            std::string fullPath;
+            try {
+                fullPath=FileSystemHelper::SecureCombine(updateOrchestrator.GetGameDirectory(),relativePath);
+            }
+            catch(const std::exception& e) {
+                LOG_ERROR<<"Path traversal blocked in file consistency check: "<<e.what()<<std::endl;
+                engine.AddResult(relativePath,FileVerificationEngine::VerifyStatus::PathBlocked);
+                continue;
             }
 
-            std::cout<<"\r检查进度: "<<totalChecked<<" 文件 ("<<missingFiles<<" 缺失, "<<mismatchedFiles<<" 不匹配)      ";
-            std::cout.flush();
-
-            processedInBatch=0;
-        }
-        };
-
-    for(const auto& fileInfo:fileManifest) {
-        processBatch();
-
-        std::string relativePath=fileInfo["path"].asString();
-        std::string expectedHash=fileInfo["hash"].asString();
-        std::string fullPath;
-        try {
-            fullPath=FileSystemHelper::SecureCombine(updateOrchestrator.GetGameDirectory(),relativePath);
-        }
-        catch(const std::exception& e) {
-            g_logger<<"[ERROR] Path traversal blocked in file consistency check: "<<e.what()<<std::endl;
-            allFilesConsistent=false;
-            mismatchedFiles++;
-            continue;
-        }
-
-        totalChecked++;
-        processedInBatch++;
-
-        if(!std::filesystem::exists(fullPath)) {
-            g_logger<<"[DEBUG] 文件不存在: "<<relativePath<<std::endl;
-            allFilesConsistent=false;
-            missingFiles++;
-            continue;
-        }
-
-        std::string actualHash=FileHasher::CalculateFileHashStream(fullPath,hashAlgorithm);
-        if(actualHash.empty()) {
-            g_logger<<"[DEBUG] 无法计算文件哈希: "<<relativePath<<std::endl;
-            allFilesConsistent=false;
-            mismatchedFiles++;
-        }
-        else if(actualHash!=expectedHash) {
-            g_logger<<"[DEBUG] 文件哈希不匹配: "<<relativePath<<std::endl;
-            allFilesConsistent=false;
-            mismatchedFiles++;
-        }
-    }
-
-    for(const auto& dirInfo:directoryManifest) {
-        std::string relativePath=dirInfo["path"].asString();
-        std::string fullPath;
-        try {
-            fullPath=FileSystemHelper::SecureCombine(updateOrchestrator.GetGameDirectory(),relativePath);
-        }
-        catch(const std::exception& e) {
-            g_logger<<"[ERROR] Path traversal blocked in directory existence check: "<<e.what()<<std::endl;
-            allFilesConsistent=false;
-            missingFiles++;
-            continue;
-        }
-
-        if(!std::filesystem::exists(fullPath)) {
-            g_logger<<"[DEBUG] 目录不存在: "<<relativePath<<std::endl;
-            allFilesConsistent=false;
-            missingFiles++;
-            continue;
+            manifest.GetDigestHex(i,expectedHash);
+            engine.Submit({relativePath,fullPath,expectedHash});
         }
 
-        const Json::Value& contents=dirInfo["contents"];
-        for(const auto& contentInfo:contents) {
-            processBatch();
-
-            std::string fileRelativePath=contentInfo["path"].asString();
-            std::string expectedHash=contentInfo["hash"].asString();
-            std::string fileFullPath;
+        for(uint32_t i=0; i<manifest.GetDirectoryCount(); i++) {
+            relativePath.assign(manifest.GetDirectoryPath(i));
+            std::string fullPath;
             try {
-                fileFullPath=FileSystemHelper::SecureCombine(fullPath,fileRelativePath);
+                fullPath=FileSystemHelper::SecureCombine(updateOrchestrator.GetGameDirectory(),relativePath);
             }
             catch(const std::exception& e) {
-                g_logger<<"[ERROR] Path traversal blocked in directory content check: "<<e.what()<<std::endl;
-                allFilesConsistent=false;
-                mismatchedFiles++;
+                LOG_ERROR<<"Path traversal blocked in directory existence check: "<<e.what()<<std::endl;
+                engine.AddResult(relativePath,FileVerificationEngine::VerifyStatus::Missing);
                 continue;
             }
 
-            totalChecked++;
-            processedInBatch++;
-
-            if(!std::filesystem::exists(fileFullPath)) {
-                g_logger<<"[DEBUG] 目录内文件不存在: "<<fileRelativePath<<std::endl;
-                allFilesConsistent=false;
-                missingFiles++;
+            if(!std::filesystem::exists(fullPath)) {
+                engine.AddResult(relativePath,FileVerificationEngine::VerifyStatus::Missing);
                 continue;
             }
 
-            std::string actualHash=FileHasher::CalculateFileHashStream(fileFullPath,hashAlgorithm);
-            if(actualHash.empty()) {
-                g_logger<<"[DEBUG] 无法计算目录内文件哈希: "<<fileRelativePath<<std::endl;
-                allFilesConsistent=false;
-                mismatchedFiles++;
-            }
-            else if(actualHash!=expectedHash) {
-                g_logger<<"[DEBUG] 目录内文件哈希不匹配: "<<fileRelativePath<<std::endl;
-                allFilesConsistent=false;
-                mismatchedFiles++;
+            Manifest::Range contents=manifest.GetDirectoryContents(i);
+            for(uint32_t entry=contents.first; entry<contents.first+contents.count; entry++) {
+                relativePath.assign(manifest.GetPath(entry));
+                std::string fileFullPath;
+                try {
+                    fileFullPath=FileSystemHelper::SecureCombine(fullPath,relativePath);
+                }
+                catch(const std::exception& e) {
+                    LOG_ERROR<<"Path traversal blocked in directory content check: "<<e.what()<<std::endl;
+                    engine.AddResult(relativePath,FileVerificationEngine::VerifyStatus::PathBlocked);
+                    continue;
+                }
+
+                manifest.GetDigestHex(entry,expectedHash);
+                engine.Submit({relativePath,fileFullPath,expectedHash});
             }
         }
+        },verifyResults);
+}
+bool HashBasedFileSyncer::RunConsistencyCheck(const std::function<void(FileVerificationEngine&)>& submitEntries,
+    std::vector<FileVerificationEngine::VerifyResult>* verifyResults) {
+    const ConfigSnapshot& config=configManager.GetSnapshot();
+    const std::string& hashAlgorithm=config.hashAlgorithm;
+    FileVerificationEngine engine(config.verifyThreads);
+
+    LOG_DEBUG<<"开始文件一致性检查... (校验线程: "<<engine.GetThreadCount()
+        <<", 算法: "<<hashAlgorithm<<", SIMD: "<<FileHasher::DescribeSimdSupport()<<")"<<std::endl;
+    if(!FileHasher::IsSupportedAlgorithm(hashAlgorithm)) {
+        LOG_WARN<<"不支持的哈希算法: "<<hashAlgorithm<<" (可选 md5/sha1/sha256/blake3/xxh3-128)"<<std::endl;
+    }
+
+    auto showProgress=[](int checked,int missing,int mismatched) {
+        std::cout<<"\r检查进度: "<<checked<<" 文件 ("<<missing<<" 缺失, "<<mismatched<<" 不匹配)      ";
+        std::cout.flush();
+        };
+
+    hashIndex.Load();
+    engine.Start(hashAlgorithm,&hashIndex);
+
+    submitEntries(engine);
+
+    std::vector<FileVerificationEngine::VerifyResult> results;
+    bool allFilesConsistent=engine.Finish(results,showProgress);
+    hashIndex.Save();
+
+    for(const auto& result:results) {
+        switch(result.status) {
+        case FileVerificationEngine::VerifyStatus::Missing:
+            LOG_DEBUG<<"文件不存在: "<<result.relativePath<<std::endl;
+            break;
+        case FileVerificationEngine::VerifyStatus::HashFailed:
+            LOG_DEBUG<<"无法计算文件哈希: "<<result.relativePath<<std::endl;
+            break;
+        case FileVerificationEngine::VerifyStatus::Mismatch:
+            LOG_DEBUG<<"文件哈希不匹配: "<<result.relativePath<<std::endl;
+            break;
+        default:
+            break;
+        }
     }
 
+    int totalChecked=engine.GetCheckedCount();
+    int missingFiles=engine.GetMissingCount();
+    int mismatchedFiles=engine.GetMismatchedCount();
+
     std::cout<<"\r检查完成: "<<totalChecked<<" 文件 ("<<missingFiles<<" 缺失, "<<mismatchedFiles<<" 不匹配)      "<<std::endl;
 
-    g_logger<<"[INFO] 文件一致性检查完成:"<<std::endl;
-    g_logger<<"[INFO]   总共检查: "<<totalChecked<<" 个文件"<<std::endl;
-    g_logger<<"[INFO]   缺失文件: "<<missingFiles<<" 个"<<std::endl;
-    g_logger<<"[INFO]   不匹配文件: "<<mismatchedFiles<<" 个"<<std::endl;
-    g_logger<<"[INFO]   文件一致性: "<<(allFilesConsistent?"通过":"失败")<<std::endl;
+    LOG_INFO<<"文件一致性检查完成:"<<std::endl;
+    LOG_INFO<<"  总共检查: "<<totalChecked<<" 个文件"<<std::endl;
+    LOG_INFO<<"  缺失文件: "<<missingFiles<<" 个"<<std::endl;
+    LOG_INFO<<"  不匹配文件: "<<mismatchedFiles<<" 个"<<std::endl;
+    LOG_INFO<<"  文件一致性: "<<(allFilesConsistent?"通过":"失败")<<std::endl;
+    LOG_DEBUG<<"  哈希索引命中: "<<hashIndex.GetHitCount()<<", 未命中: "<<hashIndex.GetMissCount()<<std::endl;
+
+    if(verifyResults) {
+        *verifyResults=std::move(results);
+    }
 
     return allFilesConsistent;
 }
-bool HashBasedFileSyncer::SyncFilesByHash(const Json::Value& updateInfo) {
-    g_logger<<"[INFO] 开始哈希模式同步..."<<std::endl;
-    g_logger<<"[DEBUG] 更新信息包含files字段: "<<updateInfo.isMember("files")<<std::endl;
-    g_logger<<"[DEBUG] 更新信息包含directories字段: "<<updateInfo.isMember("directories")<<std::endl;
-    g_logger<<"[DEBUG] 更新信息包含file_manifest字段: "<<updateInfo.isMember("file_manifest")<<std::endl;
-    g_logger<<"[DEBUG] 更新信息包含directory_manifest字段: "<<updateInfo.isMember("directory_manifest")<<std::endl;
-
-    if(configManager.ReadEnableFileDeletion()) {
-        ProcessDeleteList(updateInfo["delete_list"]);
-    }
+bool HashBasedFileSyncer::SyncFilesByHash(const Manifest& manifest) {
+    LOG_INFO<<"开始哈希模式同步..."<<std::endl;
+    LOG_DEBUG<<"清单来源: "<<(manifest.IsFromBinary()?"二进制清单":"JSON")<<std::endl;
 
-    Json::Value fileManifest=updateInfo["files"];
-    Json::Value directoryManifest=updateInfo["directories"];
+    if(configManager.GetSnapshot().enableFileDeletion) {
+        ProcessDeleteList(manifest.GetDeleteList());
+    }
 
-    g_logger<<"[DEBUG] 文件清单数量: "<<fileManifest.size()<<std::endl;
-    g_logger<<"[DEBUG] 目录清单数量: "<<directoryManifest.size()<<std::endl;
+    LOG_DEBUG<<"文件清单数量: "<<manifest.GetFileCount()<<std::endl;
+    LOG_DEBUG<<"目录清单数量: "<<manifest.GetDirectoryCount()<<std::endl;
 
-    if(!UpdateFilesByHash(fileManifest,directoryManifest)) {
+    bool filesUpdated=UpdateFilesByHash(manifest);
+    hashIndex.Save();
+    if(!filesUpdated) {
         return false;
     }
 
-    g_logger<<"[INFO] 开始创建空目录..."<<std::endl;
+    LOG_INFO<<"开始创建空目录..."<<std::endl;
     int createdEmptyDirs=0;
-    for(const auto& dirInfo:directoryManifest) {
-        bool isEmpty=dirInfo.isMember("is_empty")&&dirInfo["is_empty"].asBool();
-        if(!isEmpty) continue;
-
-        std::string relativePath=dirInfo["path"].asString();
+    auto createEmptyDirectory=[this,&createdEmptyDirs](const std::string& relativePath) {
         std::filesystem::path fullPath=std::filesystem::absolute(updateOrchestrator.GetGameDirectory())/relativePath;
         if(!std::filesystem::exists(fullPath)) {
             try {
                 std::filesystem::create_directories(fullPath);
-                g_logger<<"[INFO] 创建空目录: "<<relativePath<<std::endl;
+                LOG_INFO<<"创建空目录: "<<relativePath<<std::endl;
                 createdEmptyDirs++;
             }
             catch(const std::exception& e) {
-                g_logger<<"[ERROR] 创建空目录失败: "<<relativePath<<" - "<<e.what()<<std::endl;
+                LOG_ERROR<<"创建空目录失败: "<<relativePath<<" - "<<e.what()<<std::endl;
             }
         }
         else {
-            g_logger<<"[DEBUG] 空目录已存在: "<<relativePath<<std::endl;
+            LOG_DEBUG<<"空目录已存在: "<<relativePath<<std::endl;
+        }
+        };
+
+    for(uint32_t i=0; i<manifest.GetDirectoryCount(); i++) {
+        if(manifest.IsEmptyDirectory(i)) {
+            createEmptyDirectory(std::string(manifest.GetDirectoryPath(i)));
         }
     }
-    g_logger<<"[INFO] 空目录创建完成，共创建 "<<createdEmptyDirs<<" 个"<<std::endl;
+    LOG_INFO<<"空目录创建完成，共创建 "<<createdEmptyDirs<<" 个"<<std::endl;
 
-    g_logger<<"[INFO] 哈希模式同步完成"<<std::endl;
+    LOG_INFO<<"哈希模式同步完成"<<std::endl;
     return true;
 }
-bool HashBasedFileSyncer::UpdateFilesByHash(const Json::Value& fileManifest,const Json::Value& directoryManifest) {
-    std::string hashAlgorithm=configManager.ReadHashAlgorithm();
+bool HashBasedFileSyncer::UpdateFilesByHash(const Manifest& manifest) {
+    // 快照在 ConfigManager 生命周期内有效，回调可直接引用其中的字段
+    const ConfigSnapshot& config=configManager.GetSnapshot();
+    const std::string& hashAlgorithm=config.hashAlgorithm;
     bool allSuccess=true;
 
-    int totalFiles=fileManifest.size();
-    int currentFile=0;
+    int totalFiles=static_cast<int>(manifest.GetFileCount());
+    int upToDateFiles=0;
 
-    std::cout<<std::endl;
+    DownloadScheduler scheduler(config.maxConcurrentDownloads,&httpClient);
+    scheduler.SetMaxAttempts(config.downloadRetries);
+    std::unordered_map<std::string,bool> writableDirs;
+    int queuedFiles=0;
+    int completedFiles=0;
 
-    for(const auto& fileInfo:fileManifest) {
-        currentFile++;
-        std::string relativePath=fileInfo["path"].asString();
-        std::string expectedHash=fileInfo["hash"].asString();
-        std::string url=fileInfo["url"].asString();
-
-        std::cout<<"["<<currentFile<<"/"<<totalFiles<<"] 下载: "<<relativePath<<std::endl;
-        std::string fileInfoStr="["+std::to_string(currentFile)+"/"+
-            std::to_string(totalFiles)+"] 下载: "+relativePath;
-        int padding=80-(int)fileInfoStr.length();
-        if(padding>0) {
-            std::cout<<std::string(padding,' ');
-        }
-        std::cout<<std::endl;
-        std::cout.flush();
+    std::cout<<std::endl;
 
+    // 大小未知时为 -1
+    auto queueFile=[&](const std::string& relativePath,const std::string& url,const std::string& expectedHash,long long expectedSize) {
         std::string fullPathStr;
         try {
             fullPathStr=FileSystemHelper::SecureCombine(updateOrchestrator.GetGameDirectory(),relativePath);
         }
         catch(const std::exception& e) {
-            g_logger<<"[ERROR] Path traversal blocked in UpdateFilesByHash: "<<e.what()<<std::endl;
+            LOG_ERROR<<"Path traversal blocked in UpdateFilesByHash: "<<e.what()<<std::endl;
             std::cout<<"[ERROR] 路径非法 "<<relativePath<<std::endl;
             allSuccess=false;
-            continue;
+            return;
         }
         std::filesystem::path fullPath=std::filesystem::path(fullPathStr);
         std::filesystem::path parentDir=fullPath.parent_path();
-        fsHelper.EnsureDirectoryExists(parentDir.string());
 
-        bool canWrite=false;
-        try {
-            std::filesystem::path testFile=parentDir/"write_test.tmp";
-            std::ofstream testStream(testFile);
-            if(testStream) {
-                testStream<<"test";
-                testStream.close();
-                std::filesystem::remove(testFile);
-                canWrite=true;
-                g_logger<<"[DEBUG] 目录写入权限检查通过: "<<parentDir.string()<<std::endl;
+        // 同一目录只做一次写入权限检查
+        auto writable=writableDirs.find(parentDir.string());
+        if(writable==writableDirs.end()) {
+            fsHelper.EnsureDirectoryExists(parentDir.string());
+
+            bool canWrite=false;
+            try {
+                std::filesystem::path testFile=parentDir/"write_test.tmp";
+                std::ofstream testStream(testFile);
+                if(testStream) {
+                    testStream<<"test";
+                    testStream.close();
+                    std::filesystem::remove(testFile);
+                    canWrite=true;
+                    LOG_DEBUG<<"目录写入权限检查通过: "<<parentDir.string()<<std::endl;
+                }
             }
-        }
-        catch(const std::exception& e) {
-            g_logger<<"[DEBUG] 目录写入权限检查失败: "<<e.what()<<std::endl;
+            catch(const std::exception& e) {
+                LOG_DEBUG<<"目录写入权限检查失败: "<<e.what()<<std::endl;
+            }
+            writable=writableDirs.emplace(parentDir.string(),canWrite).first;
         }
 
-        if(!canWrite) {
-            g_logger<<"[ERROR] 错误: 目录没有写入权限: "<<parentDir.string()<<std::endl;
+        if(!writable->second) {
+            LOG_ERROR<<"错误: 目录没有写入权限: "<<parentDir.string()<<std::endl;
             allSuccess=false;
-            continue;
+            return;
         }
 
         if(std::filesystem::exists(fullPath)) {
-            std::string actualHash=FileHasher::CalculateFileHashStream(fullPathStr,hashAlgorithm);
+            std::string actualHash=FileHasher::CalculateFileHashCached(fullPathStr,hashAlgorithm,&hashIndex);
             if(!actualHash.empty()&&actualHash==expectedHash) {
-                g_logger<<"[INFO] 文件已是最新: "<<relativePath<<std::endl;
-                continue;
+                LOG_INFO<<"文件已是最新: "<<relativePath<<std::endl;
+                upToDateFiles++;
+                return;
             }
         }
 
-        if(fileInfo.isMember("size")) {
-            long long fileSize=fileInfo["size"].asInt64();
-            int timeout=GetDownloadTimeoutForSize(fileSize);
-            httpClient.SetDownloadTimeout(timeout);
-            g_logger<<"[DEBUG] 设置文件下载超时: "<<timeout<<"秒 (大小: "<<progressReporter.FormatBytes(fileSize)<<")"<<std::endl;
+        DownloadScheduler::DownloadTask task;
+        task.url=url;
+        task.outputPath=fullPathStr;
+        task.hashAlgorithm=hashAlgorithm;
+        task.expectedHash=expectedHash;
+        if(expectedSize>=0) {
+            task.expectedSize=expectedSize;
+            task.timeoutSeconds=GetDownloadTimeoutForSize(task.expectedSize);
+            LOG_DEBUG<<"设置文件下载超时: "<<task.timeoutSeconds<<"秒 (大小: "<<progressReporter.FormatBytes(task.expectedSize)<<")"<<std::endl;
         }
-
-        std::string progressMessage="进度";
-
-        progressReporter.ShowProgressBar(progressMessage,0,1);
-
-        bool downloadSuccess=false;
-        long long fileSize=0;
-
-        if(fileInfo.isMember("size")) {
-            fileSize=fileInfo["size"].asInt64();
+        else {
+            task.timeoutSeconds=GetDownloadTimeoutForSize(0);
         }
 
-        auto progressCallback=[this,progressMessage,fileSize](long long downloaded,long long total,void* userdata) {
-            if(total<=0&&fileSize>0) {
-                progressReporter.ShowProgressBar(progressMessage,downloaded,fileSize);
+        task.onComplete=[this,relativePath,expectedHash,fullPathStr,&hashAlgorithm,totalFiles,&completedFiles,&allSuccess]
+        (const DownloadScheduler::DownloadResult& result) {
+            completedFiles++;
+            progressReporter.ClearProgressLine();
+
+            // 哈希不符的下载不会替换原文件，由调度器丢弃 .part
+            if(!result.success) {
+                if(result.error=="hash mismatch") {
+                    LOG_ERROR<<"文件哈希不匹配: "<<relativePath<<" 期望 "<<expectedHash<<std::endl;
+                }
+                else {
+                    LOG_ERROR<<"下载失败: "<<relativePath<<std::endl;
+                }
+                allSuccess=false;
+                return;
             }
-            else {
-                progressReporter.ShowProgressBar(progressMessage,downloaded,total);
+
+            std::string sizeStr=progressReporter.FormatBytes(result.bytes);
+            if(!expectedHash.empty()) {
+                HashIndex::FileStamp stamp;
+                if(HashIndex::GetFileStamp(fullPathStr,stamp)) {
+                    hashIndex.Store(fullPathStr,stamp,hashAlgorithm,result.digest);
+                }
             }
+            std::cout<<"["<<completedFiles<<"/"<<totalFiles<<"] "<<relativePath
+                <<"  [完成，大小: "<<sizeStr<<(expectedHash.empty()?"]":"，已验证]")<<std::endl;
             };
 
-        if(fileSize>0) {
-            int timeout=GetDownloadTimeoutForSize(fileSize);
-            httpClient.SetDownloadTimeout(timeout);
-        }
+        scheduler.Enqueue(std::move(task));
+        queuedFiles++;
+        };
 
-        downloadSuccess=httpClient.DownloadFileWithProgress(
-            url,
-            fullPathStr,
-            progressCallback,
-            nullptr
-        );
+    std::string relativePath;
+    std::string url;
+    std::string expectedHash;
+    for(uint32_t i=0; i<manifest.GetFileCount(); i++) {
+        relativePath.assign(manifest.GetPath(i));
+        url.assign(manifest.GetUrl(i));
+        manifest.GetDigestHex(i,expectedHash);
+        queueFile(relativePath,url,expectedHash,manifest.GetSize(i));
+    }
 
-        progressReporter.ClearProgressLine();
+    if(queuedFiles==0) {
+        LOG_INFO<<"没有需要下载的文件 ("<<upToDateFiles<<" 个已是最新)"<<std::endl;
+        return allSuccess;
+    }
 
-        httpClient.SetDownloadTimeout(0);
+    // 已是最新的文件也计入序号，保持与清单总数一致
+    completedFiles=totalFiles-queuedFiles;
 
-        if(!downloadSuccess) {
-            g_logger<<"[ERROR} 下载失败！"<<std::endl;
-            allSuccess=false;
-            continue;
-        }
+    LOG_INFO<<"开始下载 "<<queuedFiles<<" 个文件 (并发: "<<scheduler.GetMaxConcurrent()<<")"<<std::endl;
 
-        std::error_code ec;
-        auto actualSize=std::filesystem::file_size(fullPathStr,ec);
-        std::string sizeStr=ec?"未知大小":progressReporter.FormatBytes(actualSize);
+    scheduler.Run([this](long long downloaded,long long total,int completed,int queued) {
+        std::string progressMessage="下载 "+std::to_string(completed)+"/"+std::to_string(queued);
+        progressReporter.ShowProgressBar(progressMessage,downloaded,total>0?total:1);
+        });
+    progressReporter.ClearProgressLine();
 
-        if(!expectedHash.empty()) {
-            std::string downloadedHash=FileHasher::CalculateFileHashStream(fullPathStr,hashAlgorithm);
-            if(downloadedHash!=expectedHash) {
-                g_logger<<"[ERROR]哈希不匹配，删除文件"<<std::endl;
-                g_logger<<"[ERROR] 文件哈希不匹配: "<<relativePath
-                    <<" 期望 "<<expectedHash<<" 实际 "<<downloadedHash<<std::endl;
-                std::error_code removeEc;
-                std::filesystem::remove(fullPathStr,removeEc);
-                if(removeEc) {
-                    g_logger<<"[WARN] 删除损坏文件失败: "<<removeEc.message()<<std::endl;
-                }
-                allSuccess=false;
-                continue;
-            }
-            else {
-                std::cout<<"  [完成，大小: "<<sizeStr<<"，已验证]"<<std::endl;
-            }
-        }
-    }
+    LOG_INFO<<"下载完成: 成功 "<<scheduler.GetSucceededCount()<<" 个, 失败 "<<scheduler.GetFailedCount()<<" 个"<<std::endl;
+    httpClient.LogConnectionStats();
 
     return allSuccess;
 }
-bool HashBasedFileSyncer::SyncDirectoryByHash(const Json::Value& dirInfo) {
-    std::string relativePath=dirInfo["path"].asString();
-    std::string url=dirInfo["url"].asString();
-    std::string hashAlgorithm=configManager.ReadHashAlgorithm();
+bool HashBasedFileSyncer::SyncDirectoryByHash(const Manifest& manifest,uint32_t directory) {
+    std::string relativePath(manifest.GetDirectoryPath(directory));
+    std::string url(manifest.GetDirectoryUrl(directory));
+    const ConfigSnapshot& config=configManager.GetSnapshot();
+    const std::string& hashAlgorithm=config.hashAlgorithm;
 
-    g_logger<<"[INFO] 同步目录: "<<relativePath<<std::endl;
+    LOG_INFO<<"同步目录: "<<relativePath<<std::endl;
 
     std::vector<unsigned char> zipData;
     if(!httpClient.DownloadToMemory(url,zipData)) {
-        g_logger<<"[ERROR] 目录下载失败: "<<relativePath<<std::endl;
+        LOG_ERROR<<"目录下载失败: "<<relativePath<<std::endl;
         return false;
     }
 
@@ -387,7 +377,7 @@ bool HashBasedFileSyncer::SyncDirectoryByHash(const Json::Value& dirInfo) {
     fsHelper.EnsureDirectoryExists(tempDir);
 
     if(!zipExtractor.ExtractZip(zipData,tempDir)) {
-        g_logger<<"[ERROR] 解压失败: "<<relativePath<<std::endl;
+        LOG_ERROR<<"解压失败: "<<relativePath<<std::endl;
         return false;
     }
 
@@ -396,17 +386,22 @@ bool HashBasedFileSyncer::SyncDirectoryByHash(const Json::Value& dirInfo) {
         targetDir=FileSystemHelper::SecureCombine(updateOrchestrator.GetGameDirectory(),relativePath);
     }
     catch(const std::exception& e) {
-        g_logger<<"[ERROR] 路径遍历被阻止: "<<relativePath<<" - "<<e.what()<<std::endl;
+        LOG_ERROR<<"路径遍历被阻止: "<<relativePath<<" - "<<e.what()<<std::endl;
         return false;
     }
     fsHelper.EnsureDirectoryExists(targetDir);
 
-    const Json::Value& contents=dirInfo["contents"];
+    Manifest::Range contents=manifest.GetDirectoryContents(directory);
+    std::vector<std::string> expectedPaths;
+    expectedPaths.reserve(contents.count);
     bool dirSuccess=true;
 
-    for(const auto& contentInfo:contents) {
-        std::string fileRelativePath=contentInfo["path"].asString();
-        std::string expectedHash=contentInfo["hash"].asString();
+    std::string fileRelativePath;
+    std::string expectedHash;
+    for(uint32_t entry=contents.first; entry<contents.first+contents.count; entry++) {
+        fileRelativePath.assign(manifest.GetPath(entry));
+        manifest.GetDigestHex(entry,expectedHash);
+        expectedPaths.push_back(fileRelativePath);
 
         std::string tempFilePath;
         std::string targetFilePath;
@@ -415,25 +410,27 @@ bool HashBasedFileSyncer::SyncDirectoryByHash(const Json::Value& dirInfo) {
             targetFilePath=FileSystemHelper::SecureCombine(targetDir,fileRelativePath);
         }
         catch(const std::exception& e) {
-            g_logger<<"[ERROR] 临时文件路径遍历被阻止: "<<e.what()<<std::endl;
+            LOG_ERROR<<"临时文件路径遍历被阻止: "<<e.what()<<std::endl;
             dirSuccess=false;
             continue;
         }
         if(!std::filesystem::exists(tempFilePath)) {
-            g_logger<<"[WARN] 解压文件中不存在: "<<fileRelativePath<<std::endl;
+            LOG_WARN<<"解压文件中不存在: "<<fileRelativePath<<std::endl;
             dirSuccess=false;
             continue;
         }
 
+        bool hashVerified=false;
         if(!expectedHash.empty()) {
             std::string actualHash=FileHasher::CalculateFileHashStream(tempFilePath,hashAlgorithm);
-            if(actualHash!=expectedHash) {
-                g_logger<<"[WARN] 解压文件哈希验证失败: "<<fileRelativePath<<std::endl;
-                g_logger<<"[WARN] 期望: "<<expectedHash<<std::endl;
-                g_logger<<"[WARN] 实际: "<<actualHash<<std::endl;
+            hashVerified=(actualHash==expectedHash);
+            if(!hashVerified) {
+                LOG_WARN<<"解压文件哈希验证失败: "<<fileRelativePath<<std::endl;
+                LOG_WARN<<"期望: "<<expectedHash<<std::endl;
+                LOG_WARN<<"实际: "<<actualHash<<std::endl;
             }
             else {
-                g_logger<<"[DEBUG] 解压文件哈希验证成功: "<<fileRelativePath<<std::endl;
+                LOG_DEBUG<<"解压文件哈希验证成功: "<<fileRelativePath<<std::endl;
             }
         }
 
@@ -442,40 +439,40 @@ bool HashBasedFileSyncer::SyncDirectoryByHash(const Json::Value& dirInfo) {
         try {
             std::filesystem::copy(tempFilePath,targetFilePath,
                 std::filesystem::copy_options::overwrite_existing);
-            g_logger<<"[INFO] 更新文件: "<<fileRelativePath<<std::endl;
+            LOG_INFO<<"更新文件: "<<fileRelativePath<<std::endl;
+
+            HashIndex::FileStamp stamp;
+            if(hashVerified&&HashIndex::GetFileStamp(targetFilePath,stamp)) {
+                hashIndex.Store(targetFilePath,stamp,hashAlgorithm,expectedHash);
+            }
         }
         catch(const std::exception& e) {
-            g_logger<<"[ERROR] 文件复制失败: "<<fileRelativePath<<" - "<<e.what()<<std::endl;
+            LOG_ERROR<<"文件复制失败: "<<fileRelativePath<<" - "<<e.what()<<std::endl;
             dirSuccess=false;
         }
     }
 
-    if(configManager.ReadEnableFileDeletion()) {
-        fsHelper.CleanupOrphanedFiles(updateOrchestrator.GetGameDirectory(),relativePath,contents);
+    if(config.enableFileDeletion) {
+        fsHelper.CleanupOrphanedFiles(updateOrchestrator.GetGameDirectory(),relativePath,expectedPaths);
     }
 
     try {
         std::filesystem::remove_all(tempDir);
     }
     catch(const std::exception& e) {
-        g_logger<<"[WARN] 清理临时目录失败: "<<e.what()<<std::endl;
+        LOG_WARN<<"清理临时目录失败: "<<e.what()<<std::endl;
     }
 
     return dirSuccess;
 }
-bool HashBasedFileSyncer::ProcessDeleteList(const Json::Value& deleteList) {
-    if(!deleteList.isArray()) {
-        return true;
-    }
-
-    for(const auto& item:deleteList) {
-        std::string path=item.asString();
+bool HashBasedFileSyncer::ProcessDeleteList(const std::vector<std::string>& deleteList) {
+    for(const auto& path:deleteList) {
         std::string fullPath;
         try {
             fullPath=FileSystemHelper::SecureCombine(updateOrchestrator.GetGameDirectory(),path);
         }
         catch(const std::exception& e) {
-            g_logger<<"[ERROR] 删除路径遍历攻击被阻止: "<<e.what()<<std::endl;
+            LOG_ERROR<<"删除路径遍历攻击被阻止: "<<e.what()<<std::endl;
             continue;
         }
 
@@ -483,16 +480,16 @@ bool HashBasedFileSyncer::ProcessDeleteList(const Json::Value& deleteList) {
             if(std::filesystem::exists(fullPath)) {
                 if(std::filesystem::is_directory(fullPath)) {
                     std::filesystem::remove_all(fullPath);
-                    g_logger<<"[INFO] 删除目录: "<<path<<std::endl;
+                    LOG_INFO<<"删除目录: "<<path<<std::endl;
                 }
                 else {
                     std::filesystem::remove(fullPath);
-                    g_logger<<"[INFO] 删除文件: "<<path<<std::endl;
+                    LOG_INFO<<"删除文件: "<<path<<std::endl;
                 }
             }
         }
         catch(const std::exception& e) {
-            g_logger<<"[WARN] 删除失败: "<<path<<" - "<<e.what()<<std::endl;
+            LOG_WARN<<"删除失败: "<<path<<" - "<<e.what()<<std::endl;
         }
     }
     return true;
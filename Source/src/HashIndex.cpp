@@ -0,0 +1,225 @@
+﻿#include "HashIndex.h"
+#include "Logger.h"
+#include <fstream>
+#include <filesystem>
+#include <json/json.h>
+#include <windows.h>
+
+namespace {
+    const int HASH_INDEX_FORMAT_VERSION=1;
+}
+
+HashIndex::HashIndex(const std::string& indexPath,const std::string& baseDirectory)
+    : indexPath(indexPath),
+    enabled(true),
+    loaded(false),
+    dirty(false),
+    hitCount(0),
+    missCount(0) {
+    std::error_code ec;
+    std::filesystem::path base=std::filesystem::weakly_canonical(std::filesystem::absolute(baseDirectory,ec),ec);
+    if(ec) {
+        base=std::filesystem::absolute(baseDirectory,ec);
+    }
+    basePrefix=base.generic_string();
+    if(!basePrefix.empty()&&basePrefix.back()!='/') {
+        basePrefix+='/';
+    }
+}
+
+void HashIndex::Load() {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    EnsureLoaded();
+}
+
+bool HashIndex::Save() {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    if(!enabled||!dirty) {
+        return true;
+    }
+
+    Json::Value root;
+    root["format_version"]=HASH_INDEX_FORMAT_VERSION;
+    Json::Value& items=root["entries"];
+    items=Json::Value(Json::objectValue);
+    for(const auto& [key,entry]:entries) {
+        Json::Value item;
+        item["size"]=Json::UInt64(entry.stamp.size);
+        item["mtime"]=Json::UInt64(entry.stamp.mtime);
+        item["file_id"]=Json::UInt64(entry.stamp.fileId);
+        item["algorithm"]=entry.algorithm;
+        item["hash"]=entry.hash;
+        items[key]=std::move(item);
+    }
+
+    std::error_code ec;
+    std::filesystem::path target(indexPath);
+    if(target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path(),ec);
+    }
+
+    // 先写临时文件再重命名，避免中途退出留下半个索引
+    std::string tempPath=indexPath+".tmp";
+    {
+        std::ofstream file(tempPath,std::ios::binary|std::ios::trunc);
+        if(!file.is_open()) {
+            LOG_WARN<<"无法写入哈希索引: "<<tempPath<<std::endl;
+            return false;
+        }
+        Json::StreamWriterBuilder writer;
+        writer["indentation"]="";
+        file<<Json::writeString(writer,root);
+        if(!file.good()) {
+            LOG_WARN<<"写入哈希索引失败: "<<tempPath<<std::endl;
+            file.close();
+            std::filesystem::remove(tempPath,ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath,indexPath,ec);
+    if(ec) {
+        LOG_WARN<<"替换哈希索引失败: "<<ec.message()<<std::endl;
+        std::filesystem::remove(tempPath,ec);
+        return false;
+    }
+
+    dirty=false;
+    LOG_DEBUG<<"哈希索引已保存: "<<entries.size()<<" 条记录"<<std::endl;
+    return true;
+}
+
+void HashIndex::Invalidate() {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    entries.clear();
+    loaded=true;
+    dirty=false;
+
+    std::error_code ec;
+    std::filesystem::remove(indexPath,ec);
+    if(ec) {
+        LOG_WARN<<"删除哈希索引失败: "<<ec.message()<<std::endl;
+    }
+    else {
+        LOG_INFO<<"哈希索引已清除: "<<indexPath<<std::endl;
+    }
+}
+
+bool HashIndex::Lookup(const std::string& filePath,const FileStamp& stamp,const std::string& algorithm,std::string& hash) {
+    if(!enabled) {
+        return false;
+    }
+
+    std::string key=MakeKey(filePath);
+    std::lock_guard<std::mutex> lock(indexMutex);
+    EnsureLoaded();
+
+    auto it=entries.find(key);
+    if(it==entries.end()||it->second.stamp!=stamp||it->second.algorithm!=algorithm) {
+        missCount++;
+        return false;
+    }
+
+    hash=it->second.hash;
+    hitCount++;
+    return true;
+}
+
+void HashIndex::Store(const std::string& filePath,const FileStamp& stamp,const std::string& algorithm,const std::string& hash) {
+    if(!enabled||hash.empty()) {
+        return;
+    }
+
+    std::string key=MakeKey(filePath);
+    std::lock_guard<std::mutex> lock(indexMutex);
+    EnsureLoaded();
+
+    Entry& entry=entries[key];
+    entry.stamp=stamp;
+    entry.algorithm=algorithm;
+    entry.hash=hash;
+    dirty=true;
+}
+
+void HashIndex::Remove(const std::string& filePath) {
+    std::string key=MakeKey(filePath);
+    std::lock_guard<std::mutex> lock(indexMutex);
+    EnsureLoaded();
+
+    if(entries.erase(key)>0) {
+        dirty=true;
+    }
+}
+
+bool HashIndex::GetFileStamp(const std::string& filePath,FileStamp& stamp) {
+    std::wstring widePath=std::filesystem::path(filePath).wstring();
+    if(widePath.empty()) {
+        return false;
+    }
+
+    HANDLE file=CreateFileW(widePath.c_str(),0,
+        FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+        NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+    if(file==INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL ok=GetFileInformationByHandle(file,&info);
+    CloseHandle(file);
+    if(!ok) {
+        return false;
+    }
+
+    stamp.size=(static_cast<unsigned long long>(info.nFileSizeHigh)<<32)|info.nFileSizeLow;
+    stamp.mtime=(static_cast<unsigned long long>(info.ftLastWriteTime.dwHighDateTime)<<32)|info.ftLastWriteTime.dwLowDateTime;
+    stamp.fileId=(static_cast<unsigned long long>(info.nFileIndexHigh)<<32)|info.nFileIndexLow;
+    return true;
+}
+
+std::string HashIndex::MakeKey(const std::string& filePath) const {
+    std::string key=std::filesystem::path(filePath).lexically_normal().generic_string();
+    if(!basePrefix.empty()&&key.compare(0,basePrefix.size(),basePrefix)==0) {
+        key.erase(0,basePrefix.size());
+    }
+    return key;
+}
+
+void HashIndex::EnsureLoaded() {
+    if(loaded) {
+        return;
+    }
+    loaded=true;
+
+    std::ifstream file(indexPath,std::ios::binary);
+    if(!file.is_open()) {
+        return;
+    }
+
+    Json::CharReaderBuilder reader;
+    Json::Value root;
+    std::string errors;
+    if(!Json::parseFromStream(reader,file,&root,&errors)) {
+        LOG_WARN<<"哈希索引损坏，将重建: "<<errors<<std::endl;
+        return;
+    }
+    if(root["format_version"].asInt()!=HASH_INDEX_FORMAT_VERSION) {
+        LOG_INFO<<"哈希索引格式版本不匹配，将重建"<<std::endl;
+        return;
+    }
+
+    const Json::Value& items=root["entries"];
+    entries.reserve(items.size());
+    for(auto it=items.begin(); it!=items.end(); ++it) {
+        const Json::Value& item=*it;
+        Entry entry;
+        entry.stamp.size=item["size"].asUInt64();
+        entry.stamp.mtime=item["mtime"].asUInt64();
+        entry.stamp.fileId=item["file_id"].asUInt64();
+        entry.algorithm=item["algorithm"].asString();
+        entry.hash=item["hash"].asString();
+        entries.emplace(it.name(),std::move(entry));
+    }
+
+    LOG_DEBUG<<"已加载哈希索引: "<<entries.size()<<" 条记录"<<std::endl;
+}
\ No newline at end of file
@@ -2,12 +2,28 @@
 #include <iostream>
 #include <fstream>
 #include <chrono>
+#include <thread>
+#include <filesystem>
+#include "PartialDownload.h"
 #include "Logger.h"
 
 HttpClient::HttpClient(int timeout)
-    : curl(nullptr),timeoutSeconds(timeout),downloadTimeoutSeconds(0) {
+    : curl(nullptr),share(nullptr),requestCount(0),reusedConnectionCount(0),http2RequestCount(0),
+    timeoutSeconds(timeout),downloadTimeoutSeconds(0),downloadRetries(3) {
+    // DNS、TLS 会话和连接缓存在所有使用者之间共享
+    share=curl_share_init();
+    if(share) {
+        curl_share_setopt(share,CURLSHOPT_LOCKFUNC,ShareLockCallback);
+        curl_share_setopt(share,CURLSHOPT_UNLOCKFUNC,ShareUnlockCallback);
+        curl_share_setopt(share,CURLSHOPT_USERDATA,this);
+        curl_share_setopt(share,CURLSHOPT_SHARE,CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share,CURLSHOPT_SHARE,CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share,CURLSHOPT_SHARE,CURL_LOCK_DATA_CONNECT);
+    }
+
     curl=curl_easy_init();
     if(curl) {
+        ApplySharedOptions(curl,share);
         curl_easy_setopt(curl,CURLOPT_USERAGENT,"MinecraftUpdater/1.0");
         curl_easy_setopt(curl,CURLOPT_TIMEOUT,timeoutSeconds);
         curl_easy_setopt(curl,CURLOPT_FOLLOWLOCATION,1L);
@@ -24,6 +40,48 @@ HttpClient::~HttpClient() {
     if(curl) {
         curl_easy_cleanup(curl);
     }
+    if(share) {
+        curl_share_cleanup(share);
+    }
+}
+
+void HttpClient::ApplySharedOptions(CURL* handle,CURLSH* share) {
+    if(share) {
+        curl_easy_setopt(handle,CURLOPT_SHARE,share);
+    }
+    // 服务器支持时走 HTTP/2，多个请求复用同一连接
+    curl_easy_setopt(handle,CURLOPT_HTTP_VERSION,CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(handle,CURLOPT_PIPEWAIT,1L);
+}
+
+void HttpClient::RecordConnectionInfo(CURL* handle) {
+    long newConnections=0;
+    long httpVersion=0;
+    requestCount++;
+    if(curl_easy_getinfo(handle,CURLINFO_NUM_CONNECTS,&newConnections)==CURLE_OK&&newConnections==0) {
+        reusedConnectionCount++;
+    }
+    if(curl_easy_getinfo(handle,CURLINFO_HTTP_VERSION,&httpVersion)==CURLE_OK&&httpVersion>=CURL_HTTP_VERSION_2_0) {
+        http2RequestCount++;
+    }
+}
+
+void HttpClient::LogConnectionStats() {
+    if(requestCount==0) {
+        return;
+    }
+    LOG_DEBUG<<"HTTP 请求: "<<requestCount<<" 次, 复用连接: "<<reusedConnectionCount
+        <<" 次, HTTP/2: "<<http2RequestCount<<" 次"<<std::endl;
+}
+
+void HttpClient::ShareLockCallback(CURL* /*handle*/,curl_lock_data data,curl_lock_access /*access*/,void* userptr) {
+    HttpClient* client=static_cast<HttpClient*>(userptr);
+    client->shareLocks[data].lock();
+}
+
+void HttpClient::ShareUnlockCallback(CURL* /*handle*/,curl_lock_data data,void* userptr) {
+    HttpClient* client=static_cast<HttpClient*>(userptr);
+    client->shareLocks[data].unlock();
 }
 
 void HttpClient::SetTimeout(int timeout) {
@@ -33,6 +91,38 @@ void HttpClient::SetTimeout(int timeout) {
     }
 }
 
+void HttpClient::SetDownloadRetries(int retries) {
+    downloadRetries=retries>0?retries:1;
+}
+
+void HttpClient::SetSegmentedDownload(int segmentCount,long long minSegmentSize) {
+    segmentOptions.segmentCount=segmentCount;
+    if(minSegmentSize>0) {
+        segmentOptions.minSegmentSize=minSegmentSize;
+    }
+}
+
+SegmentedDownload::Outcome HttpClient::TrySegmentedDownload(const std::string& url,const std::string& outputPath,
+    long long expectedSize,DownloadProgressCallback progressCallback,void* userdata) {
+    // 只有已知大小且够分两段时才探测；大小未知的下载不值得为此多一次往返
+    if(segmentOptions.segmentCount<2||expectedSize<2*segmentOptions.minSegmentSize) {
+        return SegmentedDownload::Outcome::Unsupported;
+    }
+
+    SegmentedDownload::Options options=segmentOptions;
+    options.maxAttempts=downloadRetries;
+    options.timeoutSeconds=downloadTimeoutSeconds>0?downloadTimeoutSeconds:timeoutSeconds;
+
+    SegmentedDownload download(url,outputPath,share,options);
+    SegmentedDownload::ProgressCallback segmentProgress;
+    if(progressCallback) {
+        segmentProgress=[progressCallback,userdata](long long downloaded,long long total) {
+            progressCallback(downloaded,total,userdata);
+            };
+    }
+    return download.Run(segmentProgress);
+}
+
 void HttpClient::SetDownloadTimeout(int timeout) {
     this->downloadTimeoutSeconds=timeout;
     if(curl) {
@@ -46,29 +136,94 @@ std::string HttpClient::Get(const std::string& url) {
     std::string response;
 
     if(!curl) {
-        g_logger<<"[ERROR] CURL初始化失败"<<std::endl;
+        LOG_ERROR<<"CURL初始化失败"<<std::endl;
         return response;
     }
 
     curl_easy_setopt(curl,CURLOPT_URL,url.c_str());
     curl_easy_setopt(curl,CURLOPT_WRITEFUNCTION,WriteCallback);
     curl_easy_setopt(curl,CURLOPT_WRITEDATA,&response);
+    // 空字符串表示接受 libcurl 支持的全部压缩格式 (gzip/deflate/br/zstd)
+    curl_easy_setopt(curl,CURLOPT_ACCEPT_ENCODING,"");
 
     CURLcode res=curl_easy_perform(curl);
+    RecordConnectionInfo(curl);
+    // 文件下载走范围请求，不能被压缩
+    curl_easy_setopt(curl,CURLOPT_ACCEPT_ENCODING,nullptr);
     if(res!=CURLE_OK) {
-        g_logger<<"[ERROR] HTTP请求失败: "<<curl_easy_strerror(res)<<std::endl;
+        LOG_ERROR<<"HTTP请求失败: "<<curl_easy_strerror(res)<<std::endl;
         return "";
     }
 
     return response;
 }
 
+bool HttpClient::GetConditional(const std::string& url,const std::string& etag,const std::string& lastModified,
+    const DataSink& sink,HttpResponse& response) {
+    response=HttpResponse();
+
+    if(!curl) {
+        LOG_ERROR<<"CURL初始化失败"<<std::endl;
+        return false;
+    }
+
+    curl_slist* headers=nullptr;
+    if(!etag.empty()) {
+        headers=curl_slist_append(headers,("If-None-Match: "+etag).c_str());
+    }
+    if(!lastModified.empty()) {
+        headers=curl_slist_append(headers,("If-Modified-Since: "+lastModified).c_str());
+    }
+
+    curl_easy_setopt(curl,CURLOPT_URL,url.c_str());
+    curl_easy_setopt(curl,CURLOPT_HTTPHEADER,headers);
+    ConditionalWriteTarget target={curl,&sink,0,false,false};
+    curl_easy_setopt(curl,CURLOPT_WRITEFUNCTION,WriteConditionalCallback);
+    curl_easy_setopt(curl,CURLOPT_WRITEDATA,&target);
+    curl_easy_setopt(curl,CURLOPT_ACCEPT_ENCODING,"");
+
+    CURLcode res=curl_easy_perform(curl);
+    RecordConnectionInfo(curl);
+    curl_easy_setopt(curl,CURLOPT_HTTPHEADER,nullptr);
+    curl_easy_setopt(curl,CURLOPT_ACCEPT_ENCODING,nullptr);
+    curl_slist_free_all(headers);
+
+    if(res!=CURLE_OK) {
+        LOG_ERROR<<"HTTP请求失败: "<<curl_easy_strerror(res)<<std::endl;
+        return false;
+    }
+
+    curl_easy_getinfo(curl,CURLINFO_RESPONSE_CODE,&response.status);
+    curl_header* header=nullptr;
+    if(curl_easy_header(curl,"ETag",0,CURLH_HEADER,-1,&header)==CURLHE_OK) {
+        response.etag=header->value;
+    }
+    if(curl_easy_header(curl,"Last-Modified",0,CURLH_HEADER,-1,&header)==CURLHE_OK) {
+        response.lastModified=header->value;
+    }
+    if(curl_easy_header(curl,"Content-Encoding",0,CURLH_HEADER,-1,&header)==CURLHE_OK) {
+        curl_off_t received=0;
+        curl_easy_getinfo(curl,CURLINFO_SIZE_DOWNLOAD_T,&received);
+        LOG_DEBUG<<"响应已压缩 ("<<header->value<<"): 传输 "<<received
+            <<" 字节, 解压后 "<<target.received<<" 字节"<<std::endl;
+    }
+    return true;
+}
+
 bool HttpClient::DownloadFile(const std::string& url,const std::string& outputPath) {
     return DownloadFileWithProgress(url,outputPath);
 }
 bool HttpClient::DownloadFileWithProgress(const std::string& url,const std::string& outputPath,
-    DownloadProgressCallback progressCallback,void* userdata) {
+    DownloadProgressCallback progressCallback,void* userdata,FileHasher::StreamHasher* hasher,long long expectedSize) {
     if(!curl) return false;
+
+    if(TrySegmentedDownload(url,outputPath,expectedSize,progressCallback,userdata)==SegmentedDownload::Outcome::Completed) {
+        // 分段写入顺序不定，只能下载完后再读一遍计算哈希
+        if(hasher&&!FileHasher::HashFileContents(outputPath,*hasher)) {
+            return false;
+        }
+        return true;
+    }
     curl_easy_setopt(curl,CURLOPT_URL,url.c_str());
     curl_easy_setopt(curl,CURLOPT_USERAGENT,"MinecraftUpdater/1.0");
     curl_easy_setopt(curl,CURLOPT_FOLLOWLOCATION,1L);
@@ -86,7 +241,7 @@ bool HttpClient::DownloadFileWithProgress(const std::string& url,const std::stri
     errno_t err=fopen_s(&file,outputPath.c_str(),"wb");
 
     if(err!=0||!file) {
-        g_logger<<"[ERROR] 无法创建文件: "<<outputPath<<std::endl;
+        LOG_ERROR<<"无法创建文件: "<<outputPath<<std::endl;
         return false;
     }
 
@@ -96,9 +251,11 @@ bool HttpClient::DownloadFileWithProgress(const std::string& url,const std::stri
     progressData.lastUpdateTime=0;
     progressData.totalBytes=0;
     progressData.downloadedBytes=0;
+    progressData.resumeOffset=0;
 
+    FileWriteTarget target{file,hasher};
     curl_easy_setopt(curl,CURLOPT_WRITEFUNCTION,WriteFileCallback);
-    curl_easy_setopt(curl,CURLOPT_WRITEDATA,file);
+    curl_easy_setopt(curl,CURLOPT_WRITEDATA,&target);
 
     if(progressCallback) {
         curl_easy_setopt(curl,CURLOPT_NOPROGRESS,0L);
@@ -109,14 +266,11 @@ bool HttpClient::DownloadFileWithProgress(const std::string& url,const std::stri
         curl_easy_setopt(curl,CURLOPT_NOPROGRESS,1L);
     }
     CURLcode res=curl_easy_perform(curl);
+    RecordConnectionInfo(curl);
     fclose(file);
 
     if(res!=CURLE_OK) {
-        g_logger<<"[ERROR] 下载失败: "<<curl_easy_strerror(res);
-        if(res==CURLE_OPERATION_TIMEDOUT) {
-            g_logger<<" (超时)";
-        }
-        g_logger<<std::endl;
+        LOG_ERROR<<"下载失败: "<<curl_easy_strerror(res)<<(res==CURLE_OPERATION_TIMEDOUT?" (超时)":"")<<std::endl;
         std::remove(outputPath.c_str());
         return false;
     }
@@ -124,12 +278,112 @@ bool HttpClient::DownloadFileWithProgress(const std::string& url,const std::stri
     return true;
 }
 
+bool HttpClient::DownloadFileWithHash(const std::string& url,const std::string& outputPath,
+    const std::string& algorithm,std::string& digest,
+    DownloadProgressCallback progressCallback,void* userdata) {
+    digest.clear();
+
+    // 边下载边计算哈希，省去下载后再读一遍文件
+    FileHasher::StreamHasher hasher(algorithm);
+    if(!hasher.IsValid()) {
+        LOG_WARN<<"不支持的哈希算法: "<<algorithm<<std::endl;
+        return DownloadFileWithProgress(url,outputPath,progressCallback,userdata);
+    }
+
+    if(!DownloadFileWithProgress(url,outputPath,progressCallback,userdata,&hasher)) {
+        return false;
+    }
+    digest=hasher.Final();
+    return true;
+}
+
+bool HttpClient::DownloadFileResumable(const std::string& url,const std::string& outputPath,
+    const std::string& algorithm,const std::string& expectedHash,std::string& digest,
+    DownloadProgressCallback progressCallback,void* userdata,long long expectedSize) {
+    if(!curl) return false;
+
+    // 已有 .part 时优先续传，否则大文件先尝试分段并行下载
+    std::error_code partEc;
+    if(!std::filesystem::exists(outputPath+".part",partEc)&&
+        TrySegmentedDownload(url,outputPath,expectedSize,progressCallback,userdata)==SegmentedDownload::Outcome::Completed) {
+        digest=FileHasher::CalculateFileHashStream(outputPath,algorithm);
+        if(!expectedHash.empty()&&digest!=expectedHash) {
+            LOG_ERROR<<"分段下载的文件哈希不匹配: "<<url<<std::endl;
+            std::filesystem::remove(outputPath,partEc);
+            return false;
+        }
+        return true;
+    }
+
+    curl_easy_setopt(curl,CURLOPT_URL,url.c_str());
+    curl_easy_setopt(curl,CURLOPT_TIMEOUT,static_cast<long>(downloadTimeoutSeconds>0?downloadTimeoutSeconds:timeoutSeconds));
+
+    DownloadProgressData progressData;
+    progressData.callback=progressCallback;
+    progressData.userdata=userdata;
+    progressData.lastUpdateTime=0;
+    progressData.totalBytes=0;
+    progressData.downloadedBytes=0;
+    progressData.resumeOffset=0;
+
+    if(progressCallback) {
+        curl_easy_setopt(curl,CURLOPT_NOPROGRESS,0L);
+        curl_easy_setopt(curl,CURLOPT_PROGRESSFUNCTION,CurlProgressCallback);
+        curl_easy_setopt(curl,CURLOPT_PROGRESSDATA,&progressData);
+    }
+    else {
+        curl_easy_setopt(curl,CURLOPT_NOPROGRESS,1L);
+    }
+
+    PartialDownload partial(url,outputPath,algorithm);
+    partial.SetExpectedSize(expectedSize);
+    bool success=false;
+    for(int attempt=1; attempt<=downloadRetries; attempt++) {
+        if(!partial.Open()) {
+            break;
+        }
+        progressData.resumeOffset=partial.GetResumeOffset();
+        partial.Attach(curl);
+
+        CURLcode res=curl_easy_perform(curl);
+        RecordConnectionInfo(curl);
+
+        std::string error;
+        if(partial.Complete(res,expectedHash,digest,error)) {
+            success=true;
+            break;
+        }
+
+        if(partial.CanResume()) {
+            LOG_WARN<<"下载失败 ("<<attempt<<"/"<<downloadRetries<<"): "<<error
+                <<"，已保留 "<<partial.GetResumeOffset()+partial.GetReceivedBytes()<<" 字节用于续传"<<std::endl;
+        }
+        else {
+            LOG_WARN<<"下载失败 ("<<attempt<<"/"<<downloadRetries<<"): "<<error<<std::endl;
+        }
+
+        // 4xx 重试没有意义
+        if(partial.GetHttpStatus()>=400&&partial.GetHttpStatus()<500) {
+            break;
+        }
+        if(attempt<downloadRetries) {
+            std::this_thread::sleep_for(std::chrono::seconds(1<<(attempt-1)));
+        }
+    }
+
+    curl_easy_setopt(curl,CURLOPT_TIMEOUT,timeoutSeconds);
+    if(!success) {
+        LOG_ERROR<<"下载失败: "<<url<<std::endl;
+    }
+    return success;
+}
+
 bool HttpClient::DownloadToMemory(const std::string& url,std::vector<unsigned char>& buffer) {
     return DownloadToMemoryWithProgress(url,buffer);
 }
 
 bool HttpClient::DownloadToMemoryWithProgress(const std::string& url,std::vector<unsigned char>& buffer,
-    DownloadProgressCallback progressCallback,void* userdata) {
+    DownloadProgressCallback progressCallback,void* userdata,FileHasher::StreamHasher* hasher) {
     if(!curl) return false;
 
     buffer.clear();
@@ -140,10 +394,12 @@ bool HttpClient::DownloadToMemoryWithProgress(const std::string& url,std::vector
     progressData.lastUpdateTime=0;
     progressData.totalBytes=0;
     progressData.downloadedBytes=0;
+    progressData.resumeOffset=0;
 
     curl_easy_setopt(curl,CURLOPT_URL,url.c_str());
+    MemoryWriteTarget target{&buffer,hasher};
     curl_easy_setopt(curl,CURLOPT_WRITEFUNCTION,WriteMemoryCallback);
-    curl_easy_setopt(curl,CURLOPT_WRITEDATA,&buffer);
+    curl_easy_setopt(curl,CURLOPT_WRITEDATA,&target);
 
     if(progressCallback) {
         curl_easy_setopt(curl,CURLOPT_NOPROGRESS,0L);
@@ -158,16 +414,58 @@ bool HttpClient::DownloadToMemoryWithProgress(const std::string& url,std::vector
     }
 
     CURLcode res=curl_easy_perform(curl);
+    RecordConnectionInfo(curl);
     if(downloadTimeoutSeconds>0) {
         curl_easy_setopt(curl,CURLOPT_TIMEOUT,timeoutSeconds);
     }
 
     if(res!=CURLE_OK) {
-        g_logger<<"[ERROR] 下载到内存失败: "<<curl_easy_strerror(res);
-        if(res==CURLE_OPERATION_TIMEDOUT) {
-            g_logger<<" (超时)";
-        }
-        g_logger<<std::endl;
+        LOG_ERROR<<"下载到内存失败: "<<curl_easy_strerror(res)<<(res==CURLE_OPERATION_TIMEDOUT?" (超时)":"")<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool HttpClient::DownloadToSink(const std::string& url,const DataSink& sink,
+    DownloadProgressCallback progressCallback,void* userdata) {
+    if(!curl) return false;
+
+    curl_easy_setopt(curl,CURLOPT_URL,url.c_str());
+    curl_easy_setopt(curl,CURLOPT_USERAGENT,"MinecraftUpdater/1.0");
+    curl_easy_setopt(curl,CURLOPT_FOLLOWLOCATION,1L);
+    curl_easy_setopt(curl,CURLOPT_CONNECTTIMEOUT,10L);
+    if(downloadTimeoutSeconds>0) {
+        curl_easy_setopt(curl,CURLOPT_TIMEOUT,downloadTimeoutSeconds);
+    }
+    curl_easy_setopt(curl,CURLOPT_LOW_SPEED_LIMIT,1024L);
+    curl_easy_setopt(curl,CURLOPT_LOW_SPEED_TIME,30L);
+
+    DownloadProgressData progressData;
+    progressData.callback=progressCallback;
+    progressData.userdata=userdata;
+    progressData.lastUpdateTime=0;
+    progressData.totalBytes=0;
+    progressData.downloadedBytes=0;
+    progressData.resumeOffset=0;
+
+    curl_easy_setopt(curl,CURLOPT_WRITEFUNCTION,WriteSinkCallback);
+    curl_easy_setopt(curl,CURLOPT_WRITEDATA,&sink);
+
+    if(progressCallback) {
+        curl_easy_setopt(curl,CURLOPT_NOPROGRESS,0L);
+        curl_easy_setopt(curl,CURLOPT_PROGRESSFUNCTION,CurlProgressCallback);
+        curl_easy_setopt(curl,CURLOPT_PROGRESSDATA,&progressData);
+    }
+    else {
+        curl_easy_setopt(curl,CURLOPT_NOPROGRESS,1L);
+    }
+
+    CURLcode res=curl_easy_perform(curl);
+    RecordConnectionInfo(curl);
+    curl_easy_setopt(curl,CURLOPT_TIMEOUT,timeoutSeconds);
+
+    if(res!=CURLE_OK) {
+        LOG_ERROR<<"流式下载失败: "<<curl_easy_strerror(res)<<(res==CURLE_OPERATION_TIMEDOUT?" (超时)":"")<<std::endl;
         return false;
     }
     return true;
@@ -178,7 +476,10 @@ int HttpClient::CurlProgressCallback(void* clientp,double dltotal,double dlnow,d
 
     if(progressData->callback) {
         long long totalBytes=static_cast<long long>(dltotal);
-        long long downloadedBytes=static_cast<long long>(dlnow);
+        long long downloadedBytes=static_cast<long long>(dlnow)+progressData->resumeOffset;
+        if(totalBytes>0) {
+            totalBytes+=progressData->resumeOffset;
+        }
         progressData->callback(downloadedBytes,totalBytes,progressData->userdata);
     }
 
@@ -191,14 +492,43 @@ size_t HttpClient::WriteCallback(void* contents,size_t size,size_t nmemb,std::st
     return totalSize;
 }
 
-size_t HttpClient::WriteFileCallback(void* contents,size_t size,size_t nmemb,FILE* file) {
-    return fwrite(contents,size,nmemb,file);
+size_t HttpClient::WriteFileCallback(void* contents,size_t size,size_t nmemb,FileWriteTarget* target) {
+    size_t written=fwrite(contents,size,nmemb,target->file);
+    if(target->hasher) {
+        target->hasher->Update(contents,written*size);
+    }
+    return written;
 }
 
-size_t HttpClient::WriteMemoryCallback(void* contents,size_t size,size_t nmemb,std::vector<unsigned char>* buffer) {
+size_t HttpClient::WriteMemoryCallback(void* contents,size_t size,size_t nmemb,MemoryWriteTarget* target) {
     size_t totalSize=size*nmemb;
+    std::vector<unsigned char>* buffer=target->buffer;
     size_t oldSize=buffer->size();
     buffer->resize(oldSize+totalSize);
     memcpy(buffer->data()+oldSize,contents,totalSize);
+    if(target->hasher) {
+        target->hasher->Update(contents,totalSize);
+    }
     return totalSize;
+}
+
+size_t HttpClient::WriteSinkCallback(void* contents,size_t size,size_t nmemb,const DataSink* sink) {
+    size_t totalSize=size*nmemb;
+    return (*sink)(static_cast<const unsigned char*>(contents),totalSize)?totalSize:0;
+}
+
+size_t HttpClient::WriteConditionalCallback(void* contents,size_t size,size_t nmemb,ConditionalWriteTarget* target) {
+    size_t totalSize=size*nmemb;
+    // 第一次回调时响应头已收齐，错误页不交给 sink
+    if(!target->checked) {
+        target->checked=true;
+        long status=0;
+        curl_easy_getinfo(target->handle,CURLINFO_RESPONSE_CODE,&status);
+        target->forward=status>=200&&status<300;
+    }
+    if(!target->forward) {
+        return totalSize;
+    }
+    target->received+=static_cast<long long>(totalSize);
+    return (*target->sink)(static_cast<const unsigned char*>(contents),totalSize)?totalSize:0;
 }
\ No newline at end of file
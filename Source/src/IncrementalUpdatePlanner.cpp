@@ -14,12 +14,21 @@
 #include <map>
 #include <algorithm>
 #include <mutex>
+#include <condition_variable>
 #include <memory>
+#include <limits>
 #include "FileHasher.h"
 #include <fcntl.h>
 #include <io.h>
 #include <windows.h>
 #include "UpdateOrchestrator.h"
+
+namespace {
+    const char* const UPDATE_MANIFEST_ENTRY="update_manifest.txt";
+    // fromVersion 为该值的包是可从任意版本直接应用的全量包
+    const char* const FULL_PACKAGE_BASE="0.0.0";
+}
+
 IncrementalUpdatePlanner::IncrementalUpdatePlanner(HttpClient& http,
     FileSystemHelper& fs,
     ProgressReporter& reporter,
@@ -44,7 +53,7 @@ bool IncrementalUpdatePlanner::ShouldUseIncrementalUpdate(const std::string& loc
 
     if(!std::regex_match(localVersion,localMatch,versionRegex)||
         !std::regex_match(remoteVersion,remoteMatch,versionRegex)) {
-        g_logger<<"[WARN] 版本号格式不正确，跳过增量更新"<<std::endl;
+        LOG_WARN<<"版本号格式不正确，跳过增量更新"<<std::endl;
         return false;
     }
 
@@ -52,263 +61,577 @@ bool IncrementalUpdatePlanner::ShouldUseIncrementalUpdate(const std::string& loc
     int remoteMajor=std::stoi(remoteMatch[1]);
 
     if(localMajor!=remoteMajor) {
-        g_logger<<"[INFO] 检测到主要版本变更 ("<<localVersion<<" -> "<<remoteVersion<<")，建议使用全量更新"<<std::endl;
+        LOG_INFO<<"检测到主要版本变更 ("<<localVersion<<" -> "<<remoteVersion<<")，建议使用全量更新"<<std::endl;
     }
 
     return true;
 }
-std::vector<std::string> IncrementalUpdatePlanner::GetUpdatePackagePath(const Json::Value& packages,const std::string& fromVersion,const std::string& toVersion) {
-    std::vector<std::string> result;
-
-    g_logger<<"[INFO] 寻找更新路径: "<<fromVersion<<" -> "<<toVersion<<std::endl;
-
+std::vector<std::string> IncrementalUpdatePlanner::GetUpdatePackagePath(const std::vector<Manifest::Package>& packages,const std::string& fromVersion,const std::string& toVersion) {
+    LOG_INFO<<"寻找更新路径: "<<fromVersion<<" -> "<<toVersion<<std::endl;
+
+    // 边权为下载字节数，外加可配置的每包固定开销（折算成字节，表示解压与应用的耗时）
+    // 负数会让环路上的代价越走越小，Dijkstra 不再收敛
+    long long hopCost=static_cast<long long>((std::max)(configManager.GetSnapshot().incrementalHopCostKB,0))*1024;
+    // 大小未知的包按已知最大的包计，避免被当成最便宜的选择
+    long long largestKnownSize=1;
     for(const auto& package:packages) {
-        if(!package.isMember("from_version")||!package.isMember("to_version")||!package.isMember("archive")) {
-            continue;
-        }
-
-        std::string from=package["from_version"].asString();
-        std::string to=package["to_version"].asString();
-        std::string archive=package["archive"].asString();
-
-        if(from==fromVersion&&to==toVersion) {
-            g_logger<<"[INFO] 找到直接合并包: "<<archive<<" ("<<from<<" -> "<<to<<")"<<std::endl;
-            return {archive};
-        }
+        largestKnownSize=(std::max)(largestKnownSize,package.size);
     }
-
-    for(const auto& package:packages) {
-        if(!package.isMember("from_version")||!package.isMember("to_version")) {
+    auto packageCost=[hopCost,largestKnownSize](const Manifest::Package& package) {
+        return (std::max)((package.size>0?package.size:largestKnownSize)+hopCost,1LL);
+        };
+
+    // 版本号映射为节点下标，每条边记录对应包在 packages 中的下标
+    std::map<std::string,size_t> nodeIndex;
+    std::vector<std::vector<size_t>> edges;
+    auto nodeOf=[&nodeIndex,&edges](const std::string& version) {
+        auto inserted=nodeIndex.emplace(version,nodeIndex.size());
+        if(inserted.second) {
+            edges.emplace_back();
+        }
+        return inserted.first->second;
+        };
+    const Manifest::Package* fullPackage=nullptr;
+    for(size_t i=0; i<packages.size(); i++) {
+        const Manifest::Package& package=packages[i];
+        if(package.archive.empty()) {
             continue;
         }
-
-        std::string from=package["from_version"].asString();
-        std::string to=package["to_version"].asString();
-        std::string archive=package["archive"].asString();
-
-        if(from=="0.0.0"&&to==toVersion) {
-            g_logger<<"[INFO] 找到全量更新包: "<<archive<<" (0.0.0 -> "<<to<<")"<<std::endl;
-            return {archive};
+        if(package.fromVersion==FULL_PACKAGE_BASE&&package.toVersion==toVersion&&
+            (!fullPackage||packageCost(package)<packageCost(*fullPackage))) {
+            fullPackage=&package;
         }
+        size_t from=nodeOf(package.fromVersion);
+        nodeOf(package.toVersion);
+        edges[from].push_back(i);
     }
 
-    std::map<std::string,std::vector<std::string>> graph;
-    std::map<std::string,std::string> archiveMap;
-
-    for(const auto& package:packages) {
-        if(!package.isMember("from_version")||!package.isMember("to_version")||!package.isMember("archive")) {
-            continue;
+    // Dijkstra：代价相同时取包数更少的路径；只记录前驱边，不复制路径
+    const size_t NO_EDGE=static_cast<size_t>(-1);
+    typedef std::pair<long long,size_t> Cost;
+    std::vector<const Manifest::Package*> chain;
+    long long chainCost=-1;
+    auto fromIt=nodeIndex.find(fromVersion);
+    auto toIt=nodeIndex.find(toVersion);
+    if(fromIt!=nodeIndex.end()&&toIt!=nodeIndex.end()) {
+        const Cost unreached((std::numeric_limits<long long>::max)(),0);
+        std::vector<Cost> best(nodeIndex.size(),unreached);
+        std::vector<size_t> via(nodeIndex.size(),NO_EDGE);
+        std::priority_queue<std::pair<Cost,size_t>,std::vector<std::pair<Cost,size_t>>,std::greater<std::pair<Cost,size_t>>> queue;
+        best[fromIt->second]=Cost(0,0);
+        queue.push({best[fromIt->second],fromIt->second});
+        while(!queue.empty()) {
+            auto [cost,node]=queue.top();
+            queue.pop();
+            if(cost!=best[node]) {
+                continue;
+            }
+            if(node==toIt->second) {
+                break;
+            }
+            for(size_t edge:edges[node]) {
+                size_t next=nodeIndex[packages[edge].toVersion];
+                Cost candidate(cost.first+packageCost(packages[edge]),cost.second+1);
+                if(candidate<best[next]) {
+                    best[next]=candidate;
+                    via[next]=edge;
+                    queue.push({candidate,next});
+                }
+            }
         }
-
-        std::string from=package["from_version"].asString();
-        std::string to=package["to_version"].asString();
-        std::string archive=package["archive"].asString();
-
-        if(from=="0.0.1") {
-            continue;
+        if(best[toIt->second]!=unreached&&toIt->second!=fromIt->second) {
+            chainCost=best[toIt->second].first;
+            for(size_t node=toIt->second; via[node]!=NO_EDGE; node=nodeIndex[packages[via[node]].fromVersion]) {
+                chain.push_back(&packages[via[node]]);
+            }
+            std::reverse(chain.begin(),chain.end());
         }
-
-        graph[from].push_back(to);
-        std::string edgeKey=from+"->"+to;
-        archiveMap[edgeKey]=archive;
     }
 
-    std::queue<std::pair<std::string,std::vector<std::string>>> q;
-    std::set<std::string> visited;
-
-    q.push({fromVersion,{}});
-    visited.insert(fromVersion);
-
-    while(!q.empty()) {
-        auto [current,path]=q.front();
-        q.pop();
-
-        if(current==toVersion) {
-            std::vector<std::string> archivePath;
-            for(size_t i=0; i<path.size(); i++) {
-                std::string from=(i==0)?fromVersion:path[i-1];
-                std::string to=path[i];
-                std::string edgeKey=from+"->"+to;
-
-                if(archiveMap.find(edgeKey)!=archiveMap.end()) {
-                    archivePath.push_back(archiveMap[edgeKey]);
-                }
-            }
+    // 全量包不在增量图的可达范围内，单独比较
+    bool useFullPackage=fullPackage&&(chainCost<0||packageCost(*fullPackage)<chainCost);
+    if(useFullPackage) {
+        chain.assign(1,fullPackage);
+    }
+    if(chain.empty()) {
+        LOG_WARN<<"无法找到增量更新路径: "<<fromVersion<<" -> "<<toVersion<<std::endl;
+        return {};
+    }
 
-            g_logger<<"[INFO] 找到增量更新路径，包含 "<<archivePath.size()<<" 个包"<<std::endl;
-            return archivePath;
+    long long expectedBytes=0;
+    bool hasUnknownSize=false;
+    std::vector<std::string> archivePath;
+    for(const Manifest::Package* package:chain) {
+        archivePath.push_back(package->archive);
+        if(package->size>0) {
+            expectedBytes+=package->size;
         }
-
-        if(graph.find(current)!=graph.end()) {
-            for(const auto& next:graph[current]) {
-                if(visited.find(next)==visited.end()) {
-                    visited.insert(next);
-                    std::vector<std::string> newPath=path;
-                    newPath.push_back(next);
-                    q.push({next,newPath});
-                }
-            }
+        else {
+            hasUnknownSize=true;
         }
     }
 
-    g_logger<<"[WARN] 无法找到增量更新路径: "<<fromVersion<<" -> "<<toVersion<<std::endl;
-    return {};
+    LOG_INFO<<"更新计划: "<<(useFullPackage?"全量包":"增量路径")<<"，共 "<<chain.size()<<" 个包，预计下载 "
+        <<progressReporter.FormatBytes(expectedBytes)<<(hasUnknownSize?" (部分包大小未知)":"")<<std::endl;
+    for(const Manifest::Package* package:chain) {
+        LOG_INFO<<"  "<<package->fromVersion<<" -> "<<package->toVersion<<": "<<package->archive<<" ("
+            <<(package->size>0?progressReporter.FormatBytes(package->size):std::string("大小未知"))<<")"<<std::endl;
+    }
+    if(fullPackage&&!useFullPackage) {
+        LOG_INFO<<"未选用全量包 "<<fullPackage->archive<<" ("
+            <<(fullPackage->size>0?progressReporter.FormatBytes(fullPackage->size):std::string("大小未知"))<<")"<<std::endl;
+    }
+    return archivePath;
 }
-bool IncrementalUpdatePlanner::ApplyIncrementalUpdate(const Json::Value& updateInfo,const std::string& localVersion,const std::string& remoteVersion) {
-    updateOrchestrator.ClearCachedUpdateInfo();
+bool IncrementalUpdatePlanner::ApplyIncrementalUpdate(const Manifest& manifest,const std::string& localVersion,const std::string& remoteVersion) {
+    updateOrchestrator.ClearCachedManifest();
 
-    const Json::Value& packages=updateInfo["incremental_packages"];
-    if(!packages.isArray()||packages.size()==0) {
-        g_logger<<"[INFO] 没有可用的增量更新包"<<std::endl;
+    const std::vector<Manifest::Package>& packages=manifest.GetPackages();
+    if(packages.empty()) {
+        LOG_INFO<<"没有可用的增量更新包"<<std::endl;
         return false;
     }
 
-    g_logger<<"[INFO] 开始处理增量更新: "<<localVersion<<" -> "<<remoteVersion<<std::endl;
+    LOG_INFO<<"开始处理增量更新: "<<localVersion<<" -> "<<remoteVersion<<std::endl;
 
     std::vector<std::string> packagePaths=GetUpdatePackagePath(packages,localVersion,remoteVersion);
 
     if(packagePaths.empty()) {
-        g_logger<<"[INFO] 没有找到合适的增量更新包路径"<<std::endl;
+        LOG_INFO<<"没有找到合适的增量更新包路径"<<std::endl;
         return false;
     }
 
-    g_logger<<"[INFO] 需要应用 "<<packagePaths.size()<<" 个更新包"<<std::endl;
+    LOG_INFO<<"需要应用 "<<packagePaths.size()<<" 个更新包"<<std::endl;
+
+    const ConfigSnapshot& settings=configManager.GetSnapshot();
+    bool coalesce=packagePaths.size()>1&&settings.coalescePackages;
+    if(coalesce&&settings.tempDiskBudgetMB>0) {
+        // 合并应用需要整条链同时留在磁盘上
+        long long chainBytes=0;
+        for(const auto& packagePath:packagePaths) {
+            const Manifest::Package* packageInfo=manifest.FindPackage(packagePath);
+            if(packageInfo&&packageInfo->size>0) {
+                chainBytes+=packageInfo->size;
+            }
+        }
+        if(chainBytes>static_cast<long long>(settings.tempDiskBudgetMB)*1024*1024) {
+            LOG_INFO<<"更新包总大小 "<<progressReporter.FormatBytes(chainBytes)<<" 超出临时空间上限，改为逐个应用"<<std::endl;
+            coalesce=false;
+        }
+    }
+    if(coalesce) {
+        // 先下载整条链，再按净效果一次性应用
+        std::vector<std::string> tempZips;
+        auto removeDownloads=[&tempZips]() {
+            std::error_code ec;
+            for(const auto& tempZip:tempZips) {
+                std::filesystem::remove(tempZip,ec);
+            }
+            };
+        for(size_t i=0; i<packagePaths.size(); i++) {
+            LOG_INFO<<"("<<(i+1)<<"/"<<packagePaths.size()<<") 下载更新包: "<<packagePaths[i]<<std::endl;
+            std::string tempZip;
+            if(!DownloadPackage(manifest,packagePaths[i],i,packagePaths.size(),tempZip)) {
+                removeDownloads();
+                return false;
+            }
+            tempZips.push_back(tempZip);
+        }
+        bool applied=ApplyCoalescedUpdate(packagePaths,tempZips);
+        removeDownloads();
+        if(applied) {
+            LOG_INFO<<"所有增量更新包应用完成"<<std::endl;
+        }
+        return applied;
+    }
+
+    if(packagePaths.size()>1&&settings.prefetchPackages>0) {
+        bool applied=ApplyPackagesPrefetched(manifest,packagePaths);
+        if(applied) {
+            LOG_INFO<<"所有增量更新包应用完成"<<std::endl;
+        }
+        return applied;
+    }
 
     for(size_t i=0; i<packagePaths.size(); i++) {
         const std::string& packagePath=packagePaths[i];
-        g_logger<<"[INFO] ("<<(i+1)<<"/"<<packagePaths.size()<<") 处理更新包: "<<packagePath<<std::endl;
+        LOG_INFO<<"("<<(i+1)<<"/"<<packagePaths.size()<<") 处理更新包: "<<packagePath<<std::endl;
 
         if(i>0) {
             updateOrchestrator.OptimizeMemoryUsage();
         }
 
-        Json::Value packageInfo;
-        for(const auto& package:packages) {
-            if(package["archive"].asString()==packagePath) {
-                packageInfo=package;
-                break;
-            }
+        std::string tempZip;
+        if(!DownloadPackage(manifest,packagePath,i,packagePaths.size(),tempZip)) {
+            return false;
         }
-
-        if(packageInfo.isNull()) {
-            g_logger<<"[ERROR] 找不到包信息: "<<packagePath<<std::endl;
+        if(tempZip.empty()) {
             continue;
         }
 
-        std::string expectedHash=packageInfo["hash"].asString();
-        long long expectedSize=packageInfo.isMember("size")?packageInfo["size"].asInt64():0;
+        bool applied=ApplyPackage(packagePath,tempZip,i);
+        std::filesystem::remove(tempZip);
+        if(!applied) {
+            return false;
+        }
 
-        DWORD pid=GetCurrentProcessId();
-        auto timestamp=std::chrono::steady_clock::now().time_since_epoch().count();
-        std::string tempDir=std::filesystem::temp_directory_path().string();
-        std::string tempZip=tempDir+"/mc_pkg_"+std::to_string(pid)+"_"+std::to_string(timestamp)+"_"+std::to_string(i)+".zip";
+        LOG_INFO<<"更新包 ("<<(i+1)<<"/"<<packagePaths.size()<<") 处理完成"<<std::endl;
 
-        g_logger<<"[INFO] 开始下载更新包..."<<std::endl;
-        std::string progressMessage="下载更新包 "+std::to_string(i+1)+"/"+std::to_string(packagePaths.size());
-        progressReporter.ShowProgressBar(progressMessage,0,1);
+        updateOrchestrator.OptimizeMemoryUsage();
+    }
 
-        bool downloadSuccess=httpClient.DownloadFileWithProgress(
-            packagePath,
-            tempZip,
-            [this,progressMessage,expectedSize](long long downloaded,long long total,void* userdata) {
-                if(total<=0&&expectedSize>0) {
-                    total=expectedSize;
-                }
-                progressReporter.ShowProgressBar(progressMessage,downloaded,total);
-            },
-            nullptr
-        );
+    LOG_INFO<<"所有增量更新包应用完成"<<std::endl;
 
-        progressReporter.ClearProgressLine();
+    return true;
+}
+bool IncrementalUpdatePlanner::DownloadPackage(const Manifest& manifest,const std::string& packagePath,
+    size_t index,size_t count,std::string& tempZip) {
+    tempZip.clear();
+    const Manifest::Package* packageInfo=manifest.FindPackage(packagePath);
+    if(!packageInfo) {
+        LOG_ERROR<<"找不到包信息: "<<packagePath<<std::endl;
+        return true;
+    }
 
-        if(!downloadSuccess) {
-            g_logger<<"[ERROR] 下载更新包失败: "<<packagePath<<std::endl;
-            return false;
+    std::string expectedHash=packageInfo->hash;
+    long long expectedSize=packageInfo->size;
+
+    DWORD pid=GetCurrentProcessId();
+    auto timestamp=std::chrono::steady_clock::now().time_since_epoch().count();
+    std::string tempDir=std::filesystem::temp_directory_path().string();
+    tempZip=tempDir+"/mc_pkg_"+std::to_string(pid)+"_"+std::to_string(timestamp)+"_"+std::to_string(index)+".zip";
+    // 按包哈希命名，中断后下次运行还能找到 .part 续传；哈希来自服务端，只接受十六进制，避免路径穿越
+    bool hexHash=!expectedHash.empty()&&expectedHash.size()<=128&&
+        expectedHash.find_first_not_of("0123456789abcdefABCDEF")==std::string::npos;
+    if(hexHash) {
+        tempZip=tempDir+"/mc_pkg_"+expectedHash+".zip";
+    }
+
+    LOG_INFO<<"开始下载更新包..."<<std::endl;
+    std::string progressMessage="下载更新包 "+std::to_string(index+1)+"/"+std::to_string(count);
+    progressReporter.ShowProgressBar(progressMessage,0,1);
+
+    std::string actualHash;
+    bool downloadSuccess=httpClient.DownloadFileResumable(
+        packagePath,
+        tempZip,
+        "md5",
+        expectedHash,
+        actualHash,
+        [this,progressMessage,expectedSize](long long downloaded,long long total,void* userdata) {
+            if(total<=0&&expectedSize>0) {
+                total=expectedSize;
+            }
+            progressReporter.ShowProgressBar(progressMessage,downloaded,total);
+        },
+        nullptr,
+        expectedSize
+    );
+
+    progressReporter.ClearProgressLine();
+
+    if(!downloadSuccess) {
+        LOG_ERROR<<"下载更新包失败: "<<packagePath<<std::endl;
+        return false;
+    }
+
+    LOG_INFO<<"下载完成"<<std::endl;
+
+    if(expectedSize>0) {
+        std::error_code ec;
+        auto actualSize=std::filesystem::file_size(tempZip,ec);
+        if(!ec&&actualSize!=expectedSize) {
+            LOG_WARN<<"文件大小不匹配: 期望 "<<progressReporter.FormatBytes(expectedSize)<<", 实际 "<<progressReporter.FormatBytes(actualSize)<<std::endl;
         }
+    }
 
-        g_logger<<"[INFO] 下载完成"<<std::endl;
+    if(!expectedHash.empty()) {
+        LOG_INFO<<"验证文件哈希..."<<std::endl;
 
-        if(expectedSize>0) {
-            std::error_code ec;
-            auto actualSize=std::filesystem::file_size(tempZip,ec);
-            if(!ec&&actualSize!=expectedSize) {
-                g_logger<<"[WARN] 文件大小不匹配: 期望 "<<progressReporter.FormatBytes(expectedSize)<<", 实际 "<<progressReporter.FormatBytes(actualSize)<<std::endl;
-            }
+        if(actualHash!=expectedHash) {
+            LOG_ERROR<<"更新包哈希验证失败"<<std::endl;
+            LOG_ERROR<<"期望: "<<expectedHash<<std::endl;
+            LOG_ERROR<<"实际: "<<actualHash<<std::endl;
+
+            std::filesystem::remove(tempZip);
+            return false;
+        }
+        else {
+            LOG_INFO<<"更新包哈希验证通过"<<std::endl;
         }
+    }
+    return true;
+}
+bool IncrementalUpdatePlanner::ApplyPackage(const std::string& packagePath,const std::string& tempZip,size_t index) {
+    ZipPackageReader package;
+    if(!package.Open(tempZip)) {
+        LOG_ERROR<<"打开更新包失败: "<<packagePath<<std::endl;
+        return false;
+    }
 
-        if(!expectedHash.empty()) {
-            g_logger<<"[INFO] 验证文件哈希..."<<std::endl;
+    if(package.HasEntry(UPDATE_MANIFEST_ENTRY)) {
+        // 清单引用的文件直接从包内写到游戏目录，不再展开到临时目录
+        std::string manifestContent;
+        if(!package.ReadEntry(UPDATE_MANIFEST_ENTRY,manifestContent)) {
+            LOG_ERROR<<"读取更新清单失败: "<<packagePath<<std::endl;
+            return false;
+        }
+        LOG_INFO<<"应用更新..."<<std::endl;
+        std::vector<ManifestOperation> operations;
+        ParseUpdateManifest(manifestContent,0,operations);
+        if(!ApplyManifestOperations({&package},operations)) {
+            LOG_ERROR<<"应用清单更新失败"<<std::endl;
+            return false;
+        }
+        return true;
+    }
 
-            std::string actualHash=FileHasher::CalculateFileHashStream(tempZip,"md5");
-            if(actualHash!=expectedHash) {
-                g_logger<<"[ERROR] 更新包哈希验证失败"<<std::endl;
-                g_logger<<"[ERROR] 期望: "<<expectedHash<<std::endl;
-                g_logger<<"[ERROR] 实际: "<<actualHash<<std::endl;
+    package.Close();
+    LOG_WARN<<"未找到清单文件，使用传统文件复制方式"<<std::endl;
 
-                std::filesystem::remove(tempZip);
-                return false;
+    DWORD pid=GetCurrentProcessId();
+    auto timestamp=std::chrono::steady_clock::now().time_since_epoch().count();
+    std::string tempExtractDir=std::filesystem::temp_directory_path().string()+"/mc_extract_"+std::to_string(pid)+"_"+std::to_string(timestamp)+"_"+std::to_string(index);
+    fsHelper.EnsureDirectoryExists(tempExtractDir);
+
+    LOG_INFO<<"解压更新包..."<<std::endl;
+    if(!zipExtractor.ExtractZipFromFile(tempZip,tempExtractDir)) {
+        LOG_ERROR<<"解压更新包失败: "<<packagePath<<std::endl;
+        std::filesystem::remove_all(tempExtractDir);
+        return false;
+    }
+
+    LOG_INFO<<"应用更新..."<<std::endl;
+    bool applied=ApplyUpdateFromDirectory(tempExtractDir);
+    if(!applied) {
+        LOG_ERROR<<"应用更新失败"<<std::endl;
+    }
+    std::filesystem::remove_all(tempExtractDir);
+    return applied;
+}
+bool IncrementalUpdatePlanner::ApplyPackagesPrefetched(const Manifest& manifest,const std::vector<std::string>& packagePaths) {
+    const ConfigSnapshot& settings=configManager.GetSnapshot();
+    const size_t prefetchDepth=static_cast<size_t>((std::max)(settings.prefetchPackages,1));
+    const long long diskBudget=static_cast<long long>((std::max)(settings.tempDiskBudgetMB,0))*1024*1024;
+    const size_t count=packagePaths.size();
+
+    struct Download {
+        std::string tempZip;
+        // 计入磁盘预算的字节数：下载前为清单中的大小，下载完成后为实际大小
+        long long reservedBytes=0;
+        bool finished=false;
+        bool success=false;
+    };
+    std::vector<Download> downloads(count);
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t appliedCount=0;
+    long long reservedBytes=0;
+    bool stopping=false;
+
+    // 任何路径离开本函数前都要让下载线程退出并回收，包括异常
+    struct DownloaderGuard {
+        std::mutex& mutex;
+        std::condition_variable& changed;
+        bool& stopping;
+        std::thread thread;
+
+        void Stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping=true;
             }
-            else {
-                g_logger<<"[INFO] 更新包哈希验证通过"<<std::endl;
+            changed.notify_all();
+            if(thread.joinable()) {
+                thread.join();
             }
         }
+        ~DownloaderGuard() {
+            Stop();
+        }
+    };
+    DownloaderGuard downloader{mutex,changed,stopping};
+
+    LOG_INFO<<"后台预取更新包: 最多领先 "<<prefetchDepth<<" 个包"
+        <<(diskBudget>0?"，临时空间上限 "+progressReporter.FormatBytes(diskBudget):std::string())<<std::endl;
+
+    // 第一级：下载并校验；第二级（当前线程）：按顺序应用并删除
+    downloader.thread=std::thread([&]() {
+        for(size_t i=0; i<count; i++) {
+            const Manifest::Package* packageInfo=manifest.FindPackage(packagePaths[i]);
+            long long expectedSize=packageInfo?(std::max)(packageInfo->size,0LL):0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                // 下一个待应用的包总是允许下载，否则预算再小也无法推进
+                changed.wait(lock,[&]() {
+                    return stopping||(i<=appliedCount+prefetchDepth&&
+                        (i==appliedCount||diskBudget<=0||reservedBytes+expectedSize<=diskBudget));
+                    });
+                if(stopping) {
+                    return;
+                }
+                reservedBytes+=expectedSize;
+                downloads[i].reservedBytes=expectedSize;
+            }
 
-        std::string tempExtractDir=tempDir+"/mc_extract_"+std::to_string(pid)+"_"+std::to_string(timestamp)+"_"+std::to_string(i);
-        fsHelper.EnsureDirectoryExists(tempExtractDir);
+            LOG_INFO<<"("<<(i+1)<<"/"<<count<<") 下载更新包: "<<packagePaths[i]<<std::endl;
+            std::string tempZip;
+            bool success=false;
+            try {
+                success=DownloadPackage(manifest,packagePaths[i],i,count,tempZip);
+            }
+            catch(const std::exception& e) {
+                LOG_ERROR<<"下载更新包异常: "<<packagePaths[i]<<" - "<<e.what()<<std::endl;
+            }
+            catch(...) {
+                LOG_ERROR<<"下载更新包异常: "<<packagePaths[i]<<std::endl;
+            }
+            if(!success&&!tempZip.empty()) {
+                std::error_code ec;
+                std::filesystem::remove(tempZip,ec);
+                tempZip.clear();
+            }
+            long long actualSize=0;
+            if(success&&!tempZip.empty()) {
+                std::error_code ec;
+                auto fileSize=std::filesystem::file_size(tempZip,ec);
+                actualSize=ec?expectedSize:static_cast<long long>(fileSize);
+            }
 
-        g_logger<<"[INFO] 解压更新包..."<<std::endl;
-        if(!zipExtractor.ExtractZipFromFile(tempZip,tempExtractDir)) {
-            g_logger<<"[ERROR] 解压更新包失败: "<<packagePath<<std::endl;
-            std::filesystem::remove_all(tempExtractDir);
-            std::filesystem::remove(tempZip);
-            return false;
+            std::lock_guard<std::mutex> lock(mutex);
+            reservedBytes+=actualSize-downloads[i].reservedBytes;
+            downloads[i].reservedBytes=actualSize;
+            downloads[i].tempZip=tempZip;
+            downloads[i].success=success;
+            downloads[i].finished=true;
+            changed.notify_all();
+            if(!success) {
+                return;
+            }
         }
-
-        g_logger<<"[INFO] 应用更新..."<<std::endl;
-        std::string manifestPath=tempExtractDir+"/update_manifest.txt";
-        if(std::filesystem::exists(manifestPath)) {
-            if(!ApplyUpdateFromManifest(manifestPath,tempExtractDir)) {
-                g_logger<<"[ERROR] 应用清单更新失败"<<std::endl;
-                std::filesystem::remove_all(tempExtractDir);
-                std::filesystem::remove(tempZip);
-                return false;
+        });
+
+    // 下载中途无法取消，只能等它结束后清理尚未应用的包
+    auto finish=[&](bool result) {
+        downloader.Stop();
+        std::error_code ec;
+        for(size_t i=appliedCount; i<count; i++) {
+            if(downloads[i].success&&!downloads[i].tempZip.empty()) {
+                std::filesystem::remove(downloads[i].tempZip,ec);
             }
         }
-        else {
-            g_logger<<"[WARN] 未找到清单文件，使用传统文件复制方式"<<std::endl;
-            if(!ApplyUpdateFromDirectory(tempExtractDir)) {
-                g_logger<<"[ERROR] 应用更新失败"<<std::endl;
-                std::filesystem::remove_all(tempExtractDir);
-                std::filesystem::remove(tempZip);
-                return false;
+        updateOrchestrator.OptimizeMemoryUsage();
+        return result;
+        };
+
+    for(size_t i=0; i<count; i++) {
+        const std::string& packagePath=packagePaths[i];
+        LOG_INFO<<"("<<(i+1)<<"/"<<count<<") 处理更新包: "<<packagePath<<std::endl;
+
+        std::string tempZip;
+        bool downloaded=false;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if(!downloads[i].finished) {
+                LOG_DEBUG<<"等待更新包下载完成: "<<packagePath<<std::endl;
             }
+            changed.wait(lock,[&]() { return downloads[i].finished; });
+            tempZip=downloads[i].tempZip;
+            downloaded=downloads[i].success;
+        }
+        if(!downloaded) {
+            return finish(false);
         }
 
-        std::filesystem::remove_all(tempExtractDir);
-        std::filesystem::remove(tempZip);
+        bool applied=true;
+        if(!tempZip.empty()) {
+            try {
+                applied=ApplyPackage(packagePath,tempZip,i);
+            }
+            catch(const std::exception& e) {
+                LOG_ERROR<<"应用更新包异常: "<<packagePath<<" - "<<e.what()<<std::endl;
+                applied=false;
+            }
+            std::error_code ec;
+            std::filesystem::remove(tempZip,ec);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            appliedCount=i+1;
+            reservedBytes-=downloads[i].reservedBytes;
+        }
+        changed.notify_all();
+        if(!applied) {
+            return finish(false);
+        }
 
-        g_logger<<"[INFO] 更新包 ("<<(i+1)<<"/"<<packagePaths.size()<<") 处理完成"<<std::endl;
+        if(!tempZip.empty()) {
+            LOG_INFO<<"更新包 ("<<(i+1)<<"/"<<count<<") 处理完成"<<std::endl;
+        }
+    }
 
-        updateOrchestrator.OptimizeMemoryUsage();
+    return finish(true);
+}
+bool IncrementalUpdatePlanner::ApplyCoalescedUpdate(const std::vector<std::string>& packagePaths,const std::vector<std::string>& tempZips) {
+    std::vector<std::unique_ptr<ZipPackageReader>> readers;
+    std::vector<ZipPackageReader*> packages;
+    std::vector<ManifestOperation> operations;
+    bool allHaveManifest=true;
+    for(size_t i=0; i<tempZips.size()&&allHaveManifest; i++) {
+        if(tempZips[i].empty()) {
+            continue;
+        }
+        readers.push_back(std::make_unique<ZipPackageReader>());
+        ZipPackageReader& package=*readers.back();
+        if(!package.Open(tempZips[i])) {
+            LOG_ERROR<<"打开更新包失败: "<<packagePaths[i]<<std::endl;
+            return false;
+        }
+        if(!package.HasEntry(UPDATE_MANIFEST_ENTRY)) {
+            allHaveManifest=false;
+            break;
+        }
+        std::string manifestContent;
+        if(!package.ReadEntry(UPDATE_MANIFEST_ENTRY,manifestContent)) {
+            LOG_ERROR<<"读取更新清单失败: "<<packagePaths[i]<<std::endl;
+            return false;
+        }
+        ParseUpdateManifest(manifestContent,packages.size(),operations);
+        packages.push_back(&package);
     }
 
-    g_logger<<"[INFO] 所有增量更新包应用完成"<<std::endl;
+    if(!allHaveManifest) {
+        // 没有清单的包只能整包复制，无法计算净效果，按顺序逐个应用
+        LOG_WARN<<"部分更新包没有清单，按顺序逐个应用"<<std::endl;
+        readers.clear();
+        for(size_t i=0; i<tempZips.size(); i++) {
+            if(tempZips[i].empty()) {
+                continue;
+            }
+            LOG_INFO<<"("<<(i+1)<<"/"<<tempZips.size()<<") 应用更新包: "<<packagePaths[i]<<std::endl;
+            if(!ApplyPackage(packagePaths[i],tempZips[i],i)) {
+                return false;
+            }
+            updateOrchestrator.OptimizeMemoryUsage();
+        }
+        return true;
+    }
 
-    return true;
-}
-bool IncrementalUpdatePlanner::ApplyUpdateFromManifest(const std::string& manifestPath,const std::string& tempDir) {
-    std::ifstream manifestFile(manifestPath);
-    if(!manifestFile.is_open()) {
-        g_logger<<"[ERROR] 无法打开清单文件: "<<manifestPath<<std::endl;
+    std::vector<ManifestOperation> netOperations=CoalesceOperations(operations);
+    LOG_INFO<<"合并 "<<packages.size()<<" 个更新包的清单: "<<operations.size()<<" 项操作合并为 "<<netOperations.size()<<" 项"<<std::endl;
+    LOG_INFO<<"应用更新..."<<std::endl;
+    if(!ApplyManifestOperations(packages,netOperations)) {
+        LOG_ERROR<<"应用清单更新失败"<<std::endl;
         return false;
     }
-
+    return true;
+}
+void IncrementalUpdatePlanner::ParseUpdateManifest(const std::string& content,size_t package,std::vector<ManifestOperation>& operations) {
+    std::istringstream manifestFile(content);
     std::string line;
-    int operationCount=0;
-    int successCount=0;
-    int failCount=0;
-
     while(std::getline(manifestFile,line)) {
+        // 清单从包内直接读出，没有文本模式的换行转换
+        if(!line.empty()&&line.back()=='\r') line.pop_back();
         // 跳过注释行和空行
         if(line.empty()||line[0]=='#') continue;
 
@@ -320,50 +643,109 @@ bool IncrementalUpdatePlanner::ApplyUpdateFromManifest(const std::string& manife
             tokens.push_back(token);
         }
         if(tokens.size()<2) {
-            g_logger<<"[WARN] 忽略无效行: "<<line<<std::endl;
+            LOG_WARN<<"忽略无效行: "<<line<<std::endl;
             continue;
         }
 
-        std::string type=tokens[0];
-        std::string path=tokens[1];
-        std::string oldPath=(tokens.size()>2)?tokens[2]:"";
-        std::string hash=(tokens.size()>3)?tokens[3]:"";
-        uint64_t size=(tokens.size()>4)?std::stoull(tokens[4]):0;
+        ManifestOperation operation;
+        operation.type=tokens[0];
+        operation.path=tokens[1];
+        operation.oldPath=(tokens.size()>2)?tokens[2]:"";
+        operation.package=package;
+        operations.push_back(std::move(operation));
+    }
+}
+std::vector<IncrementalUpdatePlanner::ManifestOperation> IncrementalUpdatePlanner::CoalesceOperations(const std::vector<ManifestOperation>& operations) {
+    // 每个路径只保留链上最后一次操作；结果按各自最后一次操作的先后排列
+    std::map<std::string,size_t> lastIndex;
+    std::vector<ManifestOperation> recorded;
+    std::vector<bool> superseded;
+    auto record=[&lastIndex,&recorded,&superseded](ManifestOperation operation) {
+        std::string key=operation.path;
+        std::replace(key.begin(),key.end(),'\\','/');
+        auto it=lastIndex.find(key);
+        if(it!=lastIndex.end()) {
+            superseded[it->second]=true;
+        }
+        lastIndex[key]=recorded.size();
+        recorded.push_back(std::move(operation));
+        superseded.push_back(false);
+        };
+
+    for(const auto& operation:operations) {
+        if(operation.type=="R"&&!operation.oldPath.empty()) {
+            // 移动拆成删除旧路径和写入新路径，两边各自参与合并
+            ManifestOperation removal;
+            removal.type="D";
+            removal.path=operation.oldPath;
+            removal.package=operation.package;
+            record(std::move(removal));
+
+            ManifestOperation write=operation;
+            write.type="M";
+            write.oldPath.clear();
+            record(std::move(write));
+        }
+        else {
+            record(operation);
+        }
+    }
+
+    std::vector<ManifestOperation> result;
+    result.reserve(lastIndex.size());
+    for(size_t i=0; i<recorded.size(); i++) {
+        if(!superseded[i]) {
+            result.push_back(std::move(recorded[i]));
+        }
+    }
+    return result;
+}
+bool IncrementalUpdatePlanner::ApplyManifestOperations(const std::vector<ZipPackageReader*>& packages,
+    const std::vector<ManifestOperation>& operations) {
+    bool skipUnchanged=configManager.GetSnapshot().skipUnchangedFiles;
+
+    int operationCount=0;
+    int successCount=0;
+    int skippedCount=0;
+    int failCount=0;
+
+    for(const auto& operation:operations) {
+        const std::string& type=operation.type;
+        const std::string& path=operation.path;
+        const std::string& oldPath=operation.oldPath;
+        ZipPackageReader& package=*packages[operation.package];
 
         // 根据类型执行操作
         if(type=="A"||type=="M") {
-            std::string sourceFile;
             std::string targetFile;
             try {
-                sourceFile=FileSystemHelper::SecureCombine(tempDir,path); 
                 targetFile=FileSystemHelper::SecureCombine(updateOrchestrator.GetGameDirectory(),path);
             }
             catch(const std::exception& e) {
-                g_logger<<"[ERROR] 路径遍历被阻止: "<<e.what()<<std::endl;
+                LOG_ERROR<<"路径遍历被阻止: "<<e.what()<<std::endl;
                 failCount++;
                 continue;
             }
 
-            fsHelper.EnsureDirectoryExists(std::filesystem::path(targetFile).parent_path().string());
-
-            if(std::filesystem::exists(sourceFile)) {
-                std::error_code ec;
-                std::filesystem::copy_file(sourceFile,targetFile,
-                    std::filesystem::copy_options::overwrite_existing,ec);
-                if(ec) {
-                    g_logger<<"[ERROR] 复制文件失败: "<<sourceFile<<" -> "<<targetFile
-                        <<" - "<<ec.message()<<std::endl;
-                    failCount++;
-                }
-                else {
-                    g_logger<<"[INFO] "<<(type=="A"?"新增":"修改")
+            if(!package.HasEntry(path)) {
+                LOG_WARN<<"更新包中不存在源文件: "<<path<<std::endl;
+                failCount++;
+            }
+            else if(skipUnchanged&&package.EntryMatchesFile(path,targetFile)) {
+                LOG_DEBUG<<"文件未变化，跳过: "<<path<<std::endl;
+                skippedCount++;
+                successCount++;
+            }
+            else {
+                fsHelper.EnsureDirectoryExists(std::filesystem::path(targetFile).parent_path().string());
+                if(package.ExtractEntryTo(path,targetFile)) {
+                    LOG_INFO<<(type=="A"?"新增":"修改")
                         <<"文件: "<<path<<std::endl;
                     successCount++;
                 }
-            }
-            else {
-                g_logger<<"[WARN] 源文件不存在: "<<sourceFile<<std::endl;
-                failCount++;
+                else {
+                    failCount++;
+                }
             }
         }
         else if(type=="D") {
@@ -373,24 +755,24 @@ bool IncrementalUpdatePlanner::ApplyUpdateFromManifest(const std::string& manife
                 targetFile=FileSystemHelper::SecureCombine(updateOrchestrator.GetGameDirectory(),path);
             }
             catch(const std::exception& e) {
-                g_logger<<"[ERROR] 路径遍历被阻止: "<<e.what()<<std::endl;
+                LOG_ERROR<<"路径遍历被阻止: "<<e.what()<<std::endl;
                 failCount++;
                 continue;
             }
             if(std::filesystem::exists(targetFile)) {
                 try {
                     std::filesystem::remove(targetFile);
-                    g_logger<<"[INFO] 删除文件: "<<path<<std::endl;
+                    LOG_INFO<<"删除文件: "<<path<<std::endl;
                     successCount++;
                 }
                 catch(const std::exception& e) {
-                    g_logger<<"[ERROR] 删除文件失败: "<<targetFile
+                    LOG_ERROR<<"删除文件失败: "<<targetFile
                         <<" - "<<e.what()<<std::endl;
                     failCount++;
                 }
             }
             else {
-                g_logger<<"[DEBUG] 文件不存在，无需删除: "<<path<<std::endl;
+                LOG_DEBUG<<"文件不存在，无需删除: "<<path<<std::endl;
                 // 不存在也算成功
                 successCount++;
             }
@@ -398,42 +780,33 @@ bool IncrementalUpdatePlanner::ApplyUpdateFromManifest(const std::string& manife
         else if(type=="R") {
             // 移动/重命名文件
             if(oldPath.empty()) {
-                g_logger<<"[ERROR] 移动操作缺少 old_path: "<<line<<std::endl;
+                LOG_ERROR<<"移动操作缺少 old_path: "<<path<<std::endl;
                 failCount++;
                 continue;
             }
-            std::string sourceFile,targetFile,oldTargetFile;
+            std::string targetFile,oldTargetFile;
             try {
-                sourceFile=FileSystemHelper::SecureCombine(tempDir,path);
                 targetFile=FileSystemHelper::SecureCombine(updateOrchestrator.GetGameDirectory(),path);
                 oldTargetFile=FileSystemHelper::SecureCombine(updateOrchestrator.GetGameDirectory(),oldPath);
             }
             catch(const std::exception& e) {
-                g_logger<<"[ERROR] 路径遍历被阻止: "<<e.what()<<std::endl;
+                LOG_ERROR<<"路径遍历被阻止: "<<e.what()<<std::endl;
                 failCount++;
                 continue;
             }
 
-            fsHelper.EnsureDirectoryExists(std::filesystem::path(targetFile).parent_path().string());
-
-            if(std::filesystem::exists(sourceFile)) {
-                try {
-                    std::filesystem::copy_file(sourceFile,targetFile,
-                        std::filesystem::copy_options::overwrite_existing);
-                    g_logger<<"[INFO] 移动文件: "<<oldPath<<" -> "<<path<<std::endl;
-                }
-                catch(const std::exception& e) {
-                    g_logger<<"[ERROR] 复制文件失败 (移动操作): "<<sourceFile
-                        <<" -> "<<targetFile<<" - "<<e.what()<<std::endl;
-                    failCount++;
-                    continue;
-                }
+            if(!package.HasEntry(path)) {
+                LOG_ERROR<<"移动操作的源文件不存在: "<<path<<std::endl;
+                failCount++;
+                continue;
             }
-            else {
-                g_logger<<"[ERROR] 移动操作的源文件不存在: "<<sourceFile<<std::endl;
+            fsHelper.EnsureDirectoryExists(std::filesystem::path(targetFile).parent_path().string());
+            if(!package.ExtractEntryTo(path,targetFile)) {
+                LOG_ERROR<<"写入文件失败 (移动操作): "<<path<<std::endl;
                 failCount++;
                 continue;
             }
+            LOG_INFO<<"移动文件: "<<oldPath<<" -> "<<path<<std::endl;
 
             // 删除旧文件
             if(std::filesystem::exists(oldTargetFile)) {
@@ -441,7 +814,7 @@ bool IncrementalUpdatePlanner::ApplyUpdateFromManifest(const std::string& manife
                     std::filesystem::remove(oldTargetFile);
                 }
                 catch(const std::exception& e) {
-                    g_logger<<"[WARN] 移动后删除旧文件失败: "<<oldTargetFile
+                    LOG_WARN<<"移动后删除旧文件失败: "<<oldTargetFile
                         <<" - "<<e.what()<<std::endl;
                     // 不标记为失败，因为新文件已复制
                 }
@@ -454,22 +827,22 @@ bool IncrementalUpdatePlanner::ApplyUpdateFromManifest(const std::string& manife
                 targetDir=FileSystemHelper::SecureCombine(updateOrchestrator.GetGameDirectory(),path);
             }
             catch(const std::exception& e) {
-                g_logger<<"[ERROR] 路径遍历被阻止: "<<e.what()<<std::endl;
+                LOG_ERROR<<"路径遍历被阻止: "<<e.what()<<std::endl;
                 failCount++;
                 continue;
             }
             try {
                 if(!std::filesystem::exists(targetDir)) {
                     std::filesystem::create_directories(targetDir);
-                    g_logger<<"[INFO] 创建空目录: "<<path<<std::endl;
+                    LOG_INFO<<"创建空目录: "<<path<<std::endl;
                 }
                 else {
-                    g_logger<<"[DEBUG] 目录已存在: "<<path<<std::endl;
+                    LOG_DEBUG<<"目录已存在: "<<path<<std::endl;
                 }
                 successCount++;
             }
             catch(const std::exception& e) {
-                g_logger<<"[ERROR] 创建目录失败: "<<targetDir
+                LOG_ERROR<<"创建目录失败: "<<targetDir
                     <<" - "<<e.what()<<std::endl;
                 failCount++;
             }
@@ -481,7 +854,7 @@ bool IncrementalUpdatePlanner::ApplyUpdateFromManifest(const std::string& manife
                 targetDir=FileSystemHelper::SecureCombine(updateOrchestrator.GetGameDirectory(),path);
             }
             catch(const std::exception& e) {
-                g_logger<<"[ERROR] 路径遍历被阻止: "<<e.what()<<std::endl;
+                LOG_ERROR<<"路径遍历被阻止: "<<e.what()<<std::endl;
                 failCount++;
                 continue;
             }
@@ -489,22 +862,22 @@ bool IncrementalUpdatePlanner::ApplyUpdateFromManifest(const std::string& manife
                 try {
                     // 仅删除空目录（如果目录非空，可能因为文件残留而失败）
                     std::filesystem::remove(targetDir);
-                    g_logger<<"[INFO] 删除空目录: "<<path<<std::endl;
+                    LOG_INFO<<"删除空目录: "<<path<<std::endl;
                     successCount++;
                 }
                 catch(const std::exception& e) {
-                    g_logger<<"[WARN] 删除目录失败 (可能非空): "<<targetDir
+                    LOG_WARN<<"删除目录失败 (可能非空): "<<targetDir
                         <<" - "<<e.what()<<std::endl;
                     failCount++;
                 }
             }
             else {
-                g_logger<<"[DEBUG] 目录不存在或非目录，无需删除: "<<path<<std::endl;
+                LOG_DEBUG<<"目录不存在或非目录，无需删除: "<<path<<std::endl;
                 successCount++;
             }
         }
         else {
-            g_logger<<"[WARN] 未知操作类型: "<<type<<" (行: "<<line<<")"<<std::endl;
+            LOG_WARN<<"未知操作类型: "<<type<<" (路径: "<<path<<")"<<std::endl;
             failCount++;
         }
 
@@ -515,26 +888,27 @@ bool IncrementalUpdatePlanner::ApplyUpdateFromManifest(const std::string& manife
         }
     }
 
-    manifestFile.close();
     std::cout<<"\r清单处理完成: 总计 "<<operationCount<<" 项操作, 成功: "<<successCount
-        <<", 失败: "<<failCount<<"                    "<<std::endl;
+        <<" (未变化跳过 "<<skippedCount<<"), 失败: "<<failCount<<"                    "<<std::endl;
 
-    g_logger<<"[INFO] 从清单执行了 "<<operationCount<<" 项操作, 成功: "<<successCount
-        <<", 失败: "<<failCount<<std::endl;
+    LOG_INFO<<"从清单执行了 "<<operationCount<<" 项操作, 成功: "<<successCount
+        <<" (未变化跳过 "<<skippedCount<<"), 失败: "<<failCount<<std::endl;
 
     return failCount==0;
 }
 bool IncrementalUpdatePlanner::ApplyUpdateFromDirectory(const std::string& sourceDir) {
     int fileCount=0;
+    int skippedCount=0;
     int failedCount=0;
     const int BATCH_SIZE=50;
+    bool skipUnchanged=configManager.GetSnapshot().skipUnchangedFiles;
 
     try {
         std::wstring wideSourceDir=fsHelper.Utf8ToWide(sourceDir);
         std::wstring wideGameDir=fsHelper.Utf8ToWide(updateOrchestrator.GetGameDirectory());
 
         if(wideSourceDir.empty()||wideGameDir.empty()) {
-            g_logger<<"[ERROR] 无法转换路径为宽字符"<<std::endl;
+            LOG_ERROR<<"无法转换路径为宽字符"<<std::endl;
             return false;
         }
 
@@ -546,12 +920,23 @@ bool IncrementalUpdatePlanner::ApplyUpdateFromDirectory(const std::string& sourc
                     wideTargetPath=FileSystemHelper::SecureCombineW(wideGameDir,wideRelativePath);
                 }
                 catch(const std::exception& e) {
-                    g_logger<<"[ERROR] 路径遍历被阻止: "
+                    LOG_ERROR<<"路径遍历被阻止: "
                         <<FileSystemHelper::WideToUtf8(wideRelativePath)<<" - "<<e.what()<<std::endl;
                     failedCount++;
                     continue;
                 }
 
+                // 目标文件大小和 CRC-32 与更新文件一致时不复制，大小不同时两边都不用读
+                std::error_code sizeError;
+                uint32_t sourceCrc=0;
+                uint32_t targetCrc=0;
+                if(skipUnchanged&&std::filesystem::file_size(wideTargetPath,sizeError)==entry.file_size()&&!sizeError&&
+                    FileHasher::CalculateFileCrc32(entry.path().wstring(),sourceCrc)&&
+                    FileHasher::CalculateFileCrc32(wideTargetPath,targetCrc)&&sourceCrc==targetCrc) {
+                    skippedCount++;
+                    continue;
+                }
+
                 std::filesystem::path targetDir=std::filesystem::path(wideTargetPath).parent_path();
                 if(!targetDir.empty()) {
                     std::filesystem::create_directories(targetDir);
@@ -570,23 +955,23 @@ bool IncrementalUpdatePlanner::ApplyUpdateFromDirectory(const std::string& sourc
                 }
                 else {
                     failedCount++;
-                    g_logger<<"[WARN] 文件复制失败: "<<fsHelper.WideToUtf8(entry.path().wstring())<<std::endl;
+                    LOG_WARN<<"文件复制失败: "<<fsHelper.WideToUtf8(entry.path().wstring())<<std::endl;
                 }
             }
         }
 
-        std::cout<<"\r应用更新完成: "<<fileCount<<" 个文件已处理，失败: "<<failedCount<<"                  "<<std::endl;
-        g_logger<<"[INFO] 应用更新完成: "<<fileCount<<" 个文件已处理，失败: "<<failedCount<<std::endl;
+        std::cout<<"\r应用更新完成: "<<fileCount<<" 个文件已处理，"<<skippedCount<<" 个未变化已跳过，失败: "<<failedCount<<"                  "<<std::endl;
+        LOG_INFO<<"应用更新完成: "<<fileCount<<" 个文件已处理，"<<skippedCount<<" 个未变化已跳过，失败: "<<failedCount<<std::endl;
 
         if(failedCount>0) {
-            g_logger<<"[WARN] "<<failedCount<<" 个文件处理失败"<<std::endl;
+            LOG_WARN<<failedCount<<" 个文件处理失败"<<std::endl;
             return false;
         }
 
         return true;
     }
     catch(const std::exception& e) {
-        g_logger<<"[ERROR] 应用更新失败: "<<e.what()<<std::endl;
+        LOG_ERROR<<"应用更新失败: "<<e.what()<<std::endl;
         return false;
     }
 }
@@ -598,7 +983,7 @@ bool IncrementalUpdatePlanner::ApplyAllFilesFromUpdate(const std::string& tempDi
     std::wstring wideGameDir=fsHelper.Utf8ToWide(updateOrchestrator.GetGameDirectory());
 
     if(wideTempDir.empty()||wideGameDir.empty()) {
-        g_logger<<"[ERROR] 无法转换路径为宽字符"<<std::endl;
+        LOG_ERROR<<"无法转换路径为宽字符"<<std::endl;
         return false;
     }
 
@@ -611,7 +996,7 @@ bool IncrementalUpdatePlanner::ApplyAllFilesFromUpdate(const std::string& tempDi
                     wideTargetPath=FileSystemHelper::SecureCombineW(wideGameDir,wideRelativePath);
                 }
                 catch(const std::exception& e) {
-                    g_logger<<"[ERROR] 路径遍历被阻止: "
+                    LOG_ERROR<<"路径遍历被阻止: "
                         <<FileSystemHelper::WideToUtf8(wideRelativePath)<<" - "<<e.what()<<std::endl;
                     failedCount++;
                     continue;
@@ -636,12 +1021,12 @@ bool IncrementalUpdatePlanner::ApplyAllFilesFromUpdate(const std::string& tempDi
         }
     }
     catch(const std::exception& e) {
-        g_logger<<"[ERROR] 遍历临时目录失败: "<<e.what()<<std::endl;
+        LOG_ERROR<<"遍历临时目录失败: "<<e.what()<<std::endl;
         return false;
     }
 
     std::cout<<"\r更新完成: "<<fileCount<<" 个文件已处理，失败: "<<failedCount<<"                  "<<std::endl;
-    g_logger<<"[INFO] 更新了 "<<fileCount<<" 个文件，失败: "<<failedCount<<std::endl;
+    LOG_INFO<<"更新了 "<<fileCount<<" 个文件，失败: "<<failedCount<<std::endl;
 
     return fileCount>0&&failedCount==0;
 }
\ No newline at end of file
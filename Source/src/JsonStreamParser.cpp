@@ -0,0 +1,403 @@
+﻿#include "JsonStreamParser.h"
+
+namespace {
+    const size_t MAX_DEPTH=1000;
+
+    bool IsWhitespace(char c) {
+        return c==' '||c=='\t'||c=='\n'||c=='\r';
+    }
+
+    bool IsDigit(char c) {
+        return c>='0'&&c<='9';
+    }
+
+    int HexValue(char c) {
+        if(c>='0'&&c<='9') return c-'0';
+        if(c>='a'&&c<='f') return c-'a'+10;
+        if(c>='A'&&c<='F') return c-'A'+10;
+        return -1;
+    }
+
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    bool IsValidNumber(const std::string& text) {
+        size_t i=0;
+        size_t n=text.size();
+        if(i<n&&text[i]=='-') i++;
+        if(i>=n||!IsDigit(text[i])) return false;
+        if(text[i]=='0') {
+            i++;
+        }
+        else {
+            while(i<n&&IsDigit(text[i])) i++;
+        }
+        if(i<n&&text[i]=='.') {
+            size_t start=++i;
+            while(i<n&&IsDigit(text[i])) i++;
+            if(i==start) return false;
+        }
+        if(i<n&&(text[i]=='e'||text[i]=='E')) {
+            i++;
+            if(i<n&&(text[i]=='+'||text[i]=='-')) i++;
+            size_t start=i;
+            while(i<n&&IsDigit(text[i])) i++;
+            if(i==start) return false;
+        }
+        return i==n;
+    }
+}
+
+JsonStreamParser::JsonStreamParser(Handler& handler)
+    : handler(handler),
+    expect(Expect::Value),
+    lexeme(Lexeme::None),
+    stringIsKey(false),
+    escapeState(0),
+    unicodeDigits(0),
+    unicodeValue(0),
+    pendingHighSurrogate(0),
+    bomMatched(0),
+    offset(0),
+    failed(false) {
+}
+
+void JsonStreamParser::Reset() {
+    containers.clear();
+    expect=Expect::Value;
+    lexeme=Lexeme::None;
+    token.clear();
+    stringIsKey=false;
+    escapeState=0;
+    unicodeDigits=0;
+    unicodeValue=0;
+    pendingHighSurrogate=0;
+    bomMatched=0;
+    offset=0;
+    failed=false;
+    error.clear();
+}
+
+bool JsonStreamParser::Feed(const char* data,size_t size) {
+    if(failed) {
+        return false;
+    }
+
+    size_t i=0;
+    // 开头的 UTF-8 BOM 可能被拆在两次 Feed 之间
+    static const unsigned char BOM[]={0xEF,0xBB,0xBF};
+    while(bomMatched<3&&i<size) {
+        if(static_cast<unsigned char>(data[i])!=BOM[bomMatched]) {
+            if(bomMatched>0) {
+                return Fail("无效的 BOM");
+            }
+            bomMatched=3;
+            break;
+        }
+        bomMatched++;
+        i++;
+        offset++;
+    }
+
+    while(i<size) {
+        char c=data[i];
+        if(lexeme==Lexeme::String) {
+            if(escapeState==0) {
+                // 普通字符成段追加，不逐字符分派
+                size_t start=i;
+                while(i<size) {
+                    unsigned char u=static_cast<unsigned char>(data[i]);
+                    if(u=='"'||u=='\\'||u<0x20) {
+                        break;
+                    }
+                    i++;
+                }
+                if(i>start) {
+                    if(pendingHighSurrogate) {
+                        AppendCodePoint(0xFFFD);
+                        pendingHighSurrogate=0;
+                    }
+                    token.append(data+start,i-start);
+                    offset+=i-start;
+                    continue;
+                }
+                if(c=='\\') {
+                    escapeState=1;
+                }
+                else if(c!='"') {
+                    return Fail("字符串中含有未转义的控制字符");
+                }
+                i++;
+                offset++;
+                if(c=='"'&&!FinishString()) {
+                    return false;
+                }
+                continue;
+            }
+            if(!ProcessEscape(c)) {
+                return false;
+            }
+            i++;
+            offset++;
+            continue;
+        }
+        if(lexeme==Lexeme::Number) {
+            if(IsDigit(c)||c=='-'||c=='+'||c=='.'||c=='e'||c=='E') {
+                token.push_back(c);
+                i++;
+                offset++;
+                continue;
+            }
+            // 数字没有结束符，遇到其他字符才算结束，该字符重新处理
+            if(!FinishNumber()) {
+                return false;
+            }
+            continue;
+        }
+        if(lexeme==Lexeme::Literal) {
+            if(c>='a'&&c<='z') {
+                token.push_back(c);
+                i++;
+                offset++;
+                continue;
+            }
+            if(!FinishLiteral()) {
+                return false;
+            }
+            continue;
+        }
+
+        if(!IsWhitespace(c)&&!ProcessStructural(c)) {
+            return false;
+        }
+        i++;
+        offset++;
+    }
+    return true;
+}
+
+bool JsonStreamParser::Finish() {
+    if(failed) {
+        return false;
+    }
+    if(lexeme==Lexeme::Number&&!FinishNumber()) {
+        return false;
+    }
+    if(lexeme==Lexeme::Literal&&!FinishLiteral()) {
+        return false;
+    }
+    if(lexeme==Lexeme::String||expect!=Expect::Done) {
+        return Fail("文档不完整");
+    }
+    return true;
+}
+
+bool JsonStreamParser::Fail(const std::string& message) {
+    failed=true;
+    error=message+" (偏移 "+std::to_string(offset)+")";
+    return false;
+}
+
+bool JsonStreamParser::ProcessStructural(char c) {
+    bool expectingValue=expect==Expect::Value||expect==Expect::ValueOrEnd;
+    switch(c) {
+    case '{':
+    case '[':
+        if(!expectingValue) {
+            return Fail(std::string("意外的 ")+c);
+        }
+        if(containers.size()>=MAX_DEPTH) {
+            return Fail("嵌套层数过多");
+        }
+        containers.push_back(c);
+        expect=(c=='{')?Expect::KeyOrEnd:Expect::ValueOrEnd;
+        if(!((c=='{')?handler.StartObject():handler.StartArray())) {
+            return Fail("解析被中止");
+        }
+        return true;
+    case '}':
+    case ']': {
+        char open=(c=='}')?'{':'[';
+        Expect empty=(c=='}')?Expect::KeyOrEnd:Expect::ValueOrEnd;
+        if(containers.empty()||containers.back()!=open||(expect!=empty&&expect!=Expect::CommaOrEnd)) {
+            return Fail(std::string("意外的 ")+c);
+        }
+        containers.pop_back();
+        if(!((c=='}')?handler.EndObject():handler.EndArray())) {
+            return Fail("解析被中止");
+        }
+        AfterValue();
+        return true;
+    }
+    case ',':
+        if(expect!=Expect::CommaOrEnd) {
+            return Fail("意外的 ,");
+        }
+        expect=(containers.back()=='{')?Expect::Key:Expect::Value;
+        return true;
+    case ':':
+        if(expect!=Expect::Colon) {
+            return Fail("意外的 :");
+        }
+        expect=Expect::Value;
+        return true;
+    case '"':
+        if(expect==Expect::Key||expect==Expect::KeyOrEnd) {
+            stringIsKey=true;
+        }
+        else if(expectingValue) {
+            stringIsKey=false;
+        }
+        else {
+            return Fail("意外的字符串");
+        }
+        lexeme=Lexeme::String;
+        token.clear();
+        escapeState=0;
+        return true;
+    default:
+        if(expectingValue&&(c=='-'||IsDigit(c))) {
+            lexeme=Lexeme::Number;
+        }
+        else if(expectingValue&&c>='a'&&c<='z') {
+            lexeme=Lexeme::Literal;
+        }
+        else {
+            return Fail(std::string("意外的字符 ")+c);
+        }
+        token.assign(1,c);
+        return true;
+    }
+}
+
+void JsonStreamParser::AfterValue() {
+    expect=containers.empty()?Expect::Done:Expect::CommaOrEnd;
+}
+
+bool JsonStreamParser::ProcessEscape(char c) {
+    if(escapeState==1) {
+        char decoded;
+        switch(c) {
+        case '"': decoded='"'; break;
+        case '\\': decoded='\\'; break;
+        case '/': decoded='/'; break;
+        case 'b': decoded='\b'; break;
+        case 'f': decoded='\f'; break;
+        case 'n': decoded='\n'; break;
+        case 'r': decoded='\r'; break;
+        case 't': decoded='\t'; break;
+        case 'u':
+            escapeState=2;
+            unicodeDigits=0;
+            unicodeValue=0;
+            return true;
+        default:
+            return Fail("无效的转义字符");
+        }
+        if(pendingHighSurrogate) {
+            AppendCodePoint(0xFFFD);
+            pendingHighSurrogate=0;
+        }
+        token.push_back(decoded);
+        escapeState=0;
+        return true;
+    }
+
+    int value=HexValue(c);
+    if(value<0) {
+        return Fail("无效的 \\u 转义");
+    }
+    unicodeValue=(unicodeValue<<4)|static_cast<unsigned long>(value);
+    if(++unicodeDigits<4) {
+        return true;
+    }
+    escapeState=0;
+
+    // 代理对拆成两个 \u 转义，孤立的代理项按 U+FFFD 处理
+    if(pendingHighSurrogate) {
+        if(unicodeValue>=0xDC00&&unicodeValue<=0xDFFF) {
+            AppendCodePoint(0x10000+((pendingHighSurrogate-0xD800)<<10)+(unicodeValue-0xDC00));
+            pendingHighSurrogate=0;
+            return true;
+        }
+        AppendCodePoint(0xFFFD);
+        pendingHighSurrogate=0;
+    }
+    if(unicodeValue>=0xD800&&unicodeValue<=0xDBFF) {
+        pendingHighSurrogate=unicodeValue;
+    }
+    else if(unicodeValue>=0xDC00&&unicodeValue<=0xDFFF) {
+        AppendCodePoint(0xFFFD);
+    }
+    else {
+        AppendCodePoint(unicodeValue);
+    }
+    return true;
+}
+
+void JsonStreamParser::AppendCodePoint(unsigned long codePoint) {
+    if(codePoint<0x80) {
+        token.push_back(static_cast<char>(codePoint));
+    }
+    else if(codePoint<0x800) {
+        token.push_back(static_cast<char>(0xC0|(codePoint>>6)));
+        token.push_back(static_cast<char>(0x80|(codePoint&0x3F)));
+    }
+    else if(codePoint<0x10000) {
+        token.push_back(static_cast<char>(0xE0|(codePoint>>12)));
+        token.push_back(static_cast<char>(0x80|((codePoint>>6)&0x3F)));
+        token.push_back(static_cast<char>(0x80|(codePoint&0x3F)));
+    }
+    else {
+        token.push_back(static_cast<char>(0xF0|(codePoint>>18)));
+        token.push_back(static_cast<char>(0x80|((codePoint>>12)&0x3F)));
+        token.push_back(static_cast<char>(0x80|((codePoint>>6)&0x3F)));
+        token.push_back(static_cast<char>(0x80|(codePoint&0x3F)));
+    }
+}
+
+bool JsonStreamParser::FinishString() {
+    lexeme=Lexeme::None;
+    if(pendingHighSurrogate) {
+        AppendCodePoint(0xFFFD);
+        pendingHighSurrogate=0;
+    }
+    if(stringIsKey) {
+        expect=Expect::Colon;
+        return handler.Key(token)||Fail("解析被中止");
+    }
+    if(!handler.String(token)) {
+        return Fail("解析被中止");
+    }
+    AfterValue();
+    return true;
+}
+
+bool JsonStreamParser::FinishNumber() {
+    lexeme=Lexeme::None;
+    if(!IsValidNumber(token)) {
+        return Fail("无效的数字 "+token);
+    }
+    if(!handler.Number(token)) {
+        return Fail("解析被中止");
+    }
+    AfterValue();
+    return true;
+}
+
+bool JsonStreamParser::FinishLiteral() {
+    lexeme=Lexeme::None;
+    bool accepted;
+    if(token=="true"||token=="false") {
+        accepted=handler.Bool(token=="true");
+    }
+    else if(token=="null") {
+        accepted=handler.Null();
+    }
+    else {
+        return Fail("无效的字面量 "+token);
+    }
+    if(!accepted) {
+        return Fail("解析被中止");
+    }
+    AfterValue();
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,223 @@
+﻿#include "Manifest.h"
+#include <algorithm>
+#include <cstring>
+#include "Logger.h"
+
+namespace {
+    int HexValue(char c) {
+        if(c>='0'&&c<='9') return c-'0';
+        if(c>='a'&&c<='f') return c-'a'+10;
+        if(c>='A'&&c<='F') return c-'A'+10;
+        return -1;
+    }
+}
+
+Manifest::Manifest()
+    : hasLauncher(false),
+    fileCount(0),
+    fromBinary(false) {
+}
+
+void Manifest::LoadHeaderFromJson(Json::Value& updateInfo) {
+    version=updateInfo["version"].asString();
+    updateMode=updateInfo["update_mode"].asString();
+
+    const Json::Value& launcherInfo=updateInfo["launcher"];
+    if(launcherInfo.isObject()&&launcherInfo.isMember("version")&&launcherInfo.isMember("url")) {
+        hasLauncher=true;
+        launcher.version=launcherInfo["version"].asString();
+        launcher.url=launcherInfo["url"].asString();
+        launcher.hash=launcherInfo["hash"].asString();
+    }
+
+    changelog.swap(updateInfo["changelog"]);
+
+    const Json::Value& deleteItems=updateInfo["delete_list"];
+    if(deleteItems.isArray()) {
+        deleteList.reserve(deleteItems.size());
+        for(const auto& item:deleteItems) {
+            deleteList.push_back(item.asString());
+        }
+    }
+
+    const Json::Value& packageList=updateInfo["incremental_packages"];
+    if(packageList.isArray()) {
+        for(const auto& item:packageList) {
+            if(!item.isObject()||!item.isMember("from_version")||!item.isMember("to_version")) {
+                continue;
+            }
+            Package package;
+            package.fromVersion=item["from_version"].asString();
+            package.toVersion=item["to_version"].asString();
+            package.archive=item["archive"].asString();
+            package.hash=item["hash"].asString();
+            package.size=item.isMember("size")?item["size"].asInt64():0;
+            packages.push_back(std::move(package));
+        }
+    }
+}
+
+const Manifest::Package* Manifest::FindPackage(const std::string& archive) const {
+    for(const auto& package:packages) {
+        if(package.archive==archive) {
+            return &package;
+        }
+    }
+    return nullptr;
+}
+
+Manifest::Span Manifest::AppendString(const std::string& value) {
+    Span span={static_cast<uint32_t>(strings.size()),static_cast<uint32_t>(value.size())};
+    strings+=value;
+    return span;
+}
+
+void Manifest::AddEntry(Span path,Span url,long long size,bool isDirectory,const std::string& hash) {
+    entryPaths.push_back(path);
+    entryUrls.push_back(url);
+    entrySizes.push_back(size);
+
+    unsigned char flags=isDirectory?ENTRY_IS_DIRECTORY:0;
+    Span digest={static_cast<uint32_t>(digests.size()),0};
+    bool decoded=hash.size()%2==0;
+    for(size_t i=0; decoded&&i<hash.size(); i+=2) {
+        int high=HexValue(hash[i]);
+        int low=HexValue(hash[i+1]);
+        decoded=high>=0&&low>=0;
+        if(decoded) {
+            digests.push_back(static_cast<unsigned char>((high<<4)|low));
+        }
+    }
+    if(!decoded) {
+        digests.resize(digest.offset);
+        digests.insert(digests.end(),hash.begin(),hash.end());
+        flags|=ENTRY_RAW_DIGEST;
+    }
+    digest.length=static_cast<uint32_t>(digests.size()-digest.offset);
+    entryDigests.push_back(digest);
+    entryFlags.push_back(flags);
+}
+
+void Manifest::AddDirectory(Span path,Span url,bool isEmpty,Range contents) {
+    directoryPaths.push_back(path);
+    directoryUrls.push_back(url);
+    directoryEmpty.push_back(isEmpty?1:0);
+    directoryContents.push_back(contents);
+}
+
+void Manifest::PlaceFilesFirst(uint32_t filesBegin,uint32_t filesEnd) {
+    fileCount=filesEnd-filesBegin;
+    if(filesBegin==0) {
+        return;
+    }
+    auto rotate=[filesBegin,filesEnd](auto& column) {
+        std::rotate(column.begin(),column.begin()+filesBegin,column.begin()+filesEnd);
+        };
+    rotate(entryPaths);
+    rotate(entryUrls);
+    rotate(entryDigests);
+    rotate(entrySizes);
+    rotate(entryFlags);
+    for(auto& contents:directoryContents) {
+        if(contents.first<filesBegin) {
+            contents.first+=fileCount;
+        }
+    }
+}
+
+void Manifest::ClearEntries() {
+    fileCount=0;
+    std::string().swap(strings);
+    std::vector<unsigned char>().swap(digests);
+    std::vector<Span>().swap(entryPaths);
+    std::vector<Span>().swap(entryUrls);
+    std::vector<Span>().swap(entryDigests);
+    std::vector<long long>().swap(entrySizes);
+    std::vector<unsigned char>().swap(entryFlags);
+    std::vector<Span>().swap(directoryPaths);
+    std::vector<Span>().swap(directoryUrls);
+    std::vector<Range>().swap(directoryContents);
+    std::vector<unsigned char>().swap(directoryEmpty);
+}
+
+void Manifest::LoadEntriesFromBinary(const BinaryManifest& binaryManifest) {
+    // 字符串表整体复制，原偏移保持不变，不需要逐条驻留
+    std::string_view table=binaryManifest.GetStringTable();
+    strings.assign(table.data(),table.size());
+    auto spanOf=[&table](std::string_view view) {
+        return Span{static_cast<uint32_t>(view.data()-table.data()),static_cast<uint32_t>(view.size())};
+        };
+
+    uint32_t entryCount=binaryManifest.GetEntryCount();
+    uint32_t digestSize=binaryManifest.GetDigestSize();
+    entryPaths.resize(entryCount);
+    entryUrls.resize(entryCount);
+    entryDigests.resize(entryCount);
+    entrySizes.resize(entryCount);
+    entryFlags.assign(entryCount,0);
+    digests.resize(static_cast<size_t>(entryCount)*digestSize);
+
+    for(uint32_t i=0; i<entryCount; i++) {
+        BinaryManifest::FileEntry entry=binaryManifest.GetEntry(i);
+        entryPaths[i]=spanOf(entry.path);
+        entryUrls[i]=spanOf(entry.url);
+        entrySizes[i]=entry.size;
+        entryDigests[i]={i*digestSize,0};
+        if(entry.digest) {
+            memcpy(digests.data()+static_cast<size_t>(i)*digestSize,entry.digest,digestSize);
+            entryDigests[i].length=digestSize;
+        }
+    }
+    fileCount=binaryManifest.GetFileCount();
+
+    uint32_t directoryCount=binaryManifest.GetDirectoryCount();
+    directoryPaths.resize(directoryCount);
+    directoryUrls.resize(directoryCount);
+    directoryContents.resize(directoryCount);
+    directoryEmpty.resize(directoryCount);
+    for(uint32_t i=0; i<directoryCount; i++) {
+        BinaryManifest::DirectoryEntry dirEntry=binaryManifest.GetDirectory(i);
+        directoryPaths[i]=spanOf(dirEntry.path);
+        directoryUrls[i]=spanOf(dirEntry.url);
+        directoryContents[i]={dirEntry.firstContent,dirEntry.contentCount};
+        directoryEmpty[i]=dirEntry.isEmpty?1:0;
+    }
+    fromBinary=true;
+}
+
+void Manifest::GetDigestHex(uint32_t entry,std::string& hex) const {
+    static const char hexDigits[]="0123456789abcdef";
+    const Span& span=entryDigests[entry];
+    const unsigned char* digest=digests.data()+span.offset;
+    if(entryFlags[entry]&ENTRY_RAW_DIGEST) {
+        hex.assign(reinterpret_cast<const char*>(digest),span.length);
+        return;
+    }
+    hex.resize(static_cast<size_t>(span.length)*2);
+    for(uint32_t i=0; i<span.length; i++) {
+        hex[i*2]=hexDigits[digest[i]>>4];
+        hex[i*2+1]=hexDigits[digest[i]&0x0F];
+    }
+}
+
+bool Manifest::DigestMatches(uint32_t entry,const std::string& hex) const {
+    const Span& span=entryDigests[entry];
+    const unsigned char* digest=digests.data()+span.offset;
+    if(span.length==0) {
+        return false;
+    }
+    if(entryFlags[entry]&ENTRY_RAW_DIGEST) {
+        return hex.size()==span.length&&memcmp(hex.data(),digest,span.length)==0;
+    }
+    if(hex.size()!=static_cast<size_t>(span.length)*2) {
+        return false;
+    }
+    for(uint32_t i=0; i<span.length; i++) {
+        int high=HexValue(hex[i*2]);
+        int low=HexValue(hex[i*2+1]);
+        if(high<0||low<0||digest[i]!=((high<<4)|low)) {
+            return false;
+        }
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,183 @@
+﻿#include "ManifestCache.h"
+#include <fstream>
+#include <filesystem>
+#include <memory>
+#include "Logger.h"
+
+ManifestCache::ManifestCache(const std::string& cachePath)
+    : cachePath(cachePath),
+    metaPath(cachePath+".meta"),
+    storePath(cachePath+".tmp"),
+    metaLoaded(false),
+    enabled(true) {
+}
+
+bool ManifestCache::LoadValidators(const std::string& url,std::string& etag,std::string& lastModified) {
+    if(!enabled) {
+        return false;
+    }
+
+    if(!metaLoaded) {
+        metaLoaded=true;
+        std::ifstream file(metaPath,std::ios::binary);
+        if(!file.is_open()) {
+            return false;
+        }
+        Json::CharReaderBuilder reader;
+        Json::Value meta;
+        std::string errors;
+        if(!Json::parseFromStream(reader,file,&meta,&errors)) {
+            LOG_WARN<<"清单缓存元数据损坏，将重新下载: "<<errors<<std::endl;
+            return false;
+        }
+        cachedUrl=meta["url"].asString();
+        cachedEtag=meta["etag"].asString();
+        cachedLastModified=meta["last_modified"].asString();
+    }
+
+    if(cachedUrl!=url||(cachedEtag.empty()&&cachedLastModified.empty())) {
+        return false;
+    }
+    std::error_code ec;
+    if(!std::filesystem::exists(cachePath,ec)) {
+        return false;
+    }
+
+    etag=cachedEtag;
+    lastModified=cachedLastModified;
+    return true;
+}
+
+bool ManifestCache::LoadManifest(ManifestParser& parser) {
+    std::ifstream file(cachePath,std::ios::binary);
+    if(!file.is_open()) {
+        return false;
+    }
+
+    // 分块喂给解析器，不把整个文件读进内存
+    std::unique_ptr<char[]> buffer(new char[65536]);
+    while(file) {
+        file.read(buffer.get(),65536);
+        std::streamsize count=file.gcount();
+        if(count>0&&!parser.Feed(buffer.get(),static_cast<size_t>(count))) {
+            break;
+        }
+    }
+    if(file.bad()||!parser.GetError().empty()||!parser.Finish()) {
+        LOG_WARN<<"清单缓存损坏: "<<parser.GetError()<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ManifestCache::BeginStore() {
+    AbortStore();
+    if(!enabled) {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::path target(cachePath);
+    if(target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path(),ec);
+    }
+    storeFile.open(storePath,std::ios::binary|std::ios::trunc);
+}
+
+void ManifestCache::AppendBody(const unsigned char* data,size_t size) {
+    if(!storeFile.is_open()) {
+        return;
+    }
+    storeFile.write(reinterpret_cast<const char*>(data),static_cast<std::streamsize>(size));
+    if(!storeFile.good()) {
+        LOG_WARN<<"写入清单缓存失败: "<<storePath<<std::endl;
+        AbortStore();
+    }
+}
+
+bool ManifestCache::CommitStore(const std::string& url,const std::string& etag,const std::string& lastModified) {
+    cachedUrl=url;
+    cachedEtag=etag;
+    cachedLastModified=lastModified;
+    metaLoaded=true;
+
+    if(!storeFile.is_open()||(etag.empty()&&lastModified.empty())) {
+        AbortStore();
+        return false;
+    }
+    storeFile.close();
+    std::error_code ec;
+    if(storeFile.fail()) {
+        storeFile.clear();
+        std::filesystem::remove(storePath,ec);
+        LOG_WARN<<"写入清单缓存失败: "<<storePath<<std::endl;
+        return false;
+    }
+
+    Json::Value meta;
+    meta["url"]=url;
+    meta["etag"]=etag;
+    meta["last_modified"]=lastModified;
+    Json::StreamWriterBuilder writer;
+    writer["indentation"]="";
+
+    // 先删元数据、换正文，再写元数据，元数据存在即代表正文完整
+    std::filesystem::remove(metaPath,ec);
+    std::filesystem::rename(storePath,cachePath,ec);
+    if(ec||!WriteFileAtomic(metaPath,Json::writeString(writer,meta))) {
+        std::filesystem::remove(storePath,ec);
+        LOG_WARN<<"写入清单缓存失败: "<<cachePath<<std::endl;
+        return false;
+    }
+    LOG_DEBUG<<"清单已缓存: "<<cachePath<<std::endl;
+    return true;
+}
+
+void ManifestCache::AbortStore() {
+    if(!storeFile.is_open()) {
+        return;
+    }
+    storeFile.close();
+    storeFile.clear();
+    std::error_code ec;
+    std::filesystem::remove(storePath,ec);
+}
+
+void ManifestCache::Invalidate() {
+    std::error_code ec;
+    std::filesystem::remove(metaPath,ec);
+    std::filesystem::remove(cachePath,ec);
+    cachedUrl.clear();
+    cachedEtag.clear();
+    cachedLastModified.clear();
+    metaLoaded=true;
+}
+
+bool ManifestCache::WriteFileAtomic(const std::string& path,const std::string& content) {
+    std::error_code ec;
+    std::filesystem::path target(path);
+    if(target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path(),ec);
+    }
+
+    std::string tempPath=path+".tmp";
+    {
+        std::ofstream file(tempPath,std::ios::binary|std::ios::trunc);
+        if(!file.is_open()) {
+            return false;
+        }
+        file.write(content.data(),static_cast<std::streamsize>(content.size()));
+        if(!file.good()) {
+            file.close();
+            std::filesystem::remove(tempPath,ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath,path,ec);
+    if(ec) {
+        std::filesystem::remove(tempPath,ec);
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
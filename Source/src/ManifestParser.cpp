@@ -0,0 +1,315 @@
+﻿#include "ManifestParser.h"
+#include <cerrno>
+#include <cstdlib>
+
+namespace {
+    Json::Value NumberValue(const std::string& text) {
+        if(text.find_first_of(".eE")==std::string::npos) {
+            errno=0;
+            if(text[0]=='-') {
+                long long value=std::strtoll(text.c_str(),nullptr,10);
+                if(errno!=ERANGE) {
+                    return Json::Value(static_cast<Json::Int64>(value));
+                }
+            }
+            else {
+                unsigned long long value=std::strtoull(text.c_str(),nullptr,10);
+                if(errno!=ERANGE) {
+                    return Json::Value(static_cast<Json::UInt64>(value));
+                }
+            }
+        }
+        return Json::Value(std::strtod(text.c_str(),nullptr));
+    }
+
+    // 条目字段只保存标量，asString 对标量不会抛异常
+    std::string FieldString(const Json::Value& fields,const char* key) {
+        const Json::Value& value=fields[key];
+        return value.isNull()?std::string():value.asString();
+    }
+}
+
+ManifestParser::ManifestParser()
+    : parser(*this),
+    directoryFirst(0),
+    skipDepth(0),
+    filesSeen(false),
+    directoriesSeen(false),
+    filesBegin(0),
+    filesEnd(0),
+    finished(false) {
+    Reset();
+}
+
+void ManifestParser::Reset() {
+    parser.Reset();
+    manifest.reset(new Manifest());
+    interned.clear();
+    header=Json::Value(Json::objectValue);
+    scopes.clear();
+    headerValues.clear();
+    currentKey.clear();
+    entryFields=Json::Value();
+    directoryFields=Json::Value();
+    directoryFirst=0;
+    skipDepth=0;
+    filesSeen=false;
+    directoriesSeen=false;
+    filesBegin=0;
+    filesEnd=0;
+    finished=false;
+    error.clear();
+}
+
+bool ManifestParser::Feed(const char* data,size_t size) {
+    return parser.Feed(data,size);
+}
+
+bool ManifestParser::Finish() {
+    if(!parser.Finish()) {
+        return false;
+    }
+    if(!manifest) {
+        return Fail("解析结果已被取走");
+    }
+    finished=true;
+    return true;
+}
+
+const std::string& ManifestParser::GetError() const {
+    return error.empty()?parser.GetError():error;
+}
+
+std::shared_ptr<const Manifest> ManifestParser::Build(const BinaryManifest* binaryManifest) {
+    if(!finished||!manifest) {
+        return nullptr;
+    }
+
+    manifest->LoadHeaderFromJson(header);
+    if(binaryManifest) {
+        manifest->ClearEntries();
+        manifest->LoadEntriesFromBinary(*binaryManifest);
+    }
+    else {
+        manifest->PlaceFilesFirst(filesBegin,filesEnd);
+    }
+
+    std::unordered_map<std::string,Manifest::Span>().swap(interned);
+    Json::Value().swap(header);
+    finished=false;
+    std::shared_ptr<const Manifest> result=std::move(manifest);
+    return result;
+}
+
+bool ManifestParser::Fail(const std::string& message) {
+    error=message;
+    return false;
+}
+
+bool ManifestParser::StartObject() {
+    if(skipDepth>0) {
+        skipDepth++;
+        return true;
+    }
+    if(scopes.empty()) {
+        scopes.push_back(Scope::Root);
+        return true;
+    }
+    switch(scopes.back()) {
+    case Scope::Root:
+    case Scope::Header:
+        BeginHeaderValue(Json::Value(Json::objectValue));
+        return true;
+    case Scope::Files:
+    case Scope::Contents:
+        entryFields=Json::Value(Json::objectValue);
+        scopes.push_back(Scope::Entry);
+        return true;
+    case Scope::Directories:
+        directoryFields=Json::Value(Json::objectValue);
+        directoryFirst=EntryCount();
+        scopes.push_back(Scope::Directory);
+        return true;
+    default:
+        skipDepth=1;
+        return true;
+    }
+}
+
+bool ManifestParser::StartArray() {
+    if(skipDepth>0) {
+        skipDepth++;
+        return true;
+    }
+    if(scopes.empty()) {
+        return Fail("更新信息不是 JSON 对象");
+    }
+    switch(scopes.back()) {
+    case Scope::Root:
+        if(currentKey=="files"||currentKey=="directories") {
+            // 重复的键只取第一个
+            bool isFiles=currentKey=="files";
+            if(isFiles?filesSeen:directoriesSeen) {
+                skipDepth=1;
+                return true;
+            }
+            if(isFiles) {
+                filesSeen=true;
+                filesBegin=EntryCount();
+                scopes.push_back(Scope::Files);
+            }
+            else {
+                directoriesSeen=true;
+                scopes.push_back(Scope::Directories);
+            }
+            return true;
+        }
+        BeginHeaderValue(Json::Value(Json::arrayValue));
+        return true;
+    case Scope::Header:
+        BeginHeaderValue(Json::Value(Json::arrayValue));
+        return true;
+    case Scope::Directory:
+        if(currentKey=="contents") {
+            scopes.push_back(Scope::Contents);
+            return true;
+        }
+        skipDepth=1;
+        return true;
+    default:
+        skipDepth=1;
+        return true;
+    }
+}
+
+bool ManifestParser::EndObject() {
+    return EndContainer();
+}
+
+bool ManifestParser::EndArray() {
+    return EndContainer();
+}
+
+bool ManifestParser::EndContainer() {
+    if(skipDepth>0) {
+        skipDepth--;
+        return true;
+    }
+    Scope scope=scopes.back();
+    scopes.pop_back();
+    switch(scope) {
+    case Scope::Entry:
+        CommitEntry();
+        break;
+    case Scope::Directory:
+        CommitDirectory();
+        break;
+    case Scope::Files:
+        filesEnd=EntryCount();
+        break;
+    case Scope::Header:
+        headerValues.pop_back();
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+bool ManifestParser::Key(std::string& key) {
+    if(skipDepth==0) {
+        currentKey.swap(key);
+    }
+    return true;
+}
+
+bool ManifestParser::String(std::string& value) {
+    return Scalar(Json::Value(value));
+}
+
+bool ManifestParser::Number(const std::string& text) {
+    return Scalar(NumberValue(text));
+}
+
+bool ManifestParser::Bool(bool value) {
+    return Scalar(Json::Value(value));
+}
+
+bool ManifestParser::Null() {
+    return Scalar(Json::Value());
+}
+
+bool ManifestParser::Scalar(Json::Value&& value) {
+    if(skipDepth>0) {
+        return true;
+    }
+    if(scopes.empty()) {
+        return Fail("更新信息不是 JSON 对象");
+    }
+    switch(scopes.back()) {
+    case Scope::Root:
+        header[currentKey]=std::move(value);
+        return true;
+    case Scope::Header:
+        AddHeaderValue(std::move(value));
+        return true;
+    case Scope::Entry:
+        entryFields[currentKey]=std::move(value);
+        return true;
+    case Scope::Directory:
+        directoryFields[currentKey]=std::move(value);
+        return true;
+    default:
+        // 条目数组里不是对象的元素忽略
+        return true;
+    }
+}
+
+void ManifestParser::BeginHeaderValue(Json::Value&& value) {
+    Json::Value* slot;
+    if(scopes.back()==Scope::Root) {
+        slot=&(header[currentKey]=std::move(value));
+    }
+    else {
+        slot=&AddHeaderValue(std::move(value));
+    }
+    // jsoncpp 的对象与数组以 std::map 存放子节点，插入新成员不会使已有引用失效
+    headerValues.push_back(slot);
+    scopes.push_back(Scope::Header);
+}
+
+Json::Value& ManifestParser::AddHeaderValue(Json::Value&& value) {
+    Json::Value& parent=*headerValues.back();
+    if(parent.isArray()) {
+        return parent.append(std::move(value));
+    }
+    return parent[currentKey]=std::move(value);
+}
+
+void ManifestParser::CommitEntry() {
+    const Json::Value& size=entryFields["size"];
+    manifest->AddEntry(Intern(FieldString(entryFields,"path")),
+        Intern(FieldString(entryFields,"url")),
+        size.isInt64()?size.asInt64():-1,
+        FieldString(entryFields,"type")=="directory",
+        FieldString(entryFields,"hash"));
+}
+
+void ManifestParser::CommitDirectory() {
+    const Json::Value& isEmpty=directoryFields["is_empty"];
+    Manifest::Range contents={directoryFirst,EntryCount()-directoryFirst};
+    manifest->AddDirectory(Intern(FieldString(directoryFields,"path")),
+        Intern(FieldString(directoryFields,"url")),
+        isEmpty.isBool()&&isEmpty.asBool(),
+        contents);
+}
+
+Manifest::Span ManifestParser::Intern(const std::string& value) {
+    auto it=interned.find(value);
+    if(it!=interned.end()) {
+        return it->second;
+    }
+    Manifest::Span span=manifest->AppendString(value);
+    interned.emplace(value,span);
+    return span;
+}
\ No newline at end of file
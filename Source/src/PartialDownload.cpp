@@ -0,0 +1,380 @@
+﻿#include "PartialDownload.h"
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <json/json.h>
+#include "Logger.h"
+
+namespace {
+    std::string TrimHeaderValue(const char* begin,const char* end) {
+        while(begin<end&&(*begin==' '||*begin=='\t')) {
+            begin++;
+        }
+        while(end>begin&&(end[-1]=='\r'||end[-1]=='\n'||end[-1]==' '||end[-1]=='\t')) {
+            end--;
+        }
+        return std::string(begin,end);
+    }
+
+    bool HeaderNameEquals(const char* buffer,size_t length,const char* name) {
+        size_t nameLength=strlen(name);
+        if(length<=nameLength||buffer[nameLength]!=':') {
+            return false;
+        }
+        for(size_t i=0; i<nameLength; i++) {
+            if(std::tolower(static_cast<unsigned char>(buffer[i]))!=name[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ParseByteCount(const std::string& text,long long& value) {
+        if(text.empty()||!std::isdigit(static_cast<unsigned char>(text[0]))) {
+            return false;
+        }
+        char* end=nullptr;
+        value=std::strtoll(text.c_str(),&end,10);
+        return *end=='\0'||*end=='-';
+    }
+
+    // 解析 "bytes 100-199/200" 或 "bytes */200"，缺失的部分为 -1
+    void ParseContentRange(const std::string& value,long long& start,long long& total) {
+        start=-1;
+        total=-1;
+        size_t slash=value.find('/');
+        if(value.compare(0,6,"bytes ")!=0||slash==std::string::npos) {
+            return;
+        }
+        if(!ParseByteCount(value.substr(6,slash-6),start)) {
+            start=-1;
+        }
+        if(!ParseByteCount(value.substr(slash+1),total)) {
+            total=-1;
+        }
+    }
+}
+
+PartialDownload::PartialDownload(const std::string& url,const std::string& outputPath,const std::string& algorithm)
+    : url(url),
+    outputPath(outputPath),
+    partPath(outputPath+".part"),
+    statePath(outputPath+".part.json"),
+    algorithm(algorithm),
+    handle(nullptr),
+    file(nullptr),
+    requestHeaders(nullptr),
+    expectedSize(0),
+    resumeOffset(0),
+    receivedBytes(0),
+    rangeStart(-1),
+    rangeTotal(-1),
+    httpStatus(0),
+    bodyStarted(false),
+    writeFailed(false),
+    resumable(false),
+    restartRequired(false) {
+}
+
+PartialDownload::~PartialDownload() {
+    Detach();
+    if(file) {
+        fclose(file);
+    }
+}
+
+bool PartialDownload::Open() {
+    resumeOffset=0;
+    receivedBytes=0;
+    httpStatus=0;
+    bodyStarted=false;
+    writeFailed=false;
+    resumable=false;
+    restartRequired=false;
+    rangeStart=-1;
+    rangeTotal=-1;
+    responseEtag.clear();
+    responseLastModified.clear();
+
+    if(!algorithm.empty()) {
+        hasher=std::make_unique<FileHasher::StreamHasher>(algorithm);
+        if(!hasher->IsValid()) {
+            LOG_WARN<<"不支持的哈希算法: "<<algorithm<<std::endl;
+            hasher.reset();
+        }
+    }
+
+    std::error_code ec;
+    long long partSize=static_cast<long long>(std::filesystem::file_size(partPath,ec));
+    if(!ec&&partSize>0&&LoadState()) {
+        // 已有部分数据要先喂给哈希，最终摘要才覆盖整个文件
+        if(!hasher||FileHasher::HashFileContents(partPath,*hasher)) {
+            resumeOffset=partSize;
+        }
+        else if(hasher) {
+            hasher=std::make_unique<FileHasher::StreamHasher>(algorithm);
+        }
+    }
+
+    if(resumeOffset>0) {
+        errno_t err=fopen_s(&file,partPath.c_str(),"ab");
+        if(err==0&&file) {
+            LOG_INFO<<"断点续传: "<<outputPath<<" 从 "<<resumeOffset<<" 字节继续"<<std::endl;
+            return true;
+        }
+        resumeOffset=0;
+        if(hasher) {
+            hasher=std::make_unique<FileHasher::StreamHasher>(algorithm);
+        }
+    }
+
+    etag.clear();
+    lastModified.clear();
+    errno_t err=fopen_s(&file,partPath.c_str(),"wb");
+    if(err!=0||!file) {
+        file=nullptr;
+        LOG_ERROR<<"无法创建文件: "<<partPath<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+void PartialDownload::Attach(CURL* curlHandle) {
+    handle=curlHandle;
+    curl_easy_setopt(handle,CURLOPT_WRITEFUNCTION,WriteCallback);
+    curl_easy_setopt(handle,CURLOPT_WRITEDATA,this);
+    curl_easy_setopt(handle,CURLOPT_HEADERFUNCTION,HeaderCallback);
+    curl_easy_setopt(handle,CURLOPT_HEADERDATA,this);
+
+    if(resumeOffset>0) {
+        // 用 CURLOPT_RANGE 而不是 RESUME_FROM，服务器回 200 时由写回调重新开始而不是报错
+        curl_easy_setopt(handle,CURLOPT_RANGE,(std::to_string(resumeOffset)+"-").c_str());
+        // 资源变了服务器会回 200 完整内容，而不是把新旧数据拼在一起
+        requestHeaders=curl_slist_append(requestHeaders,("If-Range: "+GetValidator()).c_str());
+        curl_easy_setopt(handle,CURLOPT_HTTPHEADER,requestHeaders);
+    }
+}
+
+void PartialDownload::Detach() {
+    if(handle) {
+        curl_easy_setopt(handle,CURLOPT_HEADERFUNCTION,nullptr);
+        curl_easy_setopt(handle,CURLOPT_HEADERDATA,nullptr);
+        curl_easy_setopt(handle,CURLOPT_RANGE,nullptr);
+        curl_easy_setopt(handle,CURLOPT_HTTPHEADER,nullptr);
+        handle=nullptr;
+    }
+    if(requestHeaders) {
+        curl_slist_free_all(requestHeaders);
+        requestHeaders=nullptr;
+    }
+}
+
+bool PartialDownload::Complete(CURLcode code,const std::string& expectedHash,std::string& digest,std::string& error) {
+    digest.clear();
+    error.clear();
+
+    if(handle) {
+        curl_easy_getinfo(handle,CURLINFO_RESPONSE_CODE,&httpStatus);
+    }
+    Detach();
+
+    bool closeFailed=false;
+    if(file) {
+        closeFailed=fclose(file)!=0;
+        file=nullptr;
+    }
+
+    std::error_code ec;
+    bool complete=code==CURLE_OK&&!writeFailed&&!closeFailed&&httpStatus>=200&&httpStatus<300;
+    // .part 已是完整内容时续传请求得到 416，大小对得上（大小未知时靠哈希）就直接校验并提升
+    if(!complete&&code==CURLE_OK&&!closeFailed&&httpStatus==416&&resumeOffset>0&&receivedBytes==0) {
+        long long fullSize=rangeTotal>=0?rangeTotal:expectedSize;
+        if(fullSize>0?fullSize==resumeOffset:!expectedHash.empty()) {
+            LOG_INFO<<".part 已包含完整内容: "<<outputPath<<std::endl;
+            complete=true;
+        }
+    }
+    if(complete) {
+        if(hasher) {
+            digest=hasher->Final();
+        }
+        // 没有摘要就无法校验，不能当作通过
+        if(!expectedHash.empty()&&digest!=expectedHash) {
+            error=digest.empty()?"hash unavailable":"hash mismatch";
+            Discard(outputPath);
+            return false;
+        }
+
+        std::filesystem::rename(partPath,outputPath,ec);
+        if(ec) {
+            error="rename failed: "+ec.message();
+            Discard(outputPath);
+            return false;
+        }
+        std::filesystem::remove(statePath,ec);
+        return true;
+    }
+
+    if(restartRequired) {
+        error="unexpected Content-Range";
+    }
+    else if(code!=CURLE_OK) {
+        error=curl_easy_strerror(code);
+    }
+    else if(writeFailed||closeFailed) {
+        error="write failed";
+    }
+    else {
+        error="HTTP "+std::to_string(httpStatus);
+    }
+
+    // 只有拿到校验器且是传输中断时才保留 .part，下次带 If-Range 续传
+    std::error_code sizeEc;
+    long long partSize=static_cast<long long>(std::filesystem::file_size(partPath,sizeEc));
+    resumable=code!=CURLE_OK&&!writeFailed&&!restartRequired&&httpStatus<400&&
+        !GetValidator().empty()&&!sizeEc&&partSize>0;
+    if(!resumable) {
+        Discard(outputPath);
+    }
+    return false;
+}
+
+void PartialDownload::Discard(const std::string& outputPath) {
+    std::error_code ec;
+    std::filesystem::remove(outputPath+".part",ec);
+    std::filesystem::remove(outputPath+".part.json",ec);
+}
+
+bool PartialDownload::LoadState() {
+    std::ifstream stateFile(statePath,std::ios::binary);
+    if(!stateFile.is_open()) {
+        return false;
+    }
+
+    Json::CharReaderBuilder reader;
+    Json::Value root;
+    std::string errors;
+    if(!Json::parseFromStream(reader,stateFile,&root,&errors)) {
+        return false;
+    }
+    if(root["url"].asString()!=url) {
+        return false;
+    }
+
+    etag=root["etag"].asString();
+    lastModified=root["last_modified"].asString();
+    return !GetValidator().empty();
+}
+
+void PartialDownload::SaveState() {
+    Json::Value root;
+    root["url"]=url;
+    root["etag"]=etag;
+    root["last_modified"]=lastModified;
+
+    std::ofstream stateFile(statePath,std::ios::binary|std::ios::trunc);
+    if(!stateFile.is_open()) {
+        return;
+    }
+    Json::StreamWriterBuilder writer;
+    writer["indentation"]="";
+    stateFile<<Json::writeString(writer,root);
+}
+
+bool PartialDownload::ReopenForFullDownload() {
+    if(file) {
+        fclose(file);
+        file=nullptr;
+    }
+    errno_t err=fopen_s(&file,partPath.c_str(),"wb");
+    if(err!=0||!file) {
+        file=nullptr;
+        return false;
+    }
+    if(hasher) {
+        hasher=std::make_unique<FileHasher::StreamHasher>(algorithm);
+    }
+    resumeOffset=0;
+    return true;
+}
+
+const std::string& PartialDownload::GetValidator() const {
+    // 弱 ETag 不能用于 If-Range，退回 Last-Modified
+    if(!etag.empty()&&etag.compare(0,2,"W/")!=0) {
+        return etag;
+    }
+    return lastModified;
+}
+
+size_t PartialDownload::WriteCallback(void* contents,size_t size,size_t nmemb,PartialDownload* download) {
+    size_t totalSize=size*nmemb;
+
+    if(!download->bodyStarted) {
+        download->bodyStarted=true;
+        long status=0;
+        curl_easy_getinfo(download->handle,CURLINFO_RESPONSE_CODE,&status);
+        if(download->resumeOffset>0&&status!=206&&status<400) {
+            LOG_INFO<<"服务器未接受续传 (HTTP "<<status<<")，重新下载: "<<download->outputPath<<std::endl;
+            if(!download->ReopenForFullDownload()) {
+                download->writeFailed=true;
+                return 0;
+            }
+        }
+        // 起点不对的 206 接到 .part 后面会拼出错误的文件
+        if(download->resumeOffset>0&&status==206&&download->rangeStart!=download->resumeOffset) {
+            LOG_WARN<<"续传响应的起始位置 "<<download->rangeStart<<" 与已下载的 "<<download->resumeOffset
+                <<" 字节不符，重新下载: "<<download->outputPath<<std::endl;
+            download->restartRequired=true;
+            return 0;
+        }
+        if(status>=200&&status<300&&
+            (!download->responseEtag.empty()||!download->responseLastModified.empty())) {
+            download->etag=download->responseEtag;
+            download->lastModified=download->responseLastModified;
+            if(!download->GetValidator().empty()) {
+                download->SaveState();
+            }
+        }
+        download->httpStatus=status;
+    }
+
+    // 错误页不写入 .part
+    if(download->httpStatus>=400) {
+        return totalSize;
+    }
+
+    size_t written=fwrite(contents,1,totalSize,download->file);
+    if(written!=totalSize) {
+        download->writeFailed=true;
+        return written;
+    }
+    if(download->hasher) {
+        download->hasher->Update(contents,totalSize);
+    }
+    download->receivedBytes+=totalSize;
+    return totalSize;
+}
+
+size_t PartialDownload::HeaderCallback(char* buffer,size_t size,size_t nitems,PartialDownload* download) {
+    size_t length=size*nitems;
+
+    // 跟随重定向时每个响应都会重新开始一组头
+    if(length>=5&&strncmp(buffer,"HTTP/",5)==0) {
+        download->responseEtag.clear();
+        download->responseLastModified.clear();
+        download->rangeStart=-1;
+        download->rangeTotal=-1;
+    }
+    else if(HeaderNameEquals(buffer,length,"etag")) {
+        download->responseEtag=TrimHeaderValue(buffer+5,buffer+length);
+    }
+    else if(HeaderNameEquals(buffer,length,"last-modified")) {
+        download->responseLastModified=TrimHeaderValue(buffer+14,buffer+length);
+    }
+    else if(HeaderNameEquals(buffer,length,"content-range")) {
+        ParseContentRange(TrimHeaderValue(buffer+14,buffer+length),download->rangeStart,download->rangeTotal);
+    }
+    return length;
+}
\ No newline at end of file
@@ -0,0 +1,323 @@
+﻿#include "SegmentedDownload.h"
+#include "HttpClient.h"
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include "Logger.h"
+
+namespace {
+    const int MAX_SEGMENTS=16;
+    const int POLL_TIMEOUT_MS=100;
+    const long long PROGRESS_INTERVAL_MS=100;
+}
+
+SegmentedDownload::SegmentedDownload(const std::string& url,const std::string& outputPath,CURLSH* share,const Options& options)
+    : url(url),
+    outputPath(outputPath),
+    tempPath(outputPath+".seg"),
+    share(share),
+    options(options),
+    requestHeaders(nullptr),
+    totalSize(0),
+    fileHandle(INVALID_HANDLE_VALUE),
+    rangeIgnored(false),
+    writeFailed(false) {
+}
+
+SegmentedDownload::~SegmentedDownload() {
+    for(auto& segment:segments) {
+        if(segment.easy) {
+            curl_easy_cleanup(segment.easy);
+        }
+    }
+    if(requestHeaders) {
+        curl_slist_free_all(requestHeaders);
+    }
+    CloseFile();
+}
+
+SegmentedDownload::Outcome SegmentedDownload::Run(ProgressCallback progressCallback) {
+    if(options.segmentCount<2||!Probe()) {
+        return Outcome::Unsupported;
+    }
+
+    long long minSegment=std::max(options.minSegmentSize,1LL);
+    int count=static_cast<int>(std::min<long long>(std::min(options.segmentCount,MAX_SEGMENTS),totalSize/minSegment));
+    if(count<2) {
+        return Outcome::Unsupported;
+    }
+
+    if(!Preallocate()) {
+        return Outcome::Failed;
+    }
+
+    // 下载途中资源若被替换，If-Range 会让服务器回 200，从而退回单连接下载
+    if(!validator.empty()) {
+        requestHeaders=curl_slist_append(requestHeaders,("If-Range: "+validator).c_str());
+    }
+
+    long long segmentSize=(totalSize+count-1)/count;
+    segments.resize(count);
+    for(int i=0; i<count; i++) {
+        segments[i].owner=this;
+        segments[i].start=i*segmentSize;
+        segments[i].end=std::min(totalSize,(i+1)*segmentSize)-1;
+    }
+
+    LOG_INFO<<"分段下载: "<<count<<" 段, 每段约 "<<segmentSize<<" 字节"<<std::endl;
+
+    CURLM* multi=curl_multi_init();
+    if(!multi) {
+        CloseFile();
+        return Outcome::Failed;
+    }
+
+    bool failed=false;
+    int active=0;
+    for(auto& segment:segments) {
+        if(!StartSegment(segment,multi)) {
+            failed=true;
+            break;
+        }
+        active++;
+    }
+
+    auto lastProgress=std::chrono::steady_clock::now();
+    while(!failed&&active>0) {
+        int running=0;
+        if(curl_multi_perform(multi,&running)!=CURLM_OK) {
+            failed=true;
+            break;
+        }
+
+        int queued=0;
+        while(CURLMsg* message=curl_multi_info_read(multi,&queued)) {
+            if(message->msg!=CURLMSG_DONE) {
+                continue;
+            }
+            auto it=std::find_if(segments.begin(),segments.end(),
+                [message](const Segment& segment) { return segment.easy==message->easy_handle; });
+            if(it==segments.end()) {
+                continue;
+            }
+
+            Segment& segment=*it;
+            CURLcode code=message->data.result;
+            curl_multi_remove_handle(multi,segment.easy);
+            active--;
+
+            if(rangeIgnored||writeFailed) {
+                failed=true;
+                break;
+            }
+
+            long status=0;
+            curl_easy_getinfo(segment.easy,CURLINFO_RESPONSE_CODE,&status);
+            bool complete=segment.start+segment.written>segment.end;
+            if(code==CURLE_OK&&status==206&&complete) {
+                continue;
+            }
+
+            // 单段失败只重试该段剩余部分
+            if(segment.attempts<options.maxAttempts&&(status<400||status>=500)) {
+                LOG_WARN<<"分段 "<<(it-segments.begin())<<" 下载中断 ("<<curl_easy_strerror(code)
+                    <<")，从 "<<segment.start+segment.written<<" 继续"<<std::endl;
+                if(StartSegment(segment,multi)) {
+                    active++;
+                    continue;
+                }
+            }
+            failed=true;
+            break;
+        }
+
+        if(progressCallback) {
+            auto now=std::chrono::steady_clock::now();
+            if(std::chrono::duration_cast<std::chrono::milliseconds>(now-lastProgress).count()>=PROGRESS_INTERVAL_MS) {
+                lastProgress=now;
+                long long downloaded=0;
+                for(const auto& segment:segments) {
+                    downloaded+=segment.written;
+                }
+                progressCallback(downloaded,totalSize);
+            }
+        }
+
+        if(running>0) {
+            curl_multi_poll(multi,nullptr,0,POLL_TIMEOUT_MS,nullptr);
+        }
+    }
+
+    for(auto& segment:segments) {
+        if(segment.easy) {
+            curl_multi_remove_handle(multi,segment.easy);
+        }
+    }
+    curl_multi_cleanup(multi);
+    CloseFile();
+
+    std::error_code ec;
+    if(failed) {
+        std::filesystem::remove(tempPath,ec);
+        if(rangeIgnored) {
+            LOG_INFO<<"服务器未按范围返回数据，改用单连接下载"<<std::endl;
+            return Outcome::Unsupported;
+        }
+        LOG_WARN<<"分段下载失败: "<<url<<std::endl;
+        return Outcome::Failed;
+    }
+
+    if(progressCallback) {
+        progressCallback(totalSize,totalSize);
+    }
+
+    std::filesystem::rename(tempPath,outputPath,ec);
+    if(ec) {
+        LOG_ERROR<<"替换文件失败: "<<ec.message()<<std::endl;
+        std::filesystem::remove(tempPath,ec);
+        return Outcome::Failed;
+    }
+    return Outcome::Completed;
+}
+
+bool SegmentedDownload::Probe() {
+    CURL* easy=CreateHandle();
+    if(!easy) {
+        return false;
+    }
+
+    // 只取第一个字节，从 Content-Range 得到总大小并确认支持范围请求
+    curl_easy_setopt(easy,CURLOPT_RANGE,"0-0");
+    curl_easy_setopt(easy,CURLOPT_WRITEFUNCTION,DiscardCallback);
+    CURLcode res=curl_easy_perform(easy);
+
+    long status=0;
+    curl_easy_getinfo(easy,CURLINFO_RESPONSE_CODE,&status);
+
+    bool supported=false;
+    curl_header* header=nullptr;
+    if(res==CURLE_OK&&status==206&&
+        curl_easy_header(easy,"Content-Range",0,CURLH_HEADER,-1,&header)==CURLHE_OK) {
+        const char* slash=strchr(header->value,'/');
+        if(slash&&slash[1]!='*') {
+            totalSize=std::strtoll(slash+1,nullptr,10);
+            supported=totalSize>0;
+        }
+    }
+
+    if(supported) {
+        if(curl_easy_header(easy,"ETag",0,CURLH_HEADER,-1,&header)==CURLHE_OK&&strncmp(header->value,"W/",2)!=0) {
+            validator=header->value;
+        }
+        else if(curl_easy_header(easy,"Last-Modified",0,CURLH_HEADER,-1,&header)==CURLHE_OK) {
+            validator=header->value;
+        }
+    }
+
+    curl_easy_cleanup(easy);
+    return supported;
+}
+
+bool SegmentedDownload::Preallocate() {
+    std::wstring widePath=std::filesystem::path(tempPath).wstring();
+    fileHandle=CreateFileW(widePath.c_str(),GENERIC_WRITE,0,NULL,CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL,NULL);
+    if(fileHandle==INVALID_HANDLE_VALUE) {
+        LOG_ERROR<<"无法创建文件: "<<tempPath<<std::endl;
+        return false;
+    }
+
+    // 一次性分配完整大小，各段按偏移直接写入
+    LARGE_INTEGER size;
+    size.QuadPart=totalSize;
+    if(!SetFilePointerEx(fileHandle,size,NULL,FILE_BEGIN)||!SetEndOfFile(fileHandle)) {
+        LOG_ERROR<<"预分配文件失败: "<<tempPath<<std::endl;
+        CloseFile();
+        std::error_code ec;
+        std::filesystem::remove(tempPath,ec);
+        return false;
+    }
+    return true;
+}
+
+bool SegmentedDownload::StartSegment(Segment& segment,CURLM* multi) {
+    if(!segment.easy) {
+        segment.easy=CreateHandle();
+        if(!segment.easy) {
+            return false;
+        }
+    }
+    segment.attempts++;
+    segment.statusChecked=false;
+
+    std::string range=std::to_string(segment.start+segment.written)+"-"+std::to_string(segment.end);
+    curl_easy_setopt(segment.easy,CURLOPT_RANGE,range.c_str());
+    curl_easy_setopt(segment.easy,CURLOPT_WRITEFUNCTION,WriteCallback);
+    curl_easy_setopt(segment.easy,CURLOPT_WRITEDATA,&segment);
+    curl_easy_setopt(segment.easy,CURLOPT_HTTPHEADER,requestHeaders);
+    return curl_multi_add_handle(multi,segment.easy)==CURLM_OK;
+}
+
+CURL* SegmentedDownload::CreateHandle() {
+    CURL* easy=curl_easy_init();
+    if(!easy) {
+        return nullptr;
+    }
+    curl_easy_setopt(easy,CURLOPT_URL,url.c_str());
+    curl_easy_setopt(easy,CURLOPT_USERAGENT,"MinecraftUpdater/1.0");
+    curl_easy_setopt(easy,CURLOPT_FOLLOWLOCATION,1L);
+    curl_easy_setopt(easy,CURLOPT_CONNECTTIMEOUT,10L);
+    curl_easy_setopt(easy,CURLOPT_LOW_SPEED_LIMIT,1024L);
+    curl_easy_setopt(easy,CURLOPT_LOW_SPEED_TIME,30L);
+    curl_easy_setopt(easy,CURLOPT_TIMEOUT,options.timeoutSeconds);
+    curl_easy_setopt(easy,CURLOPT_NOPROGRESS,1L);
+    HttpClient::ApplySharedOptions(easy,share);
+    // 分段需要各自的连接才能并行，不等待 HTTP/2 复用
+    curl_easy_setopt(easy,CURLOPT_PIPEWAIT,0L);
+    return easy;
+}
+
+void SegmentedDownload::CloseFile() {
+    if(fileHandle!=INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+        fileHandle=INVALID_HANDLE_VALUE;
+    }
+}
+
+size_t SegmentedDownload::DiscardCallback(void* /*contents*/,size_t size,size_t nmemb,void* /*userdata*/) {
+    return size*nmemb;
+}
+
+size_t SegmentedDownload::WriteCallback(void* contents,size_t size,size_t nmemb,Segment* segment) {
+    size_t totalSize=size*nmemb;
+    SegmentedDownload* owner=segment->owner;
+
+    if(!segment->statusChecked) {
+        segment->statusChecked=true;
+        long status=0;
+        curl_easy_getinfo(segment->easy,CURLINFO_RESPONSE_CODE,&status);
+        if(status==200) {
+            owner->rangeIgnored=true;
+            return 0;
+        }
+        if(status!=206) {
+            return 0;
+        }
+    }
+
+    long long offset=segment->start+segment->written;
+    if(offset+static_cast<long long>(totalSize)>segment->end+1) {
+        owner->writeFailed=true;
+        return 0;
+    }
+
+    OVERLAPPED overlapped={};
+    overlapped.Offset=static_cast<DWORD>(offset&0xFFFFFFFF);
+    overlapped.OffsetHigh=static_cast<DWORD>(offset>>32);
+    DWORD written=0;
+    if(!WriteFile(owner->fileHandle,contents,static_cast<DWORD>(totalSize),&written,&overlapped)||written!=totalSize) {
+        owner->writeFailed=true;
+        return 0;
+    }
+    segment->written+=totalSize;
+    return totalSize;
+}
\ No newline at end of file
@@ -0,0 +1,418 @@
+﻿#include "StreamingZipReader.h"
+#include <algorithm>
+#include <cstring>
+#include "Logger.h"
+
+namespace {
+    const uint32_t LOCAL_HEADER_SIGNATURE=0x04034b50;
+    const uint32_t DATA_DESCRIPTOR_SIGNATURE=0x08074b50;
+    const uint32_t CENTRAL_HEADER_SIGNATURE=0x02014b50;
+    const uint32_t ZIP64_END_SIGNATURE=0x06064b50;
+    const uint32_t ZIP64_LOCATOR_SIGNATURE=0x07064b50;
+    const uint32_t END_SIGNATURE=0x06054b50;
+    const uint16_t METHOD_STORED=0;
+    const uint16_t METHOD_DEFLATE=8;
+    const uint16_t FLAG_ENCRYPTED=0x0001;
+    const uint16_t FLAG_DATA_DESCRIPTOR=0x0008;
+    const uint16_t FLAG_UTF8_NAME=0x0800;
+    const uint32_t ZIP64_MARKER=0xFFFFFFFF;
+    const size_t BUFFER_SIZE=65536;
+
+    uint16_t ReadLE16(const unsigned char* p) {
+        return static_cast<uint16_t>(p[0]|(p[1]<<8));
+    }
+
+    uint32_t ReadLE32(const unsigned char* p) {
+        return static_cast<uint32_t>(p[0])|(static_cast<uint32_t>(p[1])<<8)|
+            (static_cast<uint32_t>(p[2])<<16)|(static_cast<uint32_t>(p[3])<<24);
+    }
+
+    uint64_t ReadLE64(const unsigned char* p) {
+        return static_cast<uint64_t>(ReadLE32(p))|(static_cast<uint64_t>(ReadLE32(p+4))<<32);
+    }
+}
+
+StreamPipe::StreamPipe(size_t capacity)
+    : ring(capacity),
+    head(0),
+    count(0),
+    closed(false),
+    abandoned(false) {
+}
+
+void StreamPipe::Write(const unsigned char* data,size_t size) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(size>0) {
+        writable.wait(lock,[this]() { return abandoned||count<ring.size(); });
+        if(abandoned) {
+            return;
+        }
+        size_t tail=(head+count)%ring.size();
+        size_t chunk=(std::min)(size,(std::min)(ring.size()-count,ring.size()-tail));
+        memcpy(ring.data()+tail,data,chunk);
+        count+=chunk;
+        data+=chunk;
+        size-=chunk;
+        readable.notify_one();
+    }
+}
+
+void StreamPipe::Close(bool success) {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed=true;
+    // 下载失败时丢弃未读数据，消费者会当作流意外结束
+    if(!success) {
+        count=0;
+    }
+    readable.notify_all();
+}
+
+size_t StreamPipe::Read(unsigned char* buffer,size_t size) {
+    std::unique_lock<std::mutex> lock(mutex);
+    readable.wait(lock,[this]() { return closed||count>0; });
+    size_t chunk=(std::min)(size,(std::min)(count,ring.size()-head));
+    memcpy(buffer,ring.data()+head,chunk);
+    head=(head+chunk)%ring.size();
+    count-=chunk;
+    writable.notify_one();
+    return chunk;
+}
+
+void StreamPipe::Abandon() {
+    std::lock_guard<std::mutex> lock(mutex);
+    abandoned=true;
+    count=0;
+    writable.notify_all();
+}
+
+StreamingZipReader::StreamingZipReader(ReadFunction read)
+    : read(std::move(read)),
+    input(BUFFER_SIZE),
+    output(BUFFER_SIZE),
+    inputPos(0),
+    inputEnd(0),
+    streamOffset(0),
+    inflaterReady(false) {
+    memset(&inflater,0,sizeof(inflater));
+}
+
+StreamingZipReader::~StreamingZipReader() {
+    if(inflaterReady) {
+        inflateEnd(&inflater);
+    }
+}
+
+bool StreamingZipReader::Fail(const std::string& message) {
+    if(error.empty()) {
+        error=message;
+    }
+    return false;
+}
+
+bool StreamingZipReader::FillInput() {
+    if(inputPos<inputEnd) {
+        return true;
+    }
+    inputPos=0;
+    inputEnd=read(input.data(),input.size());
+    return inputEnd>0;
+}
+
+void StreamingZipReader::Advance(size_t size) {
+    inputPos+=size;
+    streamOffset+=size;
+}
+
+bool StreamingZipReader::ReadBytes(unsigned char* buffer,size_t size) {
+    while(size>0) {
+        if(!FillInput()) {
+            return Fail("数据意外结束");
+        }
+        size_t chunk=(std::min)(size,inputEnd-inputPos);
+        memcpy(buffer,input.data()+inputPos,chunk);
+        Advance(chunk);
+        buffer+=chunk;
+        size-=chunk;
+    }
+    return true;
+}
+
+bool StreamingZipReader::ReadString(std::string& value,size_t size) {
+    value.resize(size);
+    return size==0||ReadBytes(reinterpret_cast<unsigned char*>(&value[0]),size);
+}
+
+bool StreamingZipReader::SkipBytes(uint64_t size) {
+    while(size>0) {
+        if(!FillInput()) {
+            return Fail("数据意外结束");
+        }
+        size_t chunk=static_cast<size_t>((std::min)(size,static_cast<uint64_t>(inputEnd-inputPos)));
+        Advance(chunk);
+        size-=chunk;
+    }
+    return true;
+}
+
+bool StreamingZipReader::ApplyZip64Extra(const std::string& extra,uint64_t& uncompressedSize,
+    uint64_t& compressedSize,uint64_t* headerOffset) {
+    const unsigned char* data=reinterpret_cast<const unsigned char*>(extra.data());
+    size_t pos=0;
+    while(pos+4<=extra.size()) {
+        uint16_t id=ReadLE16(data+pos);
+        uint16_t size=ReadLE16(data+pos+2);
+        pos+=4;
+        if(pos+size>extra.size()) {
+            break;
+        }
+        if(id==0x0001) {
+            // 只有对应字段为 0xFFFFFFFF 时才出现在扩展字段中，顺序固定
+            size_t field=pos;
+            size_t end=pos+size;
+            if(uncompressedSize==ZIP64_MARKER&&field+8<=end) {
+                uncompressedSize=ReadLE64(data+field);
+                field+=8;
+            }
+            if(compressedSize==ZIP64_MARKER&&field+8<=end) {
+                compressedSize=ReadLE64(data+field);
+                field+=8;
+            }
+            if(headerOffset&&*headerOffset==ZIP64_MARKER&&field+8<=end) {
+                *headerOffset=ReadLE64(data+field);
+            }
+            return true;
+        }
+        pos+=size;
+    }
+    return false;
+}
+
+StreamingZipReader::Result StreamingZipReader::Next(Entry& entry) {
+    uint64_t headerOffset=streamOffset;
+    unsigned char signatureBytes[4];
+    if(!ReadBytes(signatureBytes,sizeof(signatureBytes))) {
+        return Result::Failed;
+    }
+    uint32_t signature=ReadLE32(signatureBytes);
+    if(signature!=LOCAL_HEADER_SIGNATURE) {
+        if(signature==CENTRAL_HEADER_SIGNATURE||signature==END_SIGNATURE||signature==ZIP64_END_SIGNATURE) {
+            return ReadCentralDirectory(signature)?Result::End:Result::Failed;
+        }
+        Fail("无效的ZIP签名");
+        return Result::Failed;
+    }
+
+    unsigned char header[26];
+    if(!ReadBytes(header,sizeof(header))) {
+        return Result::Failed;
+    }
+    entry=Entry();
+    entry.flags=ReadLE16(header+2);
+    entry.method=ReadLE16(header+4);
+    entry.crc=ReadLE32(header+10);
+    entry.compressedSize=ReadLE32(header+14);
+    entry.uncompressedSize=ReadLE32(header+18);
+    entry.headerOffset=headerOffset;
+    std::string extra;
+    if(!ReadString(entry.name,ReadLE16(header+22))||!ReadString(extra,ReadLE16(header+24))) {
+        return Result::Failed;
+    }
+    entry.zip64=ApplyZip64Extra(extra,entry.uncompressedSize,entry.compressedSize,nullptr);
+    entry.hasDataDescriptor=(entry.flags&FLAG_DATA_DESCRIPTOR)!=0;
+    entry.isDirectory=!entry.name.empty()&&(entry.name.back()=='/'||entry.name.back()=='\\');
+    entry.legacyName=!(entry.flags&FLAG_UTF8_NAME)&&std::any_of(entry.name.begin(),entry.name.end(),[](char c) {
+        return static_cast<unsigned char>(c)>=0x80;
+        });
+
+    if(entry.flags&FLAG_ENCRYPTED) {
+        Fail("不支持加密条目: "+entry.name);
+        return Result::Failed;
+    }
+    if(entry.method!=METHOD_STORED&&entry.method!=METHOD_DEFLATE) {
+        Fail("不支持的压缩方式 "+std::to_string(entry.method)+": "+entry.name);
+        return Result::Failed;
+    }
+    if(entry.method==METHOD_STORED&&entry.hasDataDescriptor) {
+        Fail("stored 条目长度未知，无法流式读取: "+entry.name);
+        return Result::Failed;
+    }
+    if(!entryByOffset.emplace(headerOffset,entries.size()).second) {
+        Fail("重复的本地文件头: "+entry.name);
+        return Result::Failed;
+    }
+    entries.push_back(entry);
+    return Result::Entry;
+}
+
+bool StreamingZipReader::ReadEntryData(const WriteFunction& write) {
+    if(entries.empty()) {
+        return Fail("没有待读取的条目");
+    }
+    Entry& entry=entries.back();
+    uLong crc=crc32(0,nullptr,0);
+    uint64_t compressedSize=0;
+    uint64_t uncompressedSize=0;
+
+    if(entry.method==METHOD_STORED) {
+        uint64_t remaining=entry.compressedSize;
+        while(remaining>0) {
+            if(!FillInput()) {
+                return Fail("条目数据意外结束: "+entry.name);
+            }
+            size_t chunk=static_cast<size_t>((std::min)(remaining,static_cast<uint64_t>(inputEnd-inputPos)));
+            const unsigned char* data=input.data()+inputPos;
+            crc=crc32(crc,data,static_cast<uInt>(chunk));
+            write(data,chunk);
+            Advance(chunk);
+            remaining-=chunk;
+        }
+        compressedSize=entry.compressedSize;
+        uncompressedSize=entry.compressedSize;
+    }
+    else {
+        if(!inflaterReady) {
+            if(inflateInit2(&inflater,-MAX_WBITS)!=Z_OK) {
+                return Fail("无法初始化解压器");
+            }
+            inflaterReady=true;
+        }
+        else {
+            inflateReset(&inflater);
+        }
+
+        // deflate 流自带结束标记，带数据描述符的条目也能确定数据边界
+        int ret=Z_OK;
+        while(ret!=Z_STREAM_END) {
+            if(!FillInput()) {
+                return Fail("条目数据意外结束: "+entry.name);
+            }
+            size_t available=inputEnd-inputPos;
+            inflater.next_in=input.data()+inputPos;
+            inflater.avail_in=static_cast<uInt>(available);
+            inflater.next_out=output.data();
+            inflater.avail_out=static_cast<uInt>(output.size());
+            ret=inflate(&inflater,Z_NO_FLUSH);
+            if(ret!=Z_OK&&ret!=Z_STREAM_END) {
+                return Fail("条目数据已损坏: "+entry.name);
+            }
+            size_t used=available-inflater.avail_in;
+            Advance(used);
+            compressedSize+=used;
+            size_t produced=output.size()-inflater.avail_out;
+            if(produced>0) {
+                crc=crc32(crc,output.data(),static_cast<uInt>(produced));
+                write(output.data(),produced);
+                uncompressedSize+=produced;
+            }
+        }
+    }
+
+    if(entry.hasDataDescriptor&&!ReadDataDescriptor(entry)) {
+        return false;
+    }
+    if(compressedSize!=entry.compressedSize||uncompressedSize!=entry.uncompressedSize) {
+        return Fail("条目大小不符: "+entry.name);
+    }
+    if(crc!=entry.crc) {
+        return Fail("CRC 校验失败: "+entry.name);
+    }
+    return true;
+}
+
+bool StreamingZipReader::ReadDataDescriptor(Entry& entry) {
+    // 描述符签名可选；zip64 条目的大小字段为 8 字节
+    unsigned char descriptor[24];
+    if(!ReadBytes(descriptor,4)) {
+        return false;
+    }
+    size_t sizeField=entry.zip64?8:4;
+    size_t offset=ReadLE32(descriptor)==DATA_DESCRIPTOR_SIGNATURE?4:0;
+    size_t length=offset+4+sizeField*2;
+    if(!ReadBytes(descriptor+4,length-4)) {
+        return false;
+    }
+    entry.crc=ReadLE32(descriptor+offset);
+    if(entry.zip64) {
+        entry.compressedSize=ReadLE64(descriptor+offset+4);
+        entry.uncompressedSize=ReadLE64(descriptor+offset+12);
+    }
+    else {
+        entry.compressedSize=ReadLE32(descriptor+offset+4);
+        entry.uncompressedSize=ReadLE32(descriptor+offset+8);
+    }
+    return true;
+}
+
+bool StreamingZipReader::ReadCentralDirectory(uint32_t signature) {
+    std::vector<bool> seen(entries.size(),false);
+    size_t centralCount=0;
+    unsigned char signatureBytes[4];
+
+    while(signature==CENTRAL_HEADER_SIGNATURE) {
+        unsigned char header[42];
+        if(!ReadBytes(header,sizeof(header))) {
+            return false;
+        }
+        uint32_t crc=ReadLE32(header+12);
+        uint64_t compressedSize=ReadLE32(header+16);
+        uint64_t uncompressedSize=ReadLE32(header+20);
+        uint64_t headerOffset=ReadLE32(header+38);
+        std::string name;
+        std::string extra;
+        if(!ReadString(name,ReadLE16(header+24))||!ReadString(extra,ReadLE16(header+26))||
+            !SkipBytes(ReadLE16(header+28))) {
+            return false;
+        }
+        ApplyZip64Extra(extra,uncompressedSize,compressedSize,&headerOffset);
+
+        // 中央目录是权威索引：每条记录都必须对应一个已读取且内容一致的本地条目
+        auto it=entryByOffset.find(headerOffset);
+        if(it==entryByOffset.end()||seen[it->second]) {
+            return Fail("中央目录条目没有对应的本地文件头: "+name);
+        }
+        const Entry& entry=entries[it->second];
+        if(entry.name!=name||entry.crc!=crc||entry.compressedSize!=compressedSize||
+            entry.uncompressedSize!=uncompressedSize) {
+            return Fail("中央目录与本地文件头不一致: "+name);
+        }
+        seen[it->second]=true;
+        centralCount++;
+
+        if(!ReadBytes(signatureBytes,sizeof(signatureBytes))) {
+            return false;
+        }
+        signature=ReadLE32(signatureBytes);
+    }
+
+    if(centralCount!=entries.size()) {
+        return Fail("中央目录缺少 "+std::to_string(entries.size()-centralCount)+" 个条目");
+    }
+
+    if(signature==ZIP64_END_SIGNATURE) {
+        unsigned char recordSize[8];
+        if(!ReadBytes(recordSize,sizeof(recordSize))||!SkipBytes(ReadLE64(recordSize))||
+            !ReadBytes(signatureBytes,sizeof(signatureBytes))) {
+            return false;
+        }
+        signature=ReadLE32(signatureBytes);
+    }
+    if(signature==ZIP64_LOCATOR_SIGNATURE) {
+        if(!SkipBytes(16)||!ReadBytes(signatureBytes,sizeof(signatureBytes))) {
+            return false;
+        }
+        signature=ReadLE32(signatureBytes);
+    }
+    if(signature!=END_SIGNATURE) {
+        return Fail("缺少中央目录结束记录");
+    }
+
+    unsigned char endRecord[18];
+    if(!ReadBytes(endRecord,sizeof(endRecord))) {
+        return false;
+    }
+    uint16_t totalEntries=ReadLE16(endRecord+6);
+    if(totalEntries!=0xFFFF&&totalEntries!=(entries.size()&0xFFFF)) {
+        return Fail("中央目录结束记录的条目数不符");
+    }
+    return true;
+}
\ No newline at end of file
@@ -1,78 +1,167 @@
 ﻿#include "UpdateChecker.h"
 #include <iostream>
-#include <sstream>
-
-UpdateChecker::UpdateChecker(const std::string& url,HttpClient& http,ConfigManager& config,bool apiCache)
-    : updateUrl(url),httpClient(http),configManager(config),enableApiCache(apiCache) {
+#include <memory>
+#include <filesystem>
+
+UpdateChecker::UpdateChecker(const std::string& url,HttpClient& http,ConfigManager& config,bool apiCache,
+    const std::string& manifestCachePath)
+    : updateUrl(url),httpClient(http),configManager(config),enableApiCache(apiCache),manifestCache(manifestCachePath) {
+    manifestCache.SetEnabled(!manifestCachePath.empty()&&configManager.ReadEnableManifestCache());
+    if(!manifestCachePath.empty()) {
+        binaryManifestPath=std::filesystem::path(manifestCachePath).replace_extension(".bin").string();
+    }
 }
 
 bool UpdateChecker::CheckForUpdates() {
-    Json::Value updateInfo=FetchUpdateInfo();
-    if(updateInfo.isNull()) {
+    ManifestParser parser;
+    if(!FetchUpdateInfo(parser)) {
         return false;
     }
+    const Json::Value& updateInfo=parser.GetHeader();
 
     std::string localVersion=configManager.ReadVersion();
     std::string remoteVersion=updateInfo["version"].asString();
 
-    g_logger<<"[INFO] 本地游戏版本: "<<localVersion<<std::endl;
-    g_logger<<"[INFO] 远程游戏版本: "<<remoteVersion<<std::endl;
+    LOG_INFO<<"本地游戏版本: "<<localVersion<<std::endl;
+    LOG_INFO<<"远程游戏版本: "<<remoteVersion<<std::endl;
 
     if(remoteVersion>localVersion) {
-        g_logger<<"[INFO] 发现新版本: "<<remoteVersion<<std::endl;
+        LOG_INFO<<"发现新版本: "<<remoteVersion<<std::endl;
         DisplayChangelog(updateInfo["changelog"]);
         return true;
     }
     else {
-        g_logger<<"[INFO] 当前已是最新版本"<<std::endl;
+        LOG_INFO<<"当前已是最新版本"<<std::endl;
         return false;
     }
 }
 
-Json::Value UpdateChecker::FetchUpdateInfo() {
-    g_logger<<"[INFO]正在从服务器获取更新信息: "<<updateUrl<<std::endl;
-    g_logger<<"[DEBUG]当前缓存状态: "<<(enableApiCache?"启用API缓存":"禁用API缓存")<<std::endl;
-
-    Json::CharReaderBuilder reader;
-    reader.settings_["maxDocumentSize"]=10*1024*1024;
-    reader.settings_["maxDepth"]=100;
-
-    std::string jsonResponse=httpClient.Get(updateUrl);
-    if(jsonResponse.empty()) {
-        g_logger<<"[ERROR]错误: 获取更新信息返回为空"<<std::endl;
-        return Json::Value();
+bool UpdateChecker::FetchUpdateInfo(ManifestParser& parser) {
+    LOG_INFO<<"正在从服务器获取更新信息: "<<updateUrl<<std::endl;
+    LOG_DEBUG<<"当前缓存状态: "<<(enableApiCache?"启用API缓存":"禁用API缓存")<<std::endl;
+
+    std::string etag;
+    std::string lastModified;
+    bool hasCache=manifestCache.LoadValidators(updateUrl,etag,lastModified);
+
+    // 正文边到达边解析，同时写入清单缓存的临时文件
+    HttpClient::DataSink sink=[this,&parser](const unsigned char* data,size_t size) {
+        manifestCache.AppendBody(data,size);
+        return parser.Feed(reinterpret_cast<const char*>(data),size);
+    };
+
+    parser.Reset();
+    manifestCache.BeginStore();
+    HttpClient::HttpResponse response;
+    bool fetched=httpClient.GetConditional(updateUrl,etag,lastModified,sink,response);
+    if(fetched&&response.status>=400) {
+        LOG_ERROR<<"服务器返回错误: HTTP "<<response.status<<std::endl;
+        fetched=false;
+    }
+    if(!fetched&&parser.GetError().empty()) {
+        manifestCache.AbortStore();
+        parser.Reset();
+        if(hasCache&&manifestCache.LoadManifest(parser)) {
+            LOG_WARN<<"无法连接服务器，使用本地缓存的更新信息"<<std::endl;
+            return true;
+        }
+        LOG_ERROR<<"错误: 获取更新信息返回为空"<<std::endl;
+        return false;
     }
 
-    if(jsonResponse.size()>10*1024*1024) {
-        g_logger<<"[WARN]警告: JSON响应过大 ("<<(jsonResponse.size()/1024/1024)<<"MB)，可能影响性能"<<std::endl;
+    // 304 时跳过下载，直接解析缓存
+    if(fetched&&response.status==304) {
+        manifestCache.AbortStore();
+        if(hasCache&&manifestCache.LoadManifest(parser)) {
+            LOG_INFO<<"更新信息未变化，使用本地缓存"<<std::endl;
+            return true;
+        }
+        LOG_WARN<<"清单缓存不可用，重新获取完整更新信息"<<std::endl;
+        manifestCache.Invalidate();
+        parser.Reset();
+        manifestCache.BeginStore();
+        fetched=httpClient.GetConditional(updateUrl,"","",sink,response)&&response.status<400;
+        if(!fetched&&parser.GetError().empty()) {
+            manifestCache.AbortStore();
+            LOG_ERROR<<"错误: 获取更新信息返回为空"<<std::endl;
+            return false;
+        }
     }
 
-    Json::Value updateInfo;
-    if(!ParseUpdateInfo(jsonResponse,updateInfo)) {
-        g_logger<<"[ERROR]错误: 解析更新信息失败"<<std::endl;
-        return Json::Value();
+    if(!parser.GetError().empty()||!parser.Finish()) {
+        manifestCache.AbortStore();
+        LOG_ERROR<<"JSON解析错误: "<<parser.GetError()<<std::endl;
+        LOG_ERROR<<"错误: 解析更新信息失败"<<std::endl;
+        return false;
     }
 
-    return updateInfo;
+    if(response.status==200) {
+        manifestCache.CommitStore(updateUrl,response.etag,response.lastModified);
+    }
+    else {
+        manifestCache.AbortStore();
+    }
+    return true;
 }
 
-bool UpdateChecker::ParseUpdateInfo(const std::string& jsonData,Json::Value& updateInfo) {
-    Json::CharReaderBuilder reader;
-    std::stringstream ss(jsonData);
-    std::string errors;
+bool UpdateChecker::FetchBinaryManifest(const Json::Value& updateInfo,BinaryManifest& manifest) {
+    manifest.Close();
 
-    if(Json::parseFromStream(reader,ss,&updateInfo,&errors)) {
-        return true;
+    const Json::Value& info=updateInfo["binary_manifest"];
+    if(!info.isObject()||info["url"].asString().empty()) {
+        return false;
+    }
+
+    std::string url=info["url"].asString();
+    std::string expectedHash=info["hash"].asString();
+    std::string algorithm=configManager.ReadHashAlgorithm();
+
+    // 有哈希时落盘后直接映射，内容未变的下次启动不再下载；否则从下载缓冲区读取
+    if(!expectedHash.empty()&&manifestCache.IsEnabled()) {
+        std::error_code ec;
+        if(std::filesystem::exists(binaryManifestPath,ec)&&
+            FileHasher::CalculateFileHashStream(binaryManifestPath,algorithm)==expectedHash&&
+            manifest.LoadFromFile(binaryManifestPath)) {
+            LOG_INFO<<"二进制清单未变化，使用本地缓存"<<std::endl;
+        }
+        else {
+            std::string digest;
+            if(!httpClient.DownloadFileResumable(url,binaryManifestPath,algorithm,expectedHash,digest)||
+                !manifest.LoadFromFile(binaryManifestPath)) {
+                LOG_WARN<<"获取二进制清单失败，改用JSON清单"<<std::endl;
+                return false;
+            }
+        }
     }
     else {
-        g_logger<<"[ERROR]JSON解析错误: "<<errors<<std::endl;
+        std::vector<unsigned char> buffer;
+        if(!httpClient.DownloadToMemory(url,buffer)) {
+            LOG_WARN<<"获取二进制清单失败，改用JSON清单"<<std::endl;
+            return false;
+        }
+        if(!expectedHash.empty()&&FileHasher::CalculateMemoryHash(buffer,algorithm)!=expectedHash) {
+            LOG_WARN<<"二进制清单哈希不匹配，改用JSON清单"<<std::endl;
+            return false;
+        }
+        if(!manifest.LoadFromBuffer(std::move(buffer))) {
+            return false;
+        }
+    }
+
+    if(manifest.GetAlgorithm()!=algorithm) {
+        LOG_WARN<<"二进制清单哈希算法 "<<manifest.GetAlgorithm()<<" 与配置 "<<algorithm<<" 不一致，改用JSON清单"<<std::endl;
+        manifest.Close();
         return false;
     }
+
+    LOG_INFO<<"已加载二进制清单: "<<manifest.GetFileCount()<<" 个文件, "
+        <<manifest.GetDirectoryCount()<<" 个目录"<<std::endl;
+    return true;
 }
 
 void UpdateChecker::DisplayChangelog(const Json::Value& changelog) {
     if(changelog.isNull()||!changelog.isArray()) {
-        g_logger<<"[INFO]暂无更新日志"<<std::endl;
+        LOG_INFO<<"暂无更新日志"<<std::endl;
         return;
     }
 
@@ -82,8 +171,8 @@ void UpdateChecker::DisplayChangelog(const Json::Value& changelog) {
     }
     std::cout<<"================\n"<<std::endl;
 
-    g_logger<<"[INFO]更新内容:"<<std::endl;
+    LOG_INFO<<"更新内容:"<<std::endl;
     for(const auto& change:changelog) {
-        g_logger<<"[INFO]  - "<<change.asString()<<std::endl;
+        LOG_INFO<<" - "<<change.asString()<<std::endl;
     }
 }
\ No newline at end of file
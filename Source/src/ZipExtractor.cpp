@@ -21,19 +21,41 @@
 #include <fcntl.h>
 #include <io.h>
 #include <windows.h>
+
+namespace {
+    const size_t STREAM_PIPE_CAPACITY=8*1024*1024;
+}
+
 ZipExtractor::ZipExtractor(HttpClient& http,ProgressReporter& reporter)
-    : httpClient(http),pRepoter(reporter) {
+    : httpClient(http),pRepoter(reporter),extractThreads(0),memoryExtractLimit(256LL*1024*1024),streamingExtract(true),skipUnchanged(true) {
 }
 bool ZipExtractor::ExtractZip(const std::vector<unsigned char>& zipData,const std::string& extractPath) {
     fsHelper.EnsureDirectoryExists(extractPath);
+
+    // 数据已在内存中且不超过阈值时直接作为 libzip 数据源，省去临时文件的写入和重读
+    if(!zipData.empty()&&static_cast<long long>(zipData.size())<=memoryExtractLimit) {
+        if(ExtractZipFromMemory(zipData.data(),zipData.size(),extractPath)) {
+            LOG_INFO<<"libzip 解压成功"<<std::endl;
+            if(fsHelper.ValidateExtraction(extractPath)) {
+                return true;
+            }
+            LOG_WARN<<"libzip 解压验证失败"<<std::endl;
+        }
+        else {
+            LOG_ERROR<<"libzip 解压失败"<<std::endl;
+        }
+        fsHelper.CleanupTempExtractDir(extractPath);
+        return false;
+    }
+
     std::string tempDir=std::filesystem::temp_directory_path().string();
     std::string tempZip=tempDir+"/minecraft_update_"+std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())+".zip";
 
-    g_logger<<"[INFO] 将ZIP数据写入临时文件: "<<tempZip<<std::endl;
+    LOG_INFO<<"将ZIP数据写入临时文件: "<<tempZip<<std::endl;
 
     std::ofstream tempFile(tempZip,std::ios::binary);
     if(!tempFile) {
-        g_logger<<"[ERROR] 无法创建临时ZIP文件: "<<tempZip<<std::endl;
+        LOG_ERROR<<"无法创建临时ZIP文件: "<<tempZip<<std::endl;
         return false;
     }
 
@@ -43,297 +65,363 @@ bool ZipExtractor::ExtractZip(const std::vector<unsigned char>& zipData,const st
     std::error_code ec;
     std::filesystem::remove(tempZip,ec);
     if(ec) {
-        g_logger<<"[WARN] 无法删除临时文件: "<<tempZip<<" - "<<ec.message()<<std::endl;
+        LOG_WARN<<"无法删除临时文件: "<<tempZip<<" - "<<ec.message()<<std::endl;
     }
 
     return result;
 }
 bool ZipExtractor::ExtractZipFromFile(const std::string& zipFilePath,const std::string& extractPath) {
-    g_logger<<"[INFO] 开始解压文件: "<<zipFilePath<<" 到 "<<extractPath<<std::endl;
+    LOG_INFO<<"开始解压文件: "<<zipFilePath<<" 到 "<<extractPath<<std::endl;
 
     std::error_code ec;
     if(!std::filesystem::exists(zipFilePath,ec)) {
         if(ec) {
-            g_logger<<"[ERROR] 检查ZIP文件存在性失败: "<<ec.message()<<std::endl;
+            LOG_ERROR<<"检查ZIP文件存在性失败: "<<ec.message()<<std::endl;
         }
         else {
-            g_logger<<"[ERROR] ZIP 文件不存在: "<<zipFilePath<<std::endl;
+            LOG_ERROR<<"ZIP 文件不存在: "<<zipFilePath<<std::endl;
         }
         return false;
     }
 
     auto fileSize=std::filesystem::file_size(zipFilePath,ec);
     if(ec) {
-        g_logger<<"[ERROR] 无法获取ZIP文件大小: "<<ec.message()<<std::endl;
+        LOG_ERROR<<"无法获取ZIP文件大小: "<<ec.message()<<std::endl;
         return false;
     }
     if(fileSize==0) {
-        g_logger<<"[ERROR] ZIP 文件为空: "<<zipFilePath<<std::endl;
+        LOG_ERROR<<"ZIP 文件为空: "<<zipFilePath<<std::endl;
         return false;
     }
 
-    g_logger<<"[INFO] ZIP 文件大小: "<<pRepoter.FormatBytes(fileSize)<<std::endl;
+    LOG_INFO<<"ZIP 文件大小: "<<pRepoter.FormatBytes(fileSize)<<std::endl;
 
     return ExtractZipWithMiniz(zipFilePath,extractPath);
 }
 bool ZipExtractor::ExtractZipWithMiniz(const std::string& zipFilePath,const std::string& extractPath) {
-    g_logger<<"[INFO] 调用 miniz 解压方法..."<<std::endl;
+    LOG_INFO<<"调用 miniz 解压方法..."<<std::endl;
     return ExtractZipSimple(zipFilePath,extractPath);
 }
 
 bool ZipExtractor::ExtractZipSimple(const std::string& zipFilePath,const std::string& extractPath) {
-    g_logger<<"[INFO] 使用简单解压方法..."<<std::endl;
+    LOG_INFO<<"使用简单解压方法..."<<std::endl;
 
-    g_logger<<"[INFO] 尝试使用原始 libzip 解压..."<<std::endl;
+    LOG_INFO<<"尝试使用原始 libzip 解压..."<<std::endl;
     if(ExtractZipOriginal(zipFilePath,extractPath)) {
-        g_logger<<"[INFO] libzip 解压成功"<<std::endl;
+        LOG_INFO<<"libzip 解压成功"<<std::endl;
         if(fsHelper.ValidateExtraction(extractPath)) {
             return true;
         }
         else {
-            g_logger<<"[WARN] libzip 解压验证失败"<<std::endl;
+            LOG_WARN<<"libzip 解压验证失败"<<std::endl;
             fsHelper.CleanupTempExtractDir(extractPath);
             return false;
         }
     }
     else {
-        g_logger<<"[ERROR] libzip 解压失败"<<std::endl;
+        LOG_ERROR<<"libzip 解压失败"<<std::endl;
         fsHelper.CleanupTempExtractDir(extractPath);
         return false;
     }
 }
 bool ZipExtractor::ExtractZipOriginal(const std::string& zipFilePath,const std::string& extractPath) {
-    g_logger<<"[INFO] 使用原始libzip解压..."<<std::endl;
+    LOG_INFO<<"使用原始libzip解压..."<<std::endl;
 
-    int err=0;
-    zip_t* zip=zip_open(zipFilePath.c_str(),0,&err);
+    return ExtractArchive([&zipFilePath]() -> zip_t* {
+        int err=0;
+        zip_t* zip=zip_open(zipFilePath.c_str(),ZIP_RDONLY,&err);
+        if(!zip) {
+            LOG_ERROR<<"无法打开ZIP文件: "<<zipFilePath<<"，错误码: "<<err<<std::endl;
+        }
+        return zip;
+        },extractPath);
+}
+bool ZipExtractor::ExtractZipFromMemory(const unsigned char* data,size_t size,const std::string& extractPath) {
+    LOG_INFO<<"从内存直接解压 ("<<pRepoter.FormatBytes(static_cast<long long>(size))<<")..."<<std::endl;
+
+    // 每个句柄各建一个只读缓冲区数据源，共享同一块内存
+    return ExtractArchive([data,size]() -> zip_t* {
+        zip_error_t error;
+        zip_error_init(&error);
+        zip_source_t* source=zip_source_buffer_create(data,size,0,&error);
+        zip_t* zip=nullptr;
+        if(source) {
+            zip=zip_open_from_source(source,ZIP_RDONLY,&error);
+            if(!zip) {
+                zip_source_free(source);
+            }
+        }
+        if(!zip) {
+            LOG_ERROR<<"无法从内存打开ZIP数据: "<<zip_error_strerror(&error)<<std::endl;
+        }
+        zip_error_fini(&error);
+        return zip;
+        },extractPath);
+}
+bool ZipExtractor::ExtractArchive(const std::function<zip_t*()>& openArchive,const std::string& extractPath) {
+    zip_t* zip=openArchive();
     if(!zip) {
-        g_logger<<"[ERROR] 无法打开ZIP文件: "<<zipFilePath<<"，错误码: "<<err<<std::endl;
         return false;
     }
 
     zip_int64_t numEntries=zip_get_num_entries(zip,0);
-    g_logger<<"[INFO] 总共 "<<numEntries<<" 个条目需要解压"<<std::endl;
+    LOG_INFO<<"总共 "<<numEntries<<" 个条目需要解压"<<std::endl;
 
     if(numEntries<=0) {
-        g_logger<<"[ERROR] ZIP文件为空"<<std::endl;
+        LOG_ERROR<<"ZIP文件为空"<<std::endl;
+        zip_close(zip);
+        return false;
+    }
+    // 基准目录只解析一次，之后每个条目只做词法检查，不再逐条访问文件系统
+    std::filesystem::path canonicalBase;
+    try {
+        canonicalBase=FileSystemHelper::CanonicalBaseW(fsHelper.Utf8ToWide(extractPath));
+    }
+    catch(const std::exception& e) {
+        LOG_ERROR<<"无法解析解压目录: "<<extractPath<<" - "<<e.what()<<std::endl;
         zip_close(zip);
         return false;
     }
-    g_logger<<"[INFO] 第一步：创建目录结构..."<<std::endl;
 
-    std::vector<std::string> fileEntries;
+    ExtractState state;
+    std::vector<ZipEntryInfo> plan;
+    BuildExtractPlan(zip,numEntries,canonicalBase,plan,state);
 
-    for(zip_int64_t i=0; i<numEntries; i++) {
-        const char* name=zip_get_name(zip,i,ZIP_FL_ENC_UTF_8);
-        if(!name) {
-            name=zip_get_name(zip,i,0);
-            if(!name) {
-                g_logger<<"[WARN] 无法获取文件 "<<i<<" 的文件名"<<std::endl;
-                continue;
-            }
+    LOG_INFO<<"第一步：创建目录结构..."<<std::endl;
+    std::set<std::wstring> directories;
+    for(const auto& entry:plan) {
+        directories.insert(entry.isDirectory?entry.targetPath:std::filesystem::path(entry.targetPath).parent_path().wstring());
+    }
+    for(const auto& directory:directories) {
+        std::error_code ec;
+        std::filesystem::create_directories(directory,ec);
+        if(ec) {
+            LOG_WARN<<"无法创建目录 "<<fsHelper.WideToUtf8(directory)<<": "<<ec.message()<<std::endl;
         }
-        std::string originalName=name;
-        std::string safeName=originalName;
-        std::wstring wideName=fsHelper.Utf8ToWide(originalName);
-        if(wideName.empty()) {
-            g_logger<<"[WARN] 无法转换文件名: "<<originalName<<std::endl;
-            safeName="file_"+std::to_string(i)+".dat";
-            g_logger<<"[INFO] 使用替代文件名: "<<safeName<<std::endl;
-        }
-        std::string fullPath;
-        std::wstring wideExtractPath=fsHelper.Utf8ToWide(extractPath);
-        if(!wideExtractPath.empty()&&!wideName.empty()) {
-            std::wstring safeFullPath;
-            try {
-                safeFullPath=FileSystemHelper::SecureCombineW(wideExtractPath,wideName);
-            }
-            catch(const std::exception& e) {
-                g_logger<<"[ERROR] ZIP目录路径遍历被阻止: "<<e.what()<<" (条目: "<<originalName<<")"<<std::endl;
-                continue;
+    }
+    LOG_DEBUG<<"已创建 "<<directories.size()<<" 个目录"<<std::endl;
+
+    // 文件条目移到前面并按解压后大小降序领取，大文件先开始，各线程大致同时结束
+    auto filesEnd=std::stable_partition(plan.begin(),plan.end(),[](const ZipEntryInfo& entry) {
+        return !entry.isDirectory;
+        });
+    std::sort(plan.begin(),filesEnd,[](const ZipEntryInfo& a,const ZipEntryInfo& b) {
+        return a.size>b.size;
+        });
+    plan.erase(filesEnd,plan.end());
+
+    int totalFiles=static_cast<int>(plan.size())+state.failedFiles;
+    LOG_INFO<<"第二步：解压 "<<plan.size()<<" 个文件..."<<std::endl;
+
+    int threadCount=extractThreads>0?extractThreads:static_cast<int>(std::thread::hardware_concurrency());
+    threadCount=(std::max)(1,(std::min)(threadCount,static_cast<int>(plan.size())));
+    LOG_INFO<<"解压线程数: "<<threadCount<<std::endl;
+
+    // zip_t 不能跨线程共享，每个工作线程各自打开一个只读句柄
+    std::vector<std::thread> workers;
+    for(int t=1; t<threadCount; t++) {
+        workers.emplace_back([this,&openArchive,&plan,&extractPath,&state]() {
+            zip_t* workerZip=openArchive();
+            if(!workerZip) {
+                return;
             }
-            fullPath=fsHelper.WideToUtf8(safeFullPath);
-            if(!wideName.empty()&&wideName.back()==L'/') {
-                try {
-                    std::filesystem::path dirPath=safeFullPath;
-                    std::filesystem::create_directories(dirPath);
+            ExtractEntries(workerZip,plan,extractPath,state);
+            zip_close(workerZip);
+            });
+    }
+    ExtractEntries(zip,plan,extractPath,state);
+    for(auto& worker:workers) {
+        worker.join();
+    }
 
-                    if(i%50==0) {
-                        g_logger<<"[DEBUG] 创建目录: "<<originalName<<std::endl;
-                    }
-                }
-                catch(const std::exception& e) {
-                    g_logger<<"[WARN] 无法创建目录 "<<originalName<<": "<<e.what()<<std::endl;
-                }
-                continue;
+    zip_close(zip);
+
+    int extractedFiles=state.extractedFiles;
+    int skippedFiles=state.skippedFiles;
+    int failedFiles=state.failedFiles;
+    int unicodeFailedFiles=state.unicodeFailedFiles;
+
+    std::cout<<"\r解压完成: "<<extractedFiles<<"/"<<totalFiles<<" 个文件已提取，"<<skippedFiles<<" 个未变化已跳过，失败: "<<failedFiles<<" (Unicode失败: "<<unicodeFailedFiles<<")                  "<<std::endl;
+    LOG_INFO<<"解压完成: "<<extractedFiles<<"/"<<totalFiles<<" 个文件已提取，"<<skippedFiles<<" 个未变化已跳过，失败: "<<failedFiles<<std::endl;
+
+    if(unicodeFailedFiles>0) {
+        LOG_WARN<<unicodeFailedFiles<<" 个文件因Unicode编码问题未能正确提取"<<std::endl;
+        LOG_WARN<<"建议检查系统区域设置或使用英文文件名"<<std::endl;
+    }
+    // 跳过的文件内容已经正确，计入成功
+    int completedFiles=extractedFiles+skippedFiles;
+    float successRate=(totalFiles>0)?(completedFiles*100.0f/totalFiles):0.0f;
+    LOG_INFO<<"解压成功率: "<<std::fixed<<std::setprecision(1)<<successRate<<"%"<<std::endl;
+    if(successRate<80.0f) {
+        LOG_WARN<<"解压成功率较低，可能需要手动检查"<<std::endl;
+        return false;
+    }
+
+    return completedFiles>0;
+}
+void ZipExtractor::BuildExtractPlan(zip_t* zip,zip_int64_t numEntries,const std::filesystem::path& canonicalBase,
+    std::vector<ZipEntryInfo>& plan,ExtractState& state) {
+    plan.reserve(static_cast<size_t>(numEntries));
+    std::set<std::wstring> verifiedDirectories;
+    for(zip_int64_t i=0; i<numEntries; i++) {
+        zip_stat_t stat;
+        zip_stat_init(&stat);
+        if(zip_stat_index(zip,i,ZIP_FL_ENC_UTF_8,&stat)!=0||!(stat.valid&ZIP_STAT_NAME)) {
+            LOG_WARN<<"无法获取文件 "<<i<<" 的文件名"<<std::endl;
+            continue;
+        }
+
+        std::string name=stat.name;
+        bool isDirectory=!name.empty()&&(name.back()=='/'||name.back()=='\\');
+        std::wstring wideName=FileSystemHelper::Utf8ToWide(name);
+        if(wideName.empty()) {
+            LOG_WARN<<"无法处理Unicode文件名: "<<name<<std::endl;
+            if(!isDirectory) {
+                state.failedFiles++;
+                state.unicodeFailedFiles++;
             }
+            continue;
         }
-        else {
-            try {
-                fullPath=FileSystemHelper::SecureCombine(extractPath,safeName);
+
+        ZipEntryInfo entry;
+        try {
+            entry.targetPath=FileSystemHelper::SecureCombineLexicalW(canonicalBase,wideName);
+            std::wstring directory=isDirectory?entry.targetPath:std::filesystem::path(entry.targetPath).parent_path().wstring();
+            if(verifiedDirectories.count(directory)==0) {
+                FileSystemHelper::VerifyWithinBaseW(canonicalBase,directory);
+                verifiedDirectories.insert(directory);
             }
-            catch(const std::exception& e) {
-                g_logger<<"[ERROR] Path traversal blocked: "<<e.what()
-                    <<" (entry: "<<originalName<<")"<<std::endl;
-                continue;
+            if(!isDirectory) {
+                FileSystemHelper::VerifyFileWithinBaseW(canonicalBase,entry.targetPath);
             }
         }
-        if(!safeName.empty()&&safeName.back()=='/') {
-            try {
-                std::filesystem::create_directories(fullPath);
-                if(i%50==0) {
-                    g_logger<<"[DEBUG] 创建目录: "<<originalName<<std::endl;
-                }
-            }
-            catch(const std::exception& e) {
-                g_logger<<"[WARN] 无法创建目录 "<<originalName<<": "<<e.what()<<std::endl;
+        catch(const std::exception& e) {
+            LOG_ERROR<<"ZIP path traversal blocked: "<<e.what()<<" (entry: "<<name<<")"<<std::endl;
+            if(!isDirectory) {
+                state.failedFiles++;
             }
             continue;
         }
-        fileEntries.push_back(originalName);
+        entry.index=i;
+        entry.name=std::move(name);
+        entry.size=(stat.valid&ZIP_STAT_SIZE)?stat.size:0;
+        entry.crc=(stat.valid&ZIP_STAT_CRC)?stat.crc:0;
+        entry.hasCrc=(stat.valid&ZIP_STAT_CRC)!=0;
+        entry.isDirectory=isDirectory;
+        plan.push_back(std::move(entry));
     }
-
-    g_logger<<"[INFO] 第二步：解压 "<<fileEntries.size()<<" 个文件..."<<std::endl;
+}
+void ZipExtractor::ExtractEntries(zip_t* zip,const std::vector<ZipEntryInfo>& plan,
+    const std::string& extractPath,ExtractState& state) {
     const size_t bufferSize=65536;
     std::vector<char> buffer(bufferSize);
-    int extractedFiles=0;
-    int failedFiles=0;
-    int unicodeFailedFiles=0;
-    int totalFiles=static_cast<int>(fileEntries.size());
-
-    for(size_t idx=0; idx<fileEntries.size(); idx++) {
-        const auto& originalName=fileEntries[idx];
-        zip_int64_t index=zip_name_locate(zip,originalName.c_str(),ZIP_FL_ENC_UTF_8);
-        if(index<0) {
-            index=zip_name_locate(zip,originalName.c_str(),0);
-            if(index<0) {
-                g_logger<<"[WARN] 无法找到文件索引: "<<originalName<<std::endl;
-                failedFiles++;
-                continue;
-            }
-        }
+    int totalFiles=static_cast<int>(plan.size());
 
-        zip_file_t* zfile=zip_fopen_index(zip,index,0);
-        if(!zfile) {
-            g_logger<<"[WARN] 无法打开文件: "<<originalName<<std::endl;
-            failedFiles++;
-            continue;
+    while(!state.stop) {
+        size_t idx=state.nextEntry.fetch_add(1);
+        if(idx>=plan.size()) {
+            break;
         }
-        struct ZipFileCloser {
-            zip_file_t* file;
-            ~ZipFileCloser() { if(file) zip_fclose(file); }
-        } closer{zfile};
 
-        std::string safeName=originalName;
-        std::string fullPath;
-        std::wstring wideExtractPath=fsHelper.Utf8ToWide(extractPath);
-        std::wstring wideName=fsHelper.Utf8ToWide(originalName);
+        ExtractEntry(zip,plan[idx],extractPath,buffer,state);
 
-        if(!wideExtractPath.empty()&&!wideName.empty()) {
-            std::wstring safeFullPath;
-            try {
-                safeFullPath=FileSystemHelper::SecureCombineW(wideExtractPath,wideName);
-            }
-            catch(const std::exception& e) {
-                g_logger<<"[ERROR] ZIP path traversal blocked: "<<e.what()
-                    <<" (entry: "<<originalName<<")"<<std::endl;
-                failedFiles++;
-                unicodeFailedFiles++;
-                continue;
-            }
-            fullPath=fsHelper.WideToUtf8(safeFullPath);
-            std::filesystem::path filePath=safeFullPath;
-            std::filesystem::create_directories(filePath.parent_path());
-            FILE* outFile=_wfopen(safeFullPath.c_str(),L"wb");
-            if(outFile) {
-                zip_int64_t bytesRead;
-                long long totalBytes=0;
-                while((bytesRead=zip_fread(zfile,buffer.data(),bufferSize))>0) {
-                    size_t written=fwrite(buffer.data(),1,(size_t)bytesRead,outFile);
-                    totalBytes+=bytesRead;
-                }
-
-                fclose(outFile);
-                extractedFiles++;
-            }
-            else {
-                DWORD error=GetLastError();
-                g_logger<<"[ERROR] 无法创建文件: "<<originalName<<" (错误码: "<<error<<")"<<std::endl;
-                failedFiles++;
-                unicodeFailedFiles++;
-                std::string asciiName="file_"+std::to_string(extractedFiles+failedFiles)+".dat";
-                std::string asciiFullPath;
-                try {
-                    asciiFullPath=FileSystemHelper::SecureCombine(extractPath,asciiName);
-                }
-                catch(const std::exception& e) {
-                    g_logger<<"[ERROR] ASCII后备路径遍历被阻止: "<<e.what()<<std::endl;
-                    failedFiles++;
-                    continue;
-                }
+        int processed=++state.processedFiles;
+        if(processed%100==0) {
+            std::lock_guard<std::mutex> lock(state.progressMutex);
+            int extractedFiles=state.extractedFiles;
+            int failedFiles=state.failedFiles;
+            int percent=static_cast<int>((processed*100LL)/(std::max)(totalFiles,1));
+            std::cout<<"\r解压进度: "<<processed<<"/"<<totalFiles<<" 文件 ("<<percent<<"%)，成功: "<<extractedFiles<<"，失败: "<<failedFiles<<"      ";
+            std::cout.flush();
+            LOG_INFO<<"已处理 "<<processed<<"/"<<totalFiles<<" 个文件 ("<<percent<<"%)"<<std::endl;
+        }
+        if(state.failedFiles>=20&&processed>100&&!state.stop.exchange(true)) {
+            LOG_ERROR<<"失败文件过多，停止解压 (总失败: "<<state.failedFiles<<", Unicode失败: "<<state.unicodeFailedFiles<<")"<<std::endl;
+        }
+    }
+}
+void ZipExtractor::ExtractEntry(zip_t* zip,const ZipEntryInfo& entry,const std::string& extractPath,
+    std::vector<char>& buffer,ExtractState& state) {
+    const std::string& originalName=entry.name;
+    // 文件大小不同时只需一次 stat；相同时读一遍本地文件算 CRC，仍比重写便宜
+    if(skipUnchanged&&entry.hasCrc&&FileHasher::FileMatchesCrc32(entry.targetPath,entry.size,entry.crc)) {
+        state.skippedFiles++;
+        return;
+    }
+    zip_file_t* zfile=zip_fopen_index(zip,entry.index,0);
+    if(!zfile) {
+        LOG_WARN<<"无法打开文件: "<<originalName<<std::endl;
+        state.failedFiles++;
+        return;
+    }
 
-                g_logger<<"[INFO] 尝试使用ASCII名称: "<<asciiName<<std::endl;
-
-                std::ofstream asciiFile(asciiFullPath,std::ios::binary);
-                if(asciiFile) {
-                    zip_int64_t bytesRead;
-                    long long totalBytes=0;
-                    zip_fclose(zfile);
-                    zfile=zip_fopen_index(zip,index,0);
-
-                    if(zfile) {
-                        while((bytesRead=zip_fread(zfile,buffer.data(),bufferSize))>0) {
-                            asciiFile.write(buffer.data(),bytesRead);
-                            totalBytes+=bytesRead;
-                        }
-                        asciiFile.close();
-                        extractedFiles++;
-                        g_logger<<"[INFO] 文件 "<<originalName<<" 保存为 "<<asciiName<<std::endl;
-                    }
-                }
+    // 解压流读到末尾前出错 (CRC/数据损坏) 或写盘失败都算作失败
+    auto copyEntry=[&buffer,zfile](auto&& writeChunk) {
+        zip_int64_t bytesRead;
+        while((bytesRead=zip_fread(zfile,buffer.data(),buffer.size()))>0) {
+            if(!writeChunk(buffer.data(),static_cast<size_t>(bytesRead))) {
+                return false;
             }
         }
-        else {
-            g_logger<<"[WARN] 无法处理Unicode文件名: "<<originalName<<std::endl;
-            failedFiles++;
-            unicodeFailedFiles++;
-        }
+        return bytesRead==0;
+        };
+
+    // 父目录已在第一步统一创建
+    FILE* outFile=_wfopen(entry.targetPath.c_str(),L"wb");
+    if(outFile) {
+        bool copied=copyEntry([outFile](const char* data,size_t size) {
+            return fwrite(data,1,size,outFile)==size;
+            });
+        bool closed=fclose(outFile)==0;
         zip_fclose(zfile);
-        if((extractedFiles+failedFiles)%100==0) {
-            int processed=extractedFiles+failedFiles;
-            int percent=static_cast<int>((processed*100)/(std::max)(totalFiles,1));
-            std::cout<<"\r解压进度: "<<processed<<"/"<<totalFiles<<" 文件 ("<<percent<<"%)，成功: "<<extractedFiles<<"，失败: "<<failedFiles<<"      ";
-            std::cout.flush();
-            g_logger<<"[INFO] 已处理 "<<processed<<"/"<<totalFiles<<" 个文件 ("<<percent<<"%)"<<std::endl;
+        if(copied&&closed) {
+            state.extractedFiles++;
         }
-        if(failedFiles>=20&&idx>100) {
-            g_logger<<"[ERROR] 失败文件过多，停止解压 (总失败: "<<failedFiles<<", Unicode失败: "<<unicodeFailedFiles<<")"<<std::endl;
-            break;
+        else {
+            LOG_ERROR<<"解压文件失败: "<<originalName<<std::endl;
+            state.failedFiles++;
         }
+        return;
     }
 
-    zip_close(zip);
-
-    std::cout<<"\r解压完成: "<<extractedFiles<<"/"<<totalFiles<<" 个文件已提取，失败: "<<failedFiles<<" (Unicode失败: "<<unicodeFailedFiles<<")                  "<<std::endl;
-    g_logger<<"[INFO] 解压完成: "<<extractedFiles<<"/"<<totalFiles<<" 个文件已提取，失败: "<<failedFiles<<std::endl;
+    DWORD error=GetLastError();
+    LOG_ERROR<<"无法创建文件: "<<originalName<<" (错误码: "<<error<<")"<<std::endl;
+    state.failedFiles++;
+    state.unicodeFailedFiles++;
 
-    if(unicodeFailedFiles>0) {
-        g_logger<<"[WARN] "<<unicodeFailedFiles<<" 个文件因Unicode编码问题未能正确提取"<<std::endl;
-        g_logger<<"[WARN] 建议检查系统区域设置或使用英文文件名"<<std::endl;
+    // 以条目序号命名，多线程下名称也不会冲突
+    std::string asciiName="file_"+std::to_string(entry.index)+".dat";
+    std::string asciiFullPath;
+    try {
+        asciiFullPath=FileSystemHelper::SecureCombine(extractPath,asciiName);
     }
-    float successRate=(totalFiles>0)?(extractedFiles*100.0f/totalFiles):0.0f;
-    g_logger<<"[INFO] 解压成功率: "<<std::fixed<<std::setprecision(1)<<successRate<<"%"<<std::endl;
-    if(successRate<80.0f) {
-        g_logger<<"[WARN] 解压成功率较低，可能需要手动检查"<<std::endl;
-        return false;
+    catch(const std::exception& e) {
+        LOG_ERROR<<"ASCII后备路径遍历被阻止: "<<e.what()<<std::endl;
+        state.failedFiles++;
+        zip_fclose(zfile);
+        return;
     }
 
-    return extractedFiles>0;
+    LOG_INFO<<"尝试使用ASCII名称: "<<asciiName<<std::endl;
+
+    std::ofstream asciiFile(asciiFullPath,std::ios::binary);
+    if(asciiFile) {
+        bool copied=copyEntry([&asciiFile](const char* data,size_t size) {
+            asciiFile.write(data,static_cast<std::streamsize>(size));
+            return asciiFile.good();
+            });
+        asciiFile.close();
+        if(copied) {
+            state.extractedFiles++;
+            LOG_INFO<<"文件 "<<originalName<<" 保存为 "<<asciiName<<std::endl;
+        }
+    }
+    zip_fclose(zfile);
 }
 bool ZipExtractor::IsValidZipFile(const std::string& filePath) {
     std::ifstream file(filePath,std::ios::binary);
     if(!file) {
-        g_logger<<"[DEBUG] 无法打开文件: "<<filePath<<std::endl;
+        LOG_DEBUG<<"无法打开文件: "<<filePath<<std::endl;
         return false;
     }
 
@@ -342,7 +430,7 @@ bool ZipExtractor::IsValidZipFile(const std::string& filePath) {
     file.seekg(0,std::ios::beg);
 
     if(fileSize<22) {
-        g_logger<<"[DEBUG] 文件太小 ("<<fileSize<<" 字节)，可能是空ZIP文件"<<std::endl;
+        LOG_DEBUG<<"文件太小 ("<<fileSize<<" 字节)，可能是空ZIP文件"<<std::endl;
 
         if(fileSize==0) {
             return true;
@@ -354,7 +442,7 @@ bool ZipExtractor::IsValidZipFile(const std::string& filePath) {
         if(fileSize==22) {
             if(buffer[0]==0x50&&buffer[1]==0x4B&&
                 buffer[2]==0x05&&buffer[3]==0x06) {
-                g_logger<<"[DEBUG] 有效的空ZIP文件（只有目录结束标记）"<<std::endl;
+                LOG_DEBUG<<"有效的空ZIP文件（只有目录结束标记）"<<std::endl;
                 return true;
             }
         }
@@ -366,39 +454,40 @@ bool ZipExtractor::IsValidZipFile(const std::string& filePath) {
     file.read(header,4);
 
     if(file.gcount()<4) {
-        g_logger<<"[DEBUG] 无法读取文件头"<<std::endl;
+        LOG_DEBUG<<"无法读取文件头"<<std::endl;
         return false;
     }
     bool isZipSignature=(header[0]==0x50&&header[1]==0x4B&&
         header[2]==0x03&&header[3]==0x04);
 
     if(!isZipSignature) {
-        g_logger<<"[DEBUG] 文件头不是有效的ZIP签名: ";
-        for(int i=0; i<4; ++i) {
-            g_logger<<std::hex<<(int)(unsigned char)header[i]<<" ";
+        if(g_logger.ShouldLog(LogLevel::Debug)) {
+            char signature[16];
+            snprintf(signature,sizeof(signature),"%02x %02x %02x %02x",
+                (unsigned char)header[0],(unsigned char)header[1],(unsigned char)header[2],(unsigned char)header[3]);
+            LOG_DEBUG<<"文件头不是有效的ZIP签名: "<<signature<<std::endl;
         }
-        g_logger<<std::dec<<std::endl;
 
         if(fileSize==0) {
-            g_logger<<"[DEBUG] 空文件，可能是空目录"<<std::endl;
+            LOG_DEBUG<<"空文件，可能是空目录"<<std::endl;
             return true;
         }
 
         return false;
     }
 
-    g_logger<<"[DEBUG] 有效的ZIP文件签名，文件大小: "<<pRepoter.FormatBytes(fileSize)<<std::endl;
+    LOG_DEBUG<<"有效的ZIP文件签名，文件大小: "<<pRepoter.FormatBytes(fileSize)<<std::endl;
     return true;
 }
 //zhihouyizou
 bool ZipExtractor::CheckServerResponse(const std::string& url) {
-    g_logger<<"[DEBUG] 检查服务器响应: "<<url<<std::endl;
+    LOG_DEBUG<<"检查服务器响应: "<<url<<std::endl;
 
     try {
         std::string tempFile=std::filesystem::temp_directory_path().string()+"/test_response.bin";
 
         if(!httpClient.DownloadFileWithProgress(url,tempFile,nullptr,nullptr)) {
-            g_logger<<"[DEBUG] 服务器响应测试失败"<<std::endl;
+            LOG_DEBUG<<"服务器响应测试失败"<<std::endl;
             return false;
         }
 
@@ -407,53 +496,78 @@ bool ZipExtractor::CheckServerResponse(const std::string& url) {
         std::filesystem::remove(tempFile);
 
         if(ec||fileSize==0) {
-            g_logger<<"[DEBUG] 服务器返回空文件或错误"<<std::endl;
+            LOG_DEBUG<<"服务器返回空文件或错误"<<std::endl;
             return false;
         }
 
-        g_logger<<"[DEBUG] 服务器响应正常，文件大小: "<<pRepoter.FormatBytes(fileSize)<<std::endl;
+        LOG_DEBUG<<"服务器响应正常，文件大小: "<<pRepoter.FormatBytes(fileSize)<<std::endl;
         return true;
     }
     catch(const std::exception& e) {
-        g_logger<<"[DEBUG] 检查服务器响应异常: "<<e.what()<<std::endl;
+        LOG_DEBUG<<"检查服务器响应异常: "<<e.what()<<std::endl;
         return false;
     }
 }
 bool ZipExtractor::DownloadAndExtract(const std::string& url,const std::string& relativePath,const std::string& targetBaseDir) {
-    g_logger<<"[INFO] 下载并解压: "<<url<<" -> "<<relativePath<<std::endl;
+    LOG_INFO<<"下载并解压: "<<url<<" -> "<<relativePath<<std::endl;
 
     DWORD pid=GetCurrentProcessId();
     auto timestamp=std::chrono::steady_clock::now().time_since_epoch().count();
     std::string tempZip=(std::filesystem::temp_directory_path()/
         ("minecraft_update_"+std::to_string(pid)+"_"+std::to_string(timestamp)+".zip")).string();
 
-    std::string progressMessage="下载 "+relativePath;
-    pRepoter.ShowProgressBar(progressMessage,0,1);
-
-    bool downloadSuccess=httpClient.DownloadFileWithProgress(
-        url,
-        tempZip,
-        [this,progressMessage](long long downloaded,long long total,void* userdata) {
-            pRepoter.ShowProgressBar(progressMessage,downloaded,total);
-        },
-        nullptr
-    );
-
-    pRepoter.ClearProgressLine();
+    bool backedUp=false;
+    bool downloadSuccess=false;
+    // 流式阶段可能已写入目标目录，改用完整文件解压仍失败时要按它记录的状态恢复
+    ExtractState streamState;
+    auto restoreStreamTarget=[this,&targetBaseDir,&relativePath,&streamState]() {
+        if(!streamState.targetTouched) {
+            return;
+        }
+        try {
+            RestoreStreamTarget(FileSystemHelper::SecureCombine(targetBaseDir,relativePath),streamState);
+        }
+        catch(const std::exception& e) {
+            LOG_ERROR<<"恢复目录失败: "<<e.what()<<std::endl;
+        }
+        };
+    if(streamingExtract) {
+        StreamOutcome outcome=StreamDownloadAndExtract(url,relativePath,targetBaseDir,tempZip,backedUp,streamState);
+        if(outcome!=StreamOutcome::Fallback) {
+            return outcome==StreamOutcome::Extracted;
+        }
+        downloadSuccess=true;
+    }
+    else {
+        std::string progressMessage="下载 "+relativePath;
+        pRepoter.ShowProgressBar(progressMessage,0,1);
+
+        downloadSuccess=httpClient.DownloadFileWithProgress(
+            url,
+            tempZip,
+            [this,progressMessage](long long downloaded,long long total,void* userdata) {
+                pRepoter.ShowProgressBar(progressMessage,downloaded,total);
+            },
+            nullptr
+        );
+
+        pRepoter.ClearProgressLine();
+    }
 
     if(!downloadSuccess) {
-        g_logger<<"[ERROR] 下载失败: "<<url<<std::endl;
+        LOG_ERROR<<"下载失败: "<<url<<std::endl;
         return false;
     }
     std::error_code ec;
     auto fileSize=std::filesystem::file_size(tempZip,ec);
     if(ec) {
-        g_logger<<"[ERROR] 无法获取文件大小: "<<ec.message()<<std::endl;
+        LOG_ERROR<<"无法获取文件大小: "<<ec.message()<<std::endl;
         std::filesystem::remove(tempZip);
+        restoreStreamTarget();
         return false;
     }
 
-    g_logger<<"[INFO] 下载完成，文件大小: "<<pRepoter.FormatBytes(fileSize)<<std::endl;
+    LOG_INFO<<"下载完成，文件大小: "<<pRepoter.FormatBytes(fileSize)<<std::endl;
     if(fileSize<1024) {
         std::ifstream file(tempZip,std::ios::binary);
         if(file) {
@@ -463,47 +577,48 @@ bool ZipExtractor::DownloadAndExtract(const std::string& url,const std::string&
                 content.find("Not Found")!=std::string::npos||
                 content.find("Error")!=std::string::npos) {
 
-                g_logger<<"[INFO] 服务器返回错误页面，可能是空文件夹，将创建空目录"<<std::endl;
-                g_logger<<"[DEBUG] 服务器响应: "<<content<<std::endl;
+                LOG_INFO<<"服务器返回错误页面，可能是空文件夹，将创建空目录"<<std::endl;
+                LOG_DEBUG<<"服务器响应: "<<content<<std::endl;
                 std::filesystem::remove(tempZip);
                 std::string extractPath;
                 try {
                     extractPath=FileSystemHelper::SecureCombine(targetBaseDir,relativePath);
                 }
                 catch(const std::exception& e) {
-                    g_logger<<"[ERROR] 下载并解压中的路径遍历被阻止: "<<e.what()<<std::endl;
+                    LOG_ERROR<<"下载并解压中的路径遍历被阻止: "<<e.what()<<std::endl;
                     std::filesystem::remove(tempZip);
                     return false;
                 }
                 try {
                     if(!std::filesystem::exists(extractPath)) {
                         std::filesystem::create_directories(extractPath);
-                        g_logger<<"[INFO] 已创建空目录: "<<extractPath<<std::endl;
+                        LOG_INFO<<"已创建空目录: "<<extractPath<<std::endl;
                     }
                     else {
-                        g_logger<<"[INFO] 目录已存在: "<<extractPath<<std::endl;
+                        LOG_INFO<<"目录已存在: "<<extractPath<<std::endl;
                     }
                     return true;
                 }
                 catch(const std::exception& e) {
-                    g_logger<<"[ERROR] 创建目录失败: "<<e.what()<<std::endl;
+                    LOG_ERROR<<"创建目录失败: "<<e.what()<<std::endl;
                     return false;
                 }
             }
         }
     }
     if(!IsValidZipFile(tempZip)) {
-        g_logger<<"[ERROR] 下载的文件不是有效的ZIP文件，大小: "<<pRepoter.FormatBytes(fileSize)<<std::endl;
+        LOG_ERROR<<"下载的文件不是有效的ZIP文件，大小: "<<pRepoter.FormatBytes(fileSize)<<std::endl;
         if(fileSize<1024) {
             std::ifstream file(tempZip,std::ios::binary);
             if(file) {
                 std::string content((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
-                g_logger<<"[DEBUG] 文件内容: "<<content<<std::endl;
+                LOG_DEBUG<<"文件内容: "<<content<<std::endl;
             }
             file.close();
         }
 
         std::filesystem::remove(tempZip);
+        restoreStreamTarget();
         return false;
     }
     std::string extractPath;
@@ -511,20 +626,239 @@ bool ZipExtractor::DownloadAndExtract(const std::string& url,const std::string&
         extractPath=FileSystemHelper::SecureCombine(targetBaseDir,relativePath);
     }
     catch(const std::exception& e) {
-        g_logger<<"[ERROR] 路径遍历被阻止: "<<e.what()<<std::endl;
+        LOG_ERROR<<"路径遍历被阻止: "<<e.what()<<std::endl;
         return false;
     }
-    if(std::filesystem::exists(extractPath)) {
-        g_logger<<"[INFO] 备份原有目录..."<<std::endl;
+    // 流式阶段已备份过时不能再备份，否则会用解压了一半的目录覆盖备份
+    if(!backedUp&&std::filesystem::exists(extractPath)) {
+        LOG_INFO<<"备份原有目录..."<<std::endl;
         fsHelper.BackupFile(extractPath);
     }
     bool extractSuccess=ExtractZipOriginal(tempZip,extractPath);
     std::filesystem::remove(tempZip);
 
     if(!extractSuccess) {
-        g_logger<<"[ERROR] 解压失败"<<std::endl;
+        LOG_ERROR<<"解压失败"<<std::endl;
+        restoreStreamTarget();
         return false;
     }
 
     return true;
+}
+ZipExtractor::StreamOutcome ZipExtractor::StreamDownloadAndExtract(const std::string& url,const std::string& relativePath,
+    const std::string& targetBaseDir,const std::string& spoolPath,bool& backedUp,ExtractState& state) {
+    std::string extractPath;
+    try {
+        extractPath=FileSystemHelper::SecureCombine(targetBaseDir,relativePath);
+    }
+    catch(const std::exception& e) {
+        LOG_ERROR<<"路径遍历被阻止: "<<e.what()<<std::endl;
+        return StreamOutcome::Failed;
+    }
+
+    FILE* spool=nullptr;
+    if(fopen_s(&spool,spoolPath.c_str(),"wb")!=0||!spool) {
+        LOG_ERROR<<"无法创建临时ZIP文件: "<<spoolPath<<std::endl;
+        return StreamOutcome::Failed;
+    }
+
+    LOG_INFO<<"边下载边解压到: "<<extractPath<<std::endl;
+    std::string progressMessage="下载 "+relativePath;
+    pRepoter.ShowProgressBar(progressMessage,0,1);
+
+    // 下载线程把数据同时写入临时文件和管道，流式解压中途放弃时临时文件仍然完整
+    StreamPipe pipe(STREAM_PIPE_CAPACITY);
+    bool downloadSuccess=false;
+    std::thread downloader([this,&url,&pipe,spool,&progressMessage,&downloadSuccess]() {
+        downloadSuccess=httpClient.DownloadToSink(url,[&pipe,spool](const unsigned char* data,size_t size) {
+            if(fwrite(data,1,size,spool)!=size) {
+                return false;
+            }
+            pipe.Write(data,size);
+            return true;
+            },[this,&progressMessage](long long downloaded,long long total,void* userdata) {
+                pRepoter.ShowProgressBar(progressMessage,downloaded,total);
+            },nullptr);
+        pipe.Close(downloadSuccess);
+        });
+
+    StreamingZipReader reader([&pipe](unsigned char* buffer,size_t size) {
+        return pipe.Read(buffer,size);
+        });
+    bool streamed=ExtractStream(reader,extractPath,backedUp,state);
+
+    pipe.Abandon();
+    downloader.join();
+    bool spoolClosed=fclose(spool)==0;
+    pRepoter.ClearProgressLine();
+
+    std::error_code ec;
+    if(!downloadSuccess||!spoolClosed) {
+        LOG_ERROR<<"下载失败: "<<url<<std::endl;
+        std::filesystem::remove(spoolPath,ec);
+        RestoreStreamTarget(extractPath,state);
+        return StreamOutcome::Failed;
+    }
+    if(!streamed) {
+        LOG_WARN<<"流式解压未完成，改用已下载的完整文件: "<<reader.GetError()<<std::endl;
+        return StreamOutcome::Fallback;
+    }
+    std::filesystem::remove(spoolPath,ec);
+
+    int extractedFiles=state.extractedFiles;
+    int skippedFiles=state.skippedFiles;
+    int failedFiles=state.failedFiles;
+    int completedFiles=extractedFiles+skippedFiles;
+    int totalFiles=completedFiles+failedFiles;
+    LOG_INFO<<"流式解压完成: "<<extractedFiles<<"/"<<totalFiles<<" 个文件已提取，"<<skippedFiles<<" 个未变化已跳过，失败: "<<failedFiles<<std::endl;
+    float successRate=(totalFiles>0)?(completedFiles*100.0f/totalFiles):0.0f;
+    if(successRate<80.0f||completedFiles==0) {
+        LOG_ERROR<<"解压失败"<<std::endl;
+        RestoreStreamTarget(extractPath,state);
+        return StreamOutcome::Failed;
+    }
+    return StreamOutcome::Extracted;
+}
+void ZipExtractor::RestoreStreamTarget(const std::string& extractPath,const ExtractState& state) {
+    if(!state.targetTouched) {
+        return;
+    }
+
+    // 下载与解压同时进行，失败时目录里可能已有一半新文件，不能原样留下
+    std::error_code ec;
+    if(state.backupSaved) {
+        std::filesystem::remove_all(extractPath,ec);
+        std::filesystem::rename(extractPath+".backup",extractPath,ec);
+        if(ec) {
+            LOG_ERROR<<"恢复备份失败: "<<extractPath<<" - "<<ec.message()<<std::endl;
+        }
+        else {
+            LOG_INFO<<"已从备份恢复: "<<extractPath<<std::endl;
+        }
+    }
+    else if(!state.targetExisted) {
+        std::filesystem::remove_all(extractPath,ec);
+    }
+    else {
+        LOG_WARN<<"没有可用的备份，目录可能不完整: "<<extractPath<<std::endl;
+    }
+}
+bool ZipExtractor::ExtractStream(StreamingZipReader& reader,const std::string& extractPath,bool& backedUp,
+    ExtractState& state) {
+    std::filesystem::path canonicalBase;
+    std::set<std::wstring> verifiedDirectories;
+    std::set<std::wstring> createdDirectories;
+    auto ensureDirectory=[this,&createdDirectories](const std::wstring& directory) {
+        if(createdDirectories.insert(directory).second) {
+            std::error_code ec;
+            std::filesystem::create_directories(directory,ec);
+            if(ec) {
+                LOG_WARN<<"无法创建目录 "<<fsHelper.WideToUtf8(directory)<<": "<<ec.message()<<std::endl;
+            }
+        }
+        };
+    auto discard=[](const unsigned char* /*data*/,size_t /*size*/) {
+        };
+
+    StreamingZipReader::Entry entry;
+    StreamingZipReader::Result result;
+    while((result=reader.Next(entry))==StreamingZipReader::Result::Entry) {
+        // 旧式编码的文件名交给 libzip 处理，保持与整包解压一致的命名
+        if(entry.legacyName) {
+            LOG_DEBUG<<"条目文件名编码不确定，停止流式解压: "<<entry.name<<std::endl;
+            return false;
+        }
+        // 确认数据确实是 ZIP 流之后才备份并写入目标目录
+        if(canonicalBase.empty()) {
+            if(!backedUp) {
+                state.targetExisted=std::filesystem::exists(extractPath);
+                if(state.targetExisted) {
+                    LOG_INFO<<"备份原有目录..."<<std::endl;
+                    state.backupSaved=fsHelper.BackupFile(extractPath);
+                }
+                state.targetTouched=true;
+            }
+            backedUp=true;
+            try {
+                canonicalBase=FileSystemHelper::CanonicalBaseW(fsHelper.Utf8ToWide(extractPath));
+            }
+            catch(const std::exception& e) {
+                LOG_ERROR<<"无法解析解压目录: "<<extractPath<<" - "<<e.what()<<std::endl;
+                return false;
+            }
+        }
+
+        std::wstring targetPath;
+        try {
+            std::wstring wideName=FileSystemHelper::Utf8ToWide(entry.name);
+            if(wideName.empty()) {
+                throw std::runtime_error("invalid entry name");
+            }
+            targetPath=FileSystemHelper::SecureCombineLexicalW(canonicalBase,wideName);
+            std::wstring directory=entry.isDirectory?targetPath:std::filesystem::path(targetPath).parent_path().wstring();
+            if(verifiedDirectories.count(directory)==0) {
+                FileSystemHelper::VerifyWithinBaseW(canonicalBase,directory);
+                verifiedDirectories.insert(directory);
+            }
+            if(!entry.isDirectory) {
+                FileSystemHelper::VerifyFileWithinBaseW(canonicalBase,targetPath);
+            }
+        }
+        catch(const std::exception& e) {
+            LOG_ERROR<<"ZIP path traversal blocked: "<<e.what()<<" (entry: "<<entry.name<<")"<<std::endl;
+            if(!entry.isDirectory) {
+                state.failedFiles++;
+            }
+            if(!reader.ReadEntryData(discard)) {
+                return false;
+            }
+            continue;
+        }
+
+        if(entry.isDirectory) {
+            ensureDirectory(targetPath);
+            if(!reader.ReadEntryData(discard)) {
+                return false;
+            }
+            continue;
+        }
+
+        // 本地文件头已给出 CRC 与大小时，内容相同的文件只解压校验、不写盘
+        if(skipUnchanged&&!entry.hasDataDescriptor&&
+            FileHasher::FileMatchesCrc32(targetPath,entry.uncompressedSize,entry.crc)) {
+            if(!reader.ReadEntryData(discard)) {
+                return false;
+            }
+            state.skippedFiles++;
+            continue;
+        }
+
+        ensureDirectory(std::filesystem::path(targetPath).parent_path().wstring());
+        FILE* outFile=_wfopen(targetPath.c_str(),L"wb");
+        if(!outFile) {
+            // 无法创建的文件交给整包解压的 ASCII 名称后备处理
+            LOG_WARN<<"无法创建文件: "<<entry.name<<" (错误码: "<<GetLastError()<<")，停止流式解压"<<std::endl;
+            return false;
+        }
+        bool written=true;
+        bool dataValid=reader.ReadEntryData([outFile,&written](const unsigned char* data,size_t size) {
+            if(written&&fwrite(data,1,size,outFile)!=size) {
+                written=false;
+            }
+            });
+        if(fclose(outFile)!=0) {
+            written=false;
+        }
+        if(!dataValid) {
+            return false;
+        }
+        if(written) {
+            state.extractedFiles++;
+        }
+        else {
+            LOG_ERROR<<"解压文件失败: "<<entry.name<<std::endl;
+            state.failedFiles++;
+        }
+    }
+    return result==StreamingZipReader::Result::End&&reader.GetEntryCount()>0;
 }
\ No newline at end of file
@@ -0,0 +1,127 @@
+﻿#include "ZipPackageReader.h"
+#include <algorithm>
+#include <cstdio>
+#include "FileHasher.h"
+#include "FileSystemHelper.h"
+#include "Logger.h"
+
+namespace {
+    const size_t COPY_BUFFER_SIZE=65536;
+}
+
+ZipPackageReader::ZipPackageReader()
+    : zip(nullptr) {
+}
+
+ZipPackageReader::~ZipPackageReader() {
+    Close();
+}
+
+bool ZipPackageReader::Open(const std::string& zipFilePath) {
+    Close();
+    int err=0;
+    zip=zip_open(zipFilePath.c_str(),ZIP_RDONLY,&err);
+    if(!zip) {
+        LOG_ERROR<<"无法打开更新包: "<<zipFilePath<<"，错误码: "<<err<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ZipPackageReader::Close() {
+    if(zip) {
+        zip_discard(zip);
+        zip=nullptr;
+    }
+}
+
+zip_int64_t ZipPackageReader::Locate(const std::string& name) const {
+    if(!zip) {
+        return -1;
+    }
+    // 清单中的路径可能带反斜杠，包内条目统一使用正斜杠
+    std::string entryName=name;
+    std::replace(entryName.begin(),entryName.end(),'\\','/');
+    return zip_name_locate(zip,entryName.c_str(),ZIP_FL_ENC_GUESS);
+}
+
+bool ZipPackageReader::HasEntry(const std::string& name) const {
+    return Locate(name)>=0;
+}
+
+template<typename Sink>
+bool ZipPackageReader::CopyEntry(zip_int64_t index,Sink&& sink) {
+    zip_file_t* file=zip_fopen_index(zip,index,0);
+    if(!file) {
+        return false;
+    }
+    if(buffer.size()<COPY_BUFFER_SIZE) {
+        buffer.resize(COPY_BUFFER_SIZE);
+    }
+    // 读到末尾时 libzip 会校验 CRC，出错返回 -1
+    zip_int64_t bytesRead;
+    bool written=true;
+    while(written&&(bytesRead=zip_fread(file,buffer.data(),buffer.size()))>0) {
+        written=sink(buffer.data(),static_cast<size_t>(bytesRead));
+    }
+    zip_fclose(file);
+    return written&&bytesRead==0;
+}
+
+bool ZipPackageReader::ReadEntry(const std::string& name,std::string& content) {
+    content.clear();
+    zip_int64_t index=Locate(name);
+    if(index<0) {
+        return false;
+    }
+    return CopyEntry(index,[&content](const char* data,size_t size) {
+        content.append(data,size);
+        return true;
+        });
+}
+
+bool ZipPackageReader::EntryMatchesFile(const std::string& name,const std::filesystem::path& targetPath) const {
+    zip_int64_t index=Locate(name);
+    zip_stat_t stat;
+    zip_stat_init(&stat);
+    if(index<0||zip_stat_index(zip,index,0,&stat)!=0||
+        !(stat.valid&ZIP_STAT_SIZE)||!(stat.valid&ZIP_STAT_CRC)) {
+        return false;
+    }
+    return FileHasher::FileMatchesCrc32(targetPath.wstring(),stat.size,stat.crc);
+}
+
+bool ZipPackageReader::ExtractEntryTo(const std::string& name,const std::filesystem::path& targetPath) {
+    zip_int64_t index=Locate(name);
+    if(index<0) {
+        LOG_WARN<<"更新包中不存在条目: "<<name<<std::endl;
+        return false;
+    }
+
+    // 临时文件与目标在同一目录，重命名不会跨文件系统
+    std::filesystem::path tempPath=targetPath;
+    tempPath+=L".mcupd_tmp";
+    FILE* outFile=_wfopen(tempPath.wstring().c_str(),L"wb");
+    if(!outFile) {
+        LOG_ERROR<<"无法创建临时文件: "<<FileSystemHelper::WideToUtf8(tempPath.wstring())<<std::endl;
+        return false;
+    }
+    bool copied=CopyEntry(index,[outFile](const char* data,size_t size) {
+        return fwrite(data,1,size,outFile)==size;
+        });
+    bool closed=fclose(outFile)==0;
+
+    std::error_code ec;
+    if(copied&&closed) {
+        std::filesystem::rename(tempPath,targetPath,ec);
+        if(!ec) {
+            return true;
+        }
+        LOG_ERROR<<"替换文件失败: "<<name<<" - "<<ec.message()<<std::endl;
+    }
+    else {
+        LOG_ERROR<<"解压条目失败: "<<name<<std::endl;
+    }
+    std::filesystem::remove(tempPath,ec);
+    return false;
+}
\ No newline at end of file
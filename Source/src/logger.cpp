@@ -1,39 +1,235 @@
 ﻿#include "Logger.h"
 #include <filesystem>
+#include <chrono>
 
 Logger g_logger;
 
-Logger::Logger(): enabled(false),isNewLine(true){}
+thread_local std::string Logger::lineBuffer;
+thread_local size_t Logger::linePrefix=0;
+thread_local bool Logger::lineStarted=false;
 
-Logger::~Logger() {
-    if(logFile.is_open()) {
-        logFile.close();
+Logger::Logger()
+    : enabled(false),
+    ring(new Slot[RING_CAPACITY]),
+    enqueuePos(0),
+    dequeuePos(0),
+    flushedPos(0),
+    writerSleeping(false),
+    flushRequested(false),
+    stopping(false),
+    flushIntervalMs(1000),
+    minLevel(static_cast<int>(LogLevel::Debug)) {
+    for(size_t i=0; i<RING_CAPACITY; i++) {
+        ring[i].sequence.store(i,std::memory_order_relaxed);
     }
 }
 
+Logger::~Logger() {
+    Shutdown();
+}
+
 bool Logger::Initialize(const std::string& filename) {
     logFileName=filename;
 
     std::filesystem::path path(filename);
     std::filesystem::create_directories(path.parent_path());
-    logFile.open(filename,std::ios::app);
+    logFile.open(filename,std::ios::app|std::ios::binary);
     if(!logFile.is_open()) {
         std::cerr<<"[ERROR]无法打开日志文件: "<<filename<<std::endl;
         enabled=false;
         return false;
     }
 
+    if(!writerThread.joinable()) {
+        stopping=false;
+        writerThread=std::thread(&Logger::WriterLoop,this);
+    }
     enabled=true;
-    isNewLine=true;
     *this<<"[INFO]=== McUpdaterClient 日志开始 ==="<<std::endl;
     return true;
 }
 
 void Logger::Enable(bool enable) {
-    enabled=enable;
+    enabled=enable&&writerThread.joinable();
+}
+
+void Logger::SetFlushInterval(int milliseconds) {
+    flushIntervalMs=milliseconds<0?0:milliseconds;
+    WakeWriter();
+}
+
+bool Logger::ParseLevel(const std::string& name,LogLevel& level) {
+    if(name=="debug") level=LogLevel::Debug;
+    else if(name=="info") level=LogLevel::Info;
+    else if(name=="warn") level=LogLevel::Warn;
+    else if(name=="error") level=LogLevel::Error;
+    else return false;
+    return true;
+}
+
+Logger& Logger::BeginRecord(LogLevel level) {
+    static const char* const prefixes[]={"[DEBUG] ","[INFO] ","[WARN] ","[ERROR] "};
+    if(!lineStarted) {
+        BeginLine();
+    }
+    lineBuffer.append(prefixes[static_cast<int>(level)]);
+    return *this;
+}
+
+void Logger::BeginLine() {
+    lineBuffer.clear();
+    linePrefix=0;
+    if(enabled.load(std::memory_order_relaxed)) {
+        AppendTimestamp(lineBuffer);
+        lineBuffer.push_back(' ');
+        linePrefix=lineBuffer.size();
+    }
+    lineStarted=true;
+}
+
+void Logger::EndLine() {
+    if(!lineStarted) {
+        BeginLine();
+    }
+    lineBuffer.push_back('\n');
+    std::cout.write(lineBuffer.data()+linePrefix,static_cast<std::streamsize>(lineBuffer.size()-linePrefix));
+    std::cout.flush();
+
+    if(enabled.load(std::memory_order_relaxed)&&linePrefix>0) {
+        // 队列满时让出时间片等待后台线程腾出槽位，不丢弃记录
+        while(!TryEnqueue(lineBuffer)) {
+            WakeWriter();
+            std::this_thread::yield();
+        }
+        size_t pending=enqueuePos.load(std::memory_order_relaxed)-dequeuePos.load(std::memory_order_relaxed);
+        if(flushIntervalMs.load(std::memory_order_relaxed)==0||pending>=RING_CAPACITY/2) {
+            WakeWriter();
+        }
+    }
+    lineBuffer.clear();
+    lineStarted=false;
+}
+
+bool Logger::TryEnqueue(std::string& record) {
+    size_t pos=enqueuePos.load(std::memory_order_relaxed);
+    for(;;) {
+        Slot& slot=ring[pos&(RING_CAPACITY-1)];
+        size_t sequence=slot.sequence.load(std::memory_order_acquire);
+        intptr_t diff=static_cast<intptr_t>(sequence)-static_cast<intptr_t>(pos);
+        if(diff==0) {
+            if(enqueuePos.compare_exchange_weak(pos,pos+1)) {
+                // 交换而非复制，槽位里旧字符串的容量留给本线程下一行复用
+                slot.record.swap(record);
+                slot.sequence.store(pos+1,std::memory_order_release);
+                return true;
+            }
+        }
+        else if(diff<0) {
+            return false;
+        }
+        else {
+            pos=enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::WakeWriter() {
+    if(writerSleeping.load()) {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeCondition.notify_one();
+    }
+}
+
+void Logger::WriterLoop() {
+    std::string batch;
+    bool dirty=false;
+    auto lastFlush=std::chrono::steady_clock::now();
+
+    for(;;) {
+        size_t pos=dequeuePos.load(std::memory_order_relaxed);
+        for(;;) {
+            Slot& slot=ring[pos&(RING_CAPACITY-1)];
+            if(slot.sequence.load(std::memory_order_acquire)!=pos+1) {
+                break;
+            }
+            batch.append(slot.record);
+            slot.record.clear();
+            slot.sequence.store(pos+RING_CAPACITY,std::memory_order_release);
+            pos++;
+        }
+        dequeuePos.store(pos,std::memory_order_relaxed);
+
+        if(!batch.empty()) {
+            logFile.write(batch.data(),static_cast<std::streamsize>(batch.size()));
+            batch.clear();
+            dirty=true;
+        }
+
+        int interval=flushIntervalMs.load(std::memory_order_relaxed);
+        bool stop=stopping.load();
+        bool forceFlush=flushRequested.exchange(false)||stop;
+        auto now=std::chrono::steady_clock::now();
+        if(dirty&&(forceFlush||interval==0||now-lastFlush>=std::chrono::milliseconds(interval))) {
+            logFile.flush();
+            dirty=false;
+            lastFlush=now;
+        }
+        if(!dirty) {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            flushedPos.store(pos);
+            flushedCondition.notify_all();
+        }
+
+        if(stop&&enqueuePos.load()==pos) {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        writerSleeping.store(true);
+        // 生产者只在写穿模式或队列过半时唤醒，其余记录攒到刷盘周期再批量写入
+        size_t pending=enqueuePos.load()-pos;
+        if(!stopping.load()&&!flushRequested.load()&&!(pending>0&&(interval==0||pending>=RING_CAPACITY/2))) {
+            auto wait=std::chrono::milliseconds(interval>0?interval:1000);
+            if(dirty) {
+                wakeCondition.wait_until(lock,lastFlush+wait);
+            }
+            else {
+                wakeCondition.wait_for(lock,wait);
+            }
+        }
+        writerSleeping.store(false);
+    }
+}
+
+void Logger::Flush() {
+    if(!writerThread.joinable()) {
+        return;
+    }
+    size_t target=enqueuePos.load();
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    while(flushedPos.load()<target&&!stopping.load()) {
+        flushRequested.store(true);
+        wakeCondition.notify_one();
+        flushedCondition.wait_for(lock,std::chrono::milliseconds(10));
+    }
+}
+
+void Logger::Shutdown() {
+    if(writerThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping.store(true);
+            wakeCondition.notify_one();
+        }
+        writerThread.join();
+    }
+    enabled=false;
+    if(logFile.is_open()) {
+        logFile.close();
+    }
 }
 
-std::string Logger::GetTimestamp() {
+void Logger::AppendTimestamp(std::string& line) {
     auto now=std::chrono::system_clock::now();
     auto time_t=std::chrono::system_clock::to_time_t(now);
     auto ms=std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -42,8 +238,8 @@ std::string Logger::GetTimestamp() {
     std::tm local_tm;
     localtime_s(&local_tm,&time_t);
 
-    std::stringstream ss;
-    ss<<"["<<std::put_time(&local_tm,"%Y-%m-%d %H:%M:%S");
-    ss<<"."<<std::setfill('0')<<std::setw(3)<<ms.count()<<"]";
-    return ss.str();
+    char buffer[32];
+    size_t length=std::strftime(buffer,sizeof(buffer),"[%Y-%m-%d %H:%M:%S",&local_tm);
+    length+=snprintf(buffer+length,sizeof(buffer)-length,".%03d]",static_cast<int>(ms.count()));
+    line.append(buffer,length);
 }
\ No newline at end of file
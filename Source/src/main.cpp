@@ -1,8 +1,113 @@
 ﻿#include <iostream>
 #include <string>
+#include <fstream>
+#include <chrono>
 #include "ConfigManager.h"
 #include "UpdateOrchestrator.h"
+#include "FileHasher.h"
+#include "BinaryManifest.h"
+
+// 旧实现：std::ifstream 每次读 8 KiB，作为基准对照
+static std::string HashWithIfstream(const std::string& filePath,const std::string& algorithm) {
+    std::ifstream file(filePath,std::ios::binary);
+    if(!file) {
+        return "";
+    }
+
+    FileHasher::StreamHasher hasher(algorithm);
+    const size_t bufferSize=8192;
+    char buffer[bufferSize];
+    while(file.read(buffer,bufferSize)||file.gcount()>0) {
+        hasher.Update(buffer,static_cast<size_t>(file.gcount()));
+    }
+    return hasher.Final();
+}
+
+static int RunHashBenchmark(const std::string& filePath,const std::string& algorithm,int rounds) {
+    std::error_code ec;
+    auto fileSize=std::filesystem::file_size(filePath,ec);
+    if(ec) {
+        std::cerr<<"[ERROR] 无法读取文件: "<<filePath<<" - "<<ec.message()<<std::endl;
+        return 1;
+    }
+    if(!FileHasher::IsSupportedAlgorithm(algorithm)) {
+        std::cerr<<"[ERROR] 不支持的哈希算法: "<<algorithm<<std::endl;
+        return 1;
+    }
+
+    auto measure=[&](const char* name,std::string(*hashFunc)(const std::string&,const std::string&),std::string& digest) {
+        digest=hashFunc(filePath,algorithm);
+        auto start=std::chrono::steady_clock::now();
+        for(int i=0; i<rounds; i++) {
+            digest=hashFunc(filePath,algorithm);
+        }
+        double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count()/rounds;
+        double throughput=seconds>0?(fileSize/1024.0/1024.0)/seconds:0.0;
+        std::cout<<"  "<<std::left<<std::setw(10)<<name<<std::fixed<<std::setprecision(2)
+            <<(seconds*1000.0)<<" ms/次, "<<std::setprecision(1)<<throughput<<" MB/s"<<std::endl;
+        return seconds;
+        };
+
+    std::cout<<"[INFO] 哈希基准测试: "<<filePath<<" ("<<fileSize<<" 字节, "<<algorithm<<", "<<rounds<<" 轮)"<<std::endl;
+    std::string legacyDigest,currentDigest;
+    double legacySeconds=measure("ifstream",HashWithIfstream,legacyDigest);
+    double currentSeconds=measure("current",FileHasher::CalculateFileHashStream,currentDigest);
+
+    if(legacyDigest!=currentDigest) {
+        std::cerr<<"[ERROR] 两种实现的摘要不一致: "<<legacyDigest<<" / "<<currentDigest<<std::endl;
+        return 1;
+    }
+    if(currentSeconds>0) {
+        std::cout<<"[INFO] 加速比: "<<std::setprecision(2)<<(legacySeconds/currentSeconds)<<"x, 摘要: "<<currentDigest<<std::endl;
+    }
+    return 0;
+}
+
+// 服务端发布用：把 JSON 清单转换为二进制清单，输出的哈希填入 binary_manifest.hash
+static int RunBuildBinaryManifest(const std::string& inputPath,const std::string& outputPath,const std::string& algorithm) {
+    std::ifstream input(inputPath,std::ios::binary);
+    if(!input.is_open()) {
+        std::cerr<<"[ERROR] 无法读取文件: "<<inputPath<<std::endl;
+        return 1;
+    }
+
+    Json::CharReaderBuilder reader;
+    Json::Value manifest;
+    std::string errors;
+    if(!Json::parseFromStream(reader,input,&manifest,&errors)) {
+        std::cerr<<"[ERROR] JSON解析错误: "<<errors<<std::endl;
+        return 1;
+    }
+
+    std::vector<unsigned char> output;
+    std::string error;
+    if(!BinaryManifest::Build(manifest["files"],manifest["directories"],algorithm,output,error)) {
+        std::cerr<<"[ERROR] 生成二进制清单失败: "<<error<<std::endl;
+        return 1;
+    }
+
+    std::ofstream file(outputPath,std::ios::binary|std::ios::trunc);
+    if(!file.is_open()||!file.write(reinterpret_cast<const char*>(output.data()),static_cast<std::streamsize>(output.size()))) {
+        std::cerr<<"[ERROR] 无法写入文件: "<<outputPath<<std::endl;
+        return 1;
+    }
+    file.close();
+
+    std::cout<<"[INFO] 二进制清单已生成: "<<outputPath<<" ("<<output.size()<<" 字节)"<<std::endl;
+    std::cout<<"[INFO] "<<algorithm<<": "<<FileHasher::CalculateMemoryHash(output,algorithm)<<std::endl;
+    return 0;
+}
+
 int main(int argc,char* argv[]) {
+    if(argc>=3&&strcmp(argv[1],"--benchmark-hash")==0) {
+        std::string algorithm=(argc>=4)?argv[3]:"sha256";
+        int rounds=(argc>=5)?(std::max)(1,atoi(argv[4])):5;
+        return RunHashBenchmark(argv[2],algorithm,rounds);
+    }
+    if(argc>=4&&strcmp(argv[1],"--build-binary-manifest")==0) {
+        std::string algorithm=(argc>=5)?argv[4]:"sha256";
+        return RunBuildBinaryManifest(argv[2],argv[3],algorithm);
+    }
     if(argc==4&&strcmp(argv[1],"--elevated-replace")==0) {
         std::wstring newExe=FileSystemHelper::Utf8ToWide(argv[2]);
         std::wstring targetExe=FileSystemHelper::Utf8ToWide(argv[3]);
@@ -11,7 +116,7 @@ int main(int argc,char* argv[]) {
         GetModuleFileNameW(NULL,curExe,MAX_PATH);
 
         if(_wcsicmp(targetExe.c_str(),curExe)!=0) {
-            g_logger<<"[ERROR] 提权替换目标不是当前程序，拒绝"<<std::endl;
+            LOG_ERROR<<"提权替换目标不是当前程序，拒绝"<<std::endl;
             return 1;
         }
 
@@ -23,7 +128,7 @@ int main(int argc,char* argv[]) {
         tempDirPath=std::filesystem::weakly_canonical(tempDirPath);
         newExePath=std::filesystem::weakly_canonical(newExePath);
         if(newExePath.wstring().find(tempDirPath.wstring())!=0) {
-            g_logger<<"[ERROR] 新文件不在临时目录（规范化后），拒绝"<<std::endl;
+            LOG_ERROR<<"新文件不在临时目录（规范化后），拒绝"<<std::endl;
             return 1;
         }
 
@@ -53,6 +158,7 @@ int main(int argc,char* argv[]) {
             return 1;
         }
     }
+    bool resetHashIndex=(argc>=2&&strcmp(argv[1],"--reset-hash-index")==0);
     std::string cfg="config/updater.json";
 
     ConfigManager configManager(cfg);
@@ -63,7 +169,7 @@ int main(int argc,char* argv[]) {
         configManager.WriteLauncherVersion(currentVersion);
     }
 
-    g_logger<<"[INFO] 当前启动器版本: v"<<currentVersion<<std::endl;
+    LOG_INFO<<"当前启动器版本: v"<<currentVersion<<std::endl;
 
     if(!configManager.ConfigExists()) {
         std::cout<<"[INFO] 未找到配置文件，正在生成默认配置文件..."<<std::endl;
@@ -80,6 +186,7 @@ int main(int argc,char* argv[]) {
     }
 
     std::string logFile=configManager.ReadLogFile();
+    g_logger.SetFlushInterval(configManager.ReadLogFlushIntervalMs());
     if(!g_logger.Initialize(logFile)) {
         std::cerr<<"[ERROR] 无法初始化日志文件，将继续使用控制台输出"<<std::endl;
     }
@@ -87,42 +194,52 @@ int main(int argc,char* argv[]) {
         std::cout<<"[INFO] 日志文件: "<<logFile<<std::endl;
     }
 
+    std::string logLevelName=configManager.ReadLogLevel();
+    LogLevel logLevel=LogLevel::Info;
+    if(!Logger::ParseLevel(logLevelName,logLevel)) {
+        LOG_WARN<<"未知的日志级别: "<<logLevelName<<" (可选 debug/info/warn/error)，使用 info"<<std::endl;
+    }
+    g_logger.SetLevel(logLevel);
+
     std::string apiUrl=configManager.ReadUpdateUrl();
     std::string gameDir=configManager.ReadGameDirectory();
 
     if(apiUrl.empty()) {
-        g_logger<<"[ERROR] 配置文件中未设置更新api(update_url)！"<<std::endl;
+        LOG_ERROR<<"配置文件中未设置更新api(update_url)！"<<std::endl;
         return 1;
     }
 
     if(gameDir.empty()) {
-        g_logger<<"[ERROR] 配置文件中未设置游戏目录(game_directory)！"<<std::endl;
+        LOG_ERROR<<"配置文件中未设置游戏目录(game_directory)！"<<std::endl;
         return 1;
     }
 
-    g_logger<<"[INFO] Made by Reikumo."<<std::endl;
-    g_logger<<"[INFO] 配置加载成功："<<std::endl;
-    g_logger<<"[INFO]  游戏目录: "<<gameDir<<std::endl;
-    g_logger<<"[INFO]  更新服务器api: "<<apiUrl<<std::endl;
-    g_logger<<"[INFO]  自动更新状态: "<<(configManager.ReadAutoUpdate()?"开启":"关闭")<<std::endl;
-    g_logger<<"[INFO]  日志文件地址: "<<logFile<<std::endl;
-    g_logger<<"[INFO]  客户端更新模式: "<<configManager.ReadUpdateMode()<<" (可能被服务端覆盖)"<<std::endl;
-    g_logger<<"[INFO]  哈希算法: "<<configManager.ReadHashAlgorithm()<<std::endl;
-    g_logger<<"[INFO]  文件删除功能: "<<(configManager.ReadEnableFileDeletion()?"开启":"关闭")<<std::endl;
-    g_logger<<"[INFO]  API超时时间: "<<configManager.ReadApiTimeout()<<"秒"<<std::endl;
+    LOG_INFO<<"Made by Reikumo."<<std::endl;
+    LOG_INFO<<"配置加载成功："<<std::endl;
+    LOG_INFO<<" 游戏目录: "<<gameDir<<std::endl;
+    LOG_INFO<<" 更新服务器api: "<<apiUrl<<std::endl;
+    LOG_INFO<<" 自动更新状态: "<<(configManager.ReadAutoUpdate()?"开启":"关闭")<<std::endl;
+    LOG_INFO<<" 日志文件地址: "<<logFile<<std::endl;
+    LOG_INFO<<" 客户端更新模式: "<<configManager.ReadUpdateMode()<<" (可能被服务端覆盖)"<<std::endl;
+    LOG_INFO<<" 哈希算法: "<<configManager.ReadHashAlgorithm()<<std::endl;
+    LOG_INFO<<" 文件删除功能: "<<(configManager.ReadEnableFileDeletion()?"开启":"关闭")<<std::endl;
+    LOG_INFO<<" API超时时间: "<<configManager.ReadApiTimeout()<<"秒"<<std::endl;
     g_logger<<std::endl;
 
     {
         UpdateOrchestrator updater(cfg,apiUrl,gameDir);
+        if(resetHashIndex) {
+            updater.ResetHashIndex();
+        }
 
         if(updater.CheckForUpdates()) {
             if(configManager.ReadAutoUpdate()) {
-                g_logger<<"[INFO] 自动更新已开启，开始更新..."<<std::endl;
+                LOG_INFO<<"自动更新已开启，开始更新..."<<std::endl;
                 if(updater.ForceUpdate(false)) {
-                    g_logger<<"[INFO] 自动更新成功！"<<std::endl;
+                    LOG_INFO<<"自动更新成功！"<<std::endl;
                 }
                 else {
-                    g_logger<<"[ERROR] 自动更新失败"<<std::endl;
+                    LOG_ERROR<<"自动更新失败"<<std::endl;
                     return 1;
                 }
             }
@@ -137,21 +254,21 @@ int main(int argc,char* argv[]) {
                     bool forceSync=(choice=='y'||choice=='Y');
 
                     if(updater.ForceUpdate(forceSync)) {
-                        g_logger<<"[INFO] 更新成功！"<<std::endl;
+                        LOG_INFO<<"更新成功！"<<std::endl;
                     }
                     else {
-                        g_logger<<"[ERROR] 更新失败！"<<std::endl;
+                        LOG_ERROR<<"更新失败！"<<std::endl;
                         return 1;
                     }
                 }
                 else {
-                    g_logger<<"[INFO] 已取消更新。"<<std::endl;
+                    LOG_INFO<<"已取消更新。"<<std::endl;
                 }
             }
         }
     }
 
-    g_logger<<"[INFO] === McUpdaterClient 日志结束 ==="<<std::endl;
+    LOG_INFO<<"=== McUpdaterClient 日志结束 ==="<<std::endl;
 
     if(!configManager.ReadAutoUpdate()) {
         std::cout<<"按回车键退出..."<<std::endl;
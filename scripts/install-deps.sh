@@ -15,7 +15,9 @@ if [[ "$OSTYPE" == "linux-gnu"* ]]; then
         libcurl4-openssl-dev \
         libssl-dev \
         libjsoncpp-dev \
-        libzip-dev
+        libzip-dev \
+        libxxhash-dev \
+        libblake3-dev
 
 elif [[ "$OSTYPE" == "darwin"* ]]; then
     # macOS
@@ -25,12 +27,12 @@ elif [[ "$OSTYPE" == "darwin"* ]]; then
         exit 1
     fi
     brew update
-    brew install cmake pkg-config curl openssl jsoncpp libzip
+    brew install cmake pkg-config curl openssl jsoncpp libzip xxhash blake3
 
 elif [[ "$OSTYPE" == "msys" || "$OSTYPE" == "win32" ]]; then
     # Windows
     echo "Please install dependencies using vcpkg on Windows:"
-    echo "vcpkg install curl openssl jsoncpp libzip"
+    echo "vcpkg install curl[ssl,http2,zstd] openssl jsoncpp libzip blake3 xxhash"
 else
     echo "Unsupported OS: $OSTYPE"
     exit 1